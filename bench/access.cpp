@@ -0,0 +1,145 @@
+/**
+ * @brief Benchmark of per-pixel access: construction, operator() and operator[] of every depth, and the 24-bit
+ * setPixel, getPixel and channel accessors.
+ *
+ * Only uses accessors that every version of the library has, so the same program times older trees as well. Build
+ * from the repository root, then run with the dimensions of the images (1920 by 1080 by default):
+ *
+ *     g++ -std=gnu++11 -O2 -march=native -pthread -I. bench/access.cpp bmp*.cpp -o access
+ *     ./access [width height]
+ *
+ * Each line is the fastest of the passes made in at least 0.3 s, and the throughput in megapixels per second.
+ */
+#include "bmp_8-bit.h"
+#include "bmp_16-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+typedef std::chrono::steady_clock Clock;
+
+/// Keeps the values read from being optimised away
+static volatile uint32_t sink;
+
+/// Prints the fastest call of a function over repeated calls for at least 0.3 s
+template<typename F>
+static void time(const char *name, const double &megapixels, F f) {
+    double fastest = 1e9;
+    const Clock::time_point start = Clock::now();
+    do {
+        const Clock::time_point call = Clock::now();
+        f();
+        fastest = std::min(fastest, std::chrono::duration<double>(Clock::now() - call).count());
+    } while (std::chrono::duration<double>(Clock::now() - start).count() < 0.3);
+
+    std::printf("%-32s %8.2f ms %8.0f MP/s\n", name, fastest * 1e3, megapixels / fastest);
+}
+
+///@{
+/// Access loops, not inlined into the timing loop so that every version is compiled the same way
+template<typename Image>
+__attribute__((noinline)) static void writeXY(Image &n, const int32_t w, const int32_t h) {
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x)
+            n(x, y) = x + y;
+    }
+}
+
+template<typename Image>
+__attribute__((noinline)) static uint32_t readXY(const Image &n, const int32_t w, const int32_t h) {
+    uint32_t sum = 0;
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x)
+            sum += n(x, y);
+    }
+
+    return sum;
+}
+
+template<typename Image>
+__attribute__((noinline)) static void writeIndex(Image &n, const size_t size) {
+    for (size_t i = 0; i < size; ++i)
+        n[i] = i;
+}
+
+template<typename Image>
+__attribute__((noinline)) static uint32_t readIndex(const Image &n, const size_t size) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < size; ++i)
+        sum += n[i];
+
+    return sum;
+}
+///@}
+
+/// Times the accessors of an 8, 16 or 32-bit image
+template<typename Image>
+static void accessors(const char *name, const int32_t &w, const int32_t &h) {
+    const double megapixels = w * static_cast<double>(h) / 1e6;
+    const size_t size = static_cast<size_t>(w) * h;
+    Image n(w, h, 1);
+    char line[64];
+
+    std::snprintf(line, sizeof(line), "%s constructor", name);
+    time(line, megapixels, [&]() -> void { sink = Image(w, h, 1)(0, 0); });
+
+    std::snprintf(line, sizeof(line), "%s operator() write", name);
+    time(line, megapixels, [&]() -> void { writeXY(n, w, h); });
+
+    std::snprintf(line, sizeof(line), "%s operator() read", name);
+    time(line, megapixels, [&]() -> void { sink = readXY(n, w, h); });
+
+    std::snprintf(line, sizeof(line), "%s operator[] write", name);
+    time(line, megapixels, [&]() -> void { writeIndex(n, size); });
+
+    std::snprintf(line, sizeof(line), "%s operator[] read", name);
+    time(line, megapixels, [&]() -> void { sink = readIndex(n, size); });
+}
+
+///@{
+/// Access loops of BMP_24bit
+__attribute__((noinline)) static void setPixels(BMP_24bit &n, const int32_t w, const int32_t h) {
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x)
+            n.setPixel(x, y, x ^ y);
+    }
+}
+
+__attribute__((noinline)) static uint32_t getPixels(const BMP_24bit &n, const int32_t w, const int32_t h) {
+    uint32_t sum = 0;
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x)
+            sum += n.getPixel(x, y);
+    }
+
+    return sum;
+}
+
+__attribute__((noinline)) static void writeRed(BMP_24bit &n, const int32_t w, const int32_t h) {
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x)
+            n.red(x, y) = x;
+    }
+}
+///@}
+
+int main(int argc, char **argv) {
+    const int32_t w = argc > 2 ? std::atoi(argv[1]) : 1920, h = argc > 2 ? std::atoi(argv[2]) : 1080;
+    const double megapixels = w * static_cast<double>(h) / 1e6;
+    std::printf("%dx%d\n", w, h);
+
+    accessors<BMP_8bit>("8-bit", w, h);
+    accessors<BMP_16bit>("16-bit", w, h);
+    accessors<BMP_32bit>("32-bit", w, h);
+
+    BMP_24bit n(w, h, 0x123456);
+    time("24-bit constructor", megapixels, [&]() -> void { sink = BMP_24bit(w, h, 0x123456).getPixel(0, 0); });
+    time("24-bit setPixel", megapixels, [&]() -> void { setPixels(n, w, h); });
+    time("24-bit getPixel", megapixels, [&]() -> void { sink = getPixels(n, w, h); });
+    time("24-bit red() write", megapixels, [&]() -> void { writeRed(n, w, h); });
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * @brief Benchmark of BMP_Composite: every blend mode on a 4K frame, for a full-frame layer and a watermark.
+ *
+ * Build from the repository root, then run with the dimensions of the frame (3840 by 2160 by default):
+ *
+ *     g++ -std=gnu++11 -O2 -march=native -pthread -I. bench/composite.cpp bmp*.cpp -o composite
+ *     ./composite [width height]
+ *
+ * Each cell is the time of one blend, the best of the calls made in at least 0.3 s, and the throughput in blended
+ * megapixels per second. The layers have random colours and alphas, the watermark is 512 by 512 pixels and hangs over
+ * the bottom-right corner of the frame so that clipping is timed as well.
+ */
+#include "bmp_32-bit.h"
+#include "bmp_composite.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+typedef BMP_Composite::Mode Mode;
+
+/// Times a function over repeated calls for at least 0.3 s, returns the seconds of the fastest call
+template<typename F>
+static double best(F f) {
+    double fastest = 1e9;
+    const Clock::time_point start = Clock::now();
+    do {
+        const Clock::time_point call = Clock::now();
+        f();
+        fastest = std::min(fastest, std::chrono::duration<double>(Clock::now() - call).count());
+    } while (std::chrono::duration<double>(Clock::now() - start).count() < 0.3);
+
+    return fastest;
+}
+
+/// A layer of random colours and alphas, premultiplied if asked so that it is valid for overPremultiplied
+static BMP_32bit layer(const int32_t &w, const int32_t &h, std::mt19937 &random, const bool &premultiplied) {
+    BMP_32bit n(w, h);
+    const BMP_32bit::View view = n.view();
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x) {
+            uint32_t pixel = random();
+            if (premultiplied) {
+                const uint32_t a = pixel >> 24;
+                for (uint8_t shift = 0; shift < 24; shift += 8)
+                    pixel = (pixel & ~(0xFFu << shift)) | ((pixel >> shift & 0xFF) * a / 255) << shift;
+            }
+            view.row(y)[x] = pixel;
+        }
+    }
+
+    return n;
+}
+
+int main(int argc, char **argv) {
+    const int32_t w = argc > 2 ? std::atoi(argv[1]) : 3840, h = argc > 2 ? std::atoi(argv[2]) : 2160;
+    const int32_t mark = std::min(512, std::min(w, h));
+    std::mt19937 random(42);
+
+    BMP_32bit frame = layer(w, h, random, false);
+    const BMP_32bit full = layer(w, h, random, false), fullPremultiplied = layer(w, h, random, true);
+    const BMP_32bit watermark = layer(mark, mark, random, false);
+    const BMP_32bit watermarkPremultiplied = layer(mark, mark, random, true);
+
+    // The part of the watermark inside the frame
+    const int32_t x = w - mark * 3 / 4, y = h - mark * 3 / 4;
+    const double megapixels = w * static_cast<double>(h) / 1e6;
+    const double markMegapixels = (w - x) * static_cast<double>(h - y) / 1e6;
+
+    const struct {
+        Mode mode;
+        const char *name;
+    } modes[] = {{Mode::over, "over"}, {Mode::overPremultiplied, "overPremultiplied"}, {Mode::multiply, "multiply"},
+                 {Mode::screen, "screen"}, {Mode::add, "add"}};
+
+    std::printf("%dx%d frame, %u threads, mode | full frame | %dx%d watermark\n", w, h,
+                std::thread::hardware_concurrency(), mark, mark);
+    for (const auto &m : modes) {
+        const bool premultiplied = m.mode == Mode::overPremultiplied;
+        const BMP_32bit::ConstView src = premultiplied ? fullPremultiplied.view() : full.view();
+        const BMP_32bit::ConstView markSrc = premultiplied ? watermarkPremultiplied.view() : watermark.view();
+
+        const double seconds = best([&]() -> void { BMP_Composite::blend(src, frame.view(), 0, 0, m.mode); });
+        const double markSeconds = best([&]() -> void { BMP_Composite::blend(markSrc, frame.view(), x, y, m.mode); });
+        std::printf("%-17s | %8.2f ms %6.0f MP/s | %8.3f ms %6.0f MP/s\n", m.name, seconds * 1e3,
+                    megapixels / seconds, markSeconds * 1e3, markMegapixels / markSeconds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ * @brief Benchmark of BMP_Dither: ordered and Floyd-Steinberg dithering of 8-bit and 24-bit images.
+ *
+ * Build from the repository root, then run with the dimensions of the source image (3840 by 2160 by default):
+ *
+ *     g++ -std=gnu++11 -O2 -march=native -pthread -I. bench/dither.cpp bmp*.cpp -o dither
+ *     ./dither [width height]
+ *
+ * Each line is the time of one call, the best of the calls made in at least 0.3 s, and the throughput in megapixels
+ * per second. The first line thresholds the 8-bit image with operator() on both images, the loop that the dithering
+ * functions replace, for reference.
+ */
+#include "bmp_1-bit.h"
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_dither.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+/// Times a function over repeated calls for at least 0.3 s, returns the seconds of the fastest call
+template<typename F>
+static double best(F f) {
+    double fastest = 1e9;
+    const Clock::time_point start = Clock::now();
+    do {
+        const Clock::time_point call = Clock::now();
+        f();
+        fastest = std::min(fastest, std::chrono::duration<double>(Clock::now() - call).count());
+    } while (std::chrono::duration<double>(Clock::now() - start).count() < 0.3);
+
+    return fastest;
+}
+
+/// Sets every pixel brighter than the middle grey to white, one operator() call per pixel on each side
+static BMP_1bit threshold(const BMP_8bit &n) {
+    const int32_t w = n.getInfoHeader().biWidth, h = std::abs(n.getInfoHeader().biHeight);
+    BMP_1bit out(w, n.getInfoHeader().biHeight);
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x)
+            out(x, y) = n(x, y) >= 128;
+    }
+
+    return out;
+}
+
+/// Prints the time and throughput of a function
+template<typename F>
+static void line(const char *name, const double &megapixels, F f) {
+    const double seconds = best(f);
+    std::printf("%-30s %8.2f ms %8.0f MP/s\n", name, seconds * 1e3, megapixels / seconds);
+}
+
+int main(int argc, char **argv) {
+    const int32_t w = argc > 2 ? std::atoi(argv[1]) : 3840, h = argc > 2 ? std::atoi(argv[2]) : 2160;
+    const double megapixels = w * static_cast<double>(h) / 1e6;
+    std::mt19937 random(42);
+
+    // A noisy gradient, so that neither function sees long runs of one value
+    BMP_8bit grey(w, h);
+    BMP_24bit rgb(w, h);
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x) {
+            const uint32_t noise = random();
+            const uint8_t value = static_cast<uint8_t>((x * 255 / w + noise % 32) & 0xFF);
+            grey.view().row(y)[x] = value;
+            rgb.view().row(y)[x] = {value, static_cast<uint8_t>(noise >> 8), static_cast<uint8_t>(y * 255 / h)};
+        }
+    }
+
+    std::printf("%dx%d source, %u threads\n", w, h, std::thread::hardware_concurrency());
+    line("8-bit threshold operator()", megapixels, [&]() -> void { threshold(grey); });
+    line("8-bit ordered", megapixels, [&]() -> void { BMP_Dither::ordered(grey); });
+    line("8-bit Floyd-Steinberg", megapixels, [&]() -> void { BMP_Dither::floydSteinberg(grey); });
+    line("24-bit ordered", megapixels, [&]() -> void { BMP_Dither::ordered(rgb); });
+    line("24-bit Floyd-Steinberg", megapixels, [&]() -> void { BMP_Dither::floydSteinberg(rgb); });
+
+    return 0;
+}
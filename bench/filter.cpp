@@ -0,0 +1,181 @@
+/**
+ * @brief Benchmark of BMP_Filter: gaussianBlur, boxBlur and unsharpMask of 8-bit and 24-bit images, against the same
+ * filters written as loops over the pixel accessors.
+ *
+ * Build from the repository root, then run with the dimensions of the source image (1920 by 1080 by default):
+ *
+ *     g++ -std=gnu++11 -O2 -march=native -pthread -I. bench/filter.cpp bmp*.cpp -o filter
+ *     ./filter [width height]
+ *
+ * Each cell is the time of one call, the best of the calls made in at least 0.3 s, and the throughput in megapixels
+ * per second. The naive filters make a horizontal and a vertical pass in double precision, reading and writing every
+ * pixel with getPixel and setPixel (operator() for 8-bit images) and clamping at the edges.
+ */
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_filter.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+/// Times a function over repeated calls for at least 0.3 s, returns the seconds of the fastest call
+template<typename F>
+static double best(F f) {
+    double fastest = 1e9;
+    const Clock::time_point start = Clock::now();
+    do {
+        const Clock::time_point call = Clock::now();
+        f();
+        fastest = std::min(fastest, std::chrono::duration<double>(Clock::now() - call).count());
+    } while (std::chrono::duration<double>(Clock::now() - start).count() < 0.3);
+
+    return fastest;
+}
+
+///@{
+/// Channel c of the pixel at (x, y), and setting it, through the accessors a user loop would use
+static uint8_t channel(const BMP_8bit &n, const int32_t &x, const int32_t &y, const uint8_t &) {
+    return n(x, y);
+}
+
+static uint8_t channel(const BMP_24bit &n, const int32_t &x, const int32_t &y, const uint8_t &c) {
+    return n.getPixel(x, y) >> 8 * c;
+}
+
+static void setChannels(BMP_8bit &n, const int32_t &x, const int32_t &y, const double *values) {
+    n(x, y) = static_cast<uint8_t>(std::min(255.0, std::max(0.0, std::round(values[0]))));
+}
+
+static void setChannels(BMP_24bit &n, const int32_t &x, const int32_t &y, const double *values) {
+    uint32_t colour = 0;
+    for (uint8_t c = 0; c < 3; ++c)
+        colour |= static_cast<uint32_t>(std::min(255.0, std::max(0.0, std::round(values[c])))) << 8 * c;
+    n.setPixel(x, y, colour);
+}
+///@}
+
+/// Number of channels read by channel()
+template<typename Image>
+static uint8_t channels() {
+    return sizeof(typename Image::Pixel) == 1 ? 1 : 3;
+}
+
+/// Convolves with the same kernel along the rows, then along the columns
+template<typename Image>
+static Image naiveConvolve(const Image &n, const std::vector<double> &kernel) {
+    const int32_t w = n.getInfoHeader().biWidth, h = std::abs(n.getInfoHeader().biHeight);
+    const int32_t radius = static_cast<int32_t>(kernel.size() / 2);
+    Image rows(n), out(n);
+
+    for (uint8_t pass = 0; pass < 2; ++pass) {
+        const Image &src = pass ? rows : n;
+        Image &dst = pass ? out : rows;
+        for (int32_t y = 0; y < h; ++y) {
+            for (int32_t x = 0; x < w; ++x) {
+                double sums[3] = {};
+                for (int32_t k = -radius; k <= radius; ++k) {
+                    const int32_t sx = pass ? x : std::min(w - 1, std::max(0, x + k));
+                    const int32_t sy = pass ? std::min(h - 1, std::max(0, y + k)) : y;
+                    for (uint8_t c = 0; c < channels<Image>(); ++c)
+                        sums[c] += kernel[k + radius] * channel(src, sx, sy, c);
+                }
+                setChannels(dst, x, y, sums);
+            }
+        }
+    }
+
+    return out;
+}
+
+/// Gaussian kernel cut off at 3 standard deviations, as gaussianBlur uses
+static std::vector<double> gaussian(const double &sigma) {
+    const int32_t radius = static_cast<int32_t>(std::ceil(3 * sigma));
+    std::vector<double> kernel(2 * radius + 1);
+    double total = 0;
+    for (int32_t i = -radius; i <= radius; ++i)
+        total += kernel[i + radius] = std::exp(-i * i / (2 * sigma * sigma));
+    for (double &k : kernel)
+        k /= total;
+
+    return kernel;
+}
+
+/// Adds amount times the difference from the naive Gaussian blur, leaving channels within threshold of it
+template<typename Image>
+static Image naiveUnsharpMask(const Image &n, const double &sigma, const double &amount, const uint8_t &threshold) {
+    const int32_t w = n.getInfoHeader().biWidth, h = std::abs(n.getInfoHeader().biHeight);
+    const Image blurred = naiveConvolve(n, gaussian(sigma));
+    Image out(n);
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x) {
+            double values[3];
+            for (uint8_t c = 0; c < channels<Image>(); ++c) {
+                const int32_t value = channel(n, x, y, c), difference = value - channel(blurred, x, y, c);
+                values[c] = std::abs(difference) < threshold ? value : value + amount * difference;
+            }
+            setChannels(out, x, y, values);
+        }
+    }
+
+    return out;
+}
+
+/// Prints the time and throughput of BMP_Filter and of the naive filter on one line
+template<typename F, typename G>
+static void row(const std::string &name, const double &megapixels, F filter, G naive) {
+    const double seconds = best(filter), naiveSeconds = best(naive);
+    std::printf("%-28s | %8.2f ms %6.0f MP/s | %8.2f ms %6.0f MP/s | %5.1fx\n", name.c_str(), seconds * 1e3,
+                megapixels / seconds, naiveSeconds * 1e3, megapixels / naiveSeconds, naiveSeconds / seconds);
+}
+
+/// Prints the rows of every filter for an image
+template<typename Image>
+static void filters(const std::string &name, const Image &n) {
+    const int32_t w = n.getInfoHeader().biWidth, h = std::abs(n.getInfoHeader().biHeight);
+    const double megapixels = w * static_cast<double>(h) / 1e6;
+
+    for (const double &sigma : {1.0, 3.0}) {
+        row(name + " gaussianBlur " + std::to_string(static_cast<int>(sigma)), megapixels,
+            [&]() -> void { BMP_Filter::gaussianBlur(n, sigma); },
+            [&]() -> void { naiveConvolve(n, gaussian(sigma)); });
+    }
+
+    for (const uint32_t &radius : {2u, 8u}) {
+        row(name + " boxBlur " + std::to_string(radius), megapixels,
+            [&]() -> void { BMP_Filter::boxBlur(n, radius); },
+            [&]() -> void { naiveConvolve(n, std::vector<double>(2 * radius + 1, 1.0 / (2 * radius + 1))); });
+    }
+
+    row(name + " unsharpMask 2", megapixels, [&]() -> void { BMP_Filter::unsharpMask(n, 2, 1.5, 4); },
+        [&]() -> void { naiveUnsharpMask(n, 2, 1.5, 4); });
+}
+
+int main(int argc, char **argv) {
+    const int32_t w = argc > 2 ? std::atoi(argv[1]) : 1920, h = argc > 2 ? std::atoi(argv[2]) : 1080;
+    std::mt19937 random(42);
+
+    BMP_8bit grey(w, h);
+    BMP_24bit rgb(w, h);
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x) {
+            const uint32_t noise = random();
+            grey.view().row(y)[x] = static_cast<uint8_t>(noise);
+            rgb.view().row(y)[x] = {static_cast<uint8_t>(noise), static_cast<uint8_t>(x), static_cast<uint8_t>(y)};
+        }
+    }
+
+    std::printf("%dx%d source, %u threads, filter | BMP_Filter | naive loop | speed-up\n", w, h,
+                std::thread::hardware_concurrency());
+    filters("8-bit", grey);
+    filters("24-bit", rgb);
+
+    return 0;
+}
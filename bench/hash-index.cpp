@@ -0,0 +1,104 @@
+/**
+ * @brief Benchmark of BMP_Hash and BMP_HashIndex: hash throughput, then insertion and query latency of an index.
+ *
+ * Build from the repository root, then run with the number of hashes in the index (10 000 000 by default):
+ *
+ *     g++ -std=gnu++11 -O2 -march=native -pthread -I. bench/hash-index.cpp bmp*.cpp -o hash-index
+ *     ./hash-index [hashes]
+ *
+ * A quarter of the queries are random hashes, the others are hashes of the index with a few bits flipped, so that both
+ * empty and non-empty results are timed. Latencies are printed as the median, 99th percentile and mean per query.
+ */
+#include "bmp_24-bit.h"
+#include "bmp_hash.h"
+#include "bmp_hash-index.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+/// Seconds since start
+static double since(const Clock::time_point &start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// Times a function over repeated calls for at least 0.5 s, returns the seconds per call
+template<typename F>
+static double perCall(F f) {
+    size_t calls = 0;
+    const Clock::time_point start = Clock::now();
+    do {
+        f();
+        ++calls;
+    } while (since(start) < 0.5);
+
+    return since(start) / calls;
+}
+
+int main(int argc, char **argv) {
+    const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    std::mt19937_64 random(42);
+
+    // Hash throughput, on a noisy image so the perceptual hashes see varied cells
+    BMP_24bit image(1920, 1080);
+    const BMP_24bit::View view = image.view();
+    for (int32_t y = 0; y < view.height(); ++y) {
+        for (int32_t x = 0; x < view.width(); ++x)
+            view.row(y)[x] = {static_cast<uint8_t>(random()), static_cast<uint8_t>(x), static_cast<uint8_t>(y)};
+    }
+
+    uint64_t sink = 0;
+    const double bytes = 3.0 * view.width() * view.height();
+    const double content = perCall([&]() -> void { sink ^= BMP_Hash::content(image); });
+    const double average = perCall([&]() -> void { sink ^= BMP_Hash::average(image); });
+    const double difference = perCall([&]() -> void { sink ^= BMP_Hash::difference(image); });
+    std::printf("1920x1080 24-bit: content %.2f GB/s, average %.2f ms, difference %.2f ms\n",
+                bytes / content / 1e9, average * 1e3, difference * 1e3);
+
+    // Insertion
+    std::vector<uint64_t> hashes(count);
+    for (uint64_t &hash : hashes)
+        hash = random();
+
+    BMP_HashIndex index;
+    Clock::time_point start = Clock::now();
+    index.reserve(count);
+    for (const uint64_t &hash : hashes)
+        index.add(hash);
+    const double insertion = since(start);
+    std::printf("%zu hashes: added in %.2f s, %.1f ns per hash\n", count, insertion, insertion / count * 1e9);
+
+    // Query latency by radius
+    const size_t queries = 2000;
+    for (uint8_t radius = 0; radius <= 12; radius += 2) {
+        std::vector<double> latencies;
+        size_t found = 0;
+        for (size_t q = 0; q < queries; ++q) {
+            uint64_t hash = random();
+            if (q % 4 && count) {
+                hash = hashes[random() % count];
+                for (uint8_t flip = 0; flip < radius / 2; ++flip)
+                    hash ^= 1ull << (random() % 64);
+            }
+
+            start = Clock::now();
+            found += index.query(hash, radius).size();
+            latencies.push_back(since(start));
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        double total = 0;
+        for (const double &latency : latencies)
+            total += latency;
+
+        std::printf("radius %2u: median %8.1f us, p99 %8.1f us, mean %8.1f us, %.2f matches per query\n", radius,
+                    latencies[queries / 2] * 1e6, latencies[queries * 99 / 100] * 1e6, total / queries * 1e6,
+                    static_cast<double>(found) / queries);
+    }
+
+    return sink == 1 ? 1 : 0; // Keeps the hashes from being optimised away
+}
@@ -0,0 +1,100 @@
+/**
+ * @brief Benchmark of BMP_Quantize: palette(), remap() and quantize() for a range of palette sizes on a 4K image.
+ *
+ * Build from the repository root, then run with the dimensions of the source image (3840 by 2160 by default):
+ *
+ *     g++ -std=gnu++11 -O2 -march=native -pthread -I. bench/quantize.cpp bmp*.cpp -o quantize
+ *     ./quantize [width height]
+ *
+ * Each cell is the time of one call, the best of the calls made in at least 0.3 s, and the throughput in source
+ * megapixels per second. The last column maps every pixel by searching the whole colour table on one thread, the cost
+ * that the lookup cube and the threads of remap() remove.
+ */
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_quantize.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+/// Times a function over repeated calls for at least 0.3 s, returns the seconds of the fastest call
+template<typename F>
+static double best(F f) {
+    double fastest = 1e9;
+    const Clock::time_point start = Clock::now();
+    do {
+        const Clock::time_point call = Clock::now();
+        f();
+        fastest = std::min(fastest, std::chrono::duration<double>(Clock::now() - call).count());
+    } while (std::chrono::duration<double>(Clock::now() - start).count() < 0.3);
+
+    return fastest;
+}
+
+/// Maps every pixel to the closest entry of a colour table by trying every entry, the reference for remap()
+static BMP_8bit linearSearch(const BMP_24bit &n, const std::vector<uint8_t> &colourTable) {
+    const BMP_24bit::ConstView src = n.view();
+    BMP_8bit out(src.width(), n.getInfoHeader().biHeight);
+    out.setColourTable(colourTable);
+    const BMP_8bit::View dst = out.view();
+    const size_t entries = colourTable.size() / 4;
+
+    for (int32_t y = 0; y < src.height(); ++y) {
+        for (int32_t x = 0; x < src.width(); ++x) {
+            const BMP_24bit::Pixel &p = src.row(y)[x];
+            uint32_t closest = UINT32_MAX;
+            for (size_t i = 0; i < entries; ++i) {
+                const int32_t db = p.b - colourTable[4 * i], dg = p.g - colourTable[4 * i + 1];
+                const int32_t dr = p.r - colourTable[4 * i + 2];
+                const uint32_t distance = db * db + dg * dg + dr * dr;
+                if (distance < closest) {
+                    closest = distance;
+                    dst.row(y)[x] = static_cast<uint8_t>(i);
+                }
+            }
+        }
+    }
+
+    return out;
+}
+
+int main(int argc, char **argv) {
+    const int32_t w = argc > 2 ? std::atoi(argv[1]) : 3840, h = argc > 2 ? std::atoi(argv[2]) : 2160;
+    const double megapixels = w * static_cast<double>(h) / 1e6;
+    std::mt19937 random(42);
+
+    // Smooth gradients with some noise, so that the histogram has many occupied cells like a photograph
+    BMP_24bit n(w, h);
+    const BMP_24bit::View view = n.view();
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x) {
+            const uint32_t noise = random() % 24;
+            view.row(y)[x] = {static_cast<uint8_t>((x * 255 / w + noise) & 0xFF),
+                              static_cast<uint8_t>((y * 255 / h + noise) & 0xFF),
+                              static_cast<uint8_t>(((x + y) * 127 / (w + h) + 2 * noise) & 0xFF)};
+        }
+    }
+
+    std::printf("%dx%d source, %u threads, colours | palette | remap | quantize | linear search\n", w, h,
+                std::thread::hardware_concurrency());
+    for (const int &colours : {16, 64, 256}) {
+        const std::vector<uint8_t> colourTable = BMP_Quantize::palette(n, colours);
+        const double palette = best([&]() -> void { BMP_Quantize::palette(n, colours); });
+        const double remap = best([&]() -> void { BMP_Quantize::remap(n, colourTable); });
+        const double quantize = best([&]() -> void { BMP_Quantize::quantize(n, colours); });
+        const double linear = best([&]() -> void { linearSearch(n, colourTable); });
+
+        std::printf("%3d", colours);
+        for (const double &seconds : {palette, remap, quantize, linear})
+            std::printf(" | %8.2f ms %6.0f MP/s", seconds * 1e3, megapixels / seconds);
+        std::printf("\n");
+    }
+
+    return 0;
+}
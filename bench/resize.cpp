@@ -0,0 +1,99 @@
+/**
+ * @brief Benchmark of BMP_Resize: every filter at a range of scales, for 8-bit, 24-bit and 32-bit images.
+ *
+ * Build from the repository root, then run with the dimensions of the source image (1920 by 1080 by default):
+ *
+ *     g++ -std=gnu++11 -O2 -march=native -pthread -I. bench/resize.cpp bmp*.cpp -o resize
+ *     ./resize [width height]
+ *
+ * Each cell is the time of one resize, the best of the calls made in at least 0.3 s, and the throughput in source
+ * megapixels per second. The 8-bit image has the default grey colour table, the colour table path is timed separately.
+ */
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include "bmp_resize.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+/// Times a function over repeated calls for at least 0.3 s, returns the seconds of the fastest call
+template<typename F>
+static double best(F f) {
+    double fastest = 1e9;
+    const Clock::time_point start = Clock::now();
+    do {
+        const Clock::time_point call = Clock::now();
+        f();
+        fastest = std::min(fastest, std::chrono::duration<double>(Clock::now() - call).count());
+    } while (std::chrono::duration<double>(Clock::now() - start).count() < 0.3);
+
+    return fastest;
+}
+
+/// Prints a row of the matrix: one cell per scale, for one filter
+template<typename Image>
+static void row(const std::string &name, const Image &n, const BMP_Resize::Filter &filter, const char *filterName) {
+    static const double scales[] = {0.25, 0.5, 0.75, 1.5, 2};
+    const int32_t w = n.getInfoHeader().biWidth, h = std::abs(n.getInfoHeader().biHeight);
+    const double megapixels = w * static_cast<double>(h) / 1e6;
+
+    std::printf("%-8s %-9s", name.c_str(), filterName);
+    for (const double &scale : scales) {
+        const int32_t dw = std::max(1, static_cast<int32_t>(w * scale));
+        const int32_t dh = std::max(1, static_cast<int32_t>(h * scale));
+        const double seconds = best([&]() -> void { BMP_Resize::resize(n, dw, dh, filter); });
+        std::printf(" | %7.2f ms %6.0f MP/s", seconds * 1e3, megapixels / seconds);
+    }
+    std::printf("\n");
+}
+
+/// Prints the matrix of every filter and scale
+template<typename Image>
+static void matrix(const std::string &name, const Image &n) {
+    row(name, n, BMP_Resize::Filter::box, "box");
+    row(name, n, BMP_Resize::Filter::bilinear, "bilinear");
+    row(name, n, BMP_Resize::Filter::bicubic, "bicubic");
+    row(name, n, BMP_Resize::Filter::lanczos3, "lanczos3");
+}
+
+int main(int argc, char **argv) {
+    const int32_t w = argc > 2 ? std::atoi(argv[1]) : 1920, h = argc > 2 ? std::atoi(argv[2]) : 1080;
+    std::mt19937 random(42);
+
+    BMP_8bit grey(w, h), colour(w, h);
+    BMP_24bit rgb(w, h);
+    BMP_32bit rgba(w, h);
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x) {
+            const uint32_t noise = random();
+            grey.view().row(y)[x] = static_cast<uint8_t>(noise);
+            colour.view().row(y)[x] = static_cast<uint8_t>(noise % 16);
+            rgb.view().row(y)[x] = {static_cast<uint8_t>(noise), static_cast<uint8_t>(x), static_cast<uint8_t>(y)};
+            rgba.view().row(y)[x] = noise;
+        }
+    }
+
+    // 16 colours, so the 8-bit image goes through its colour table
+    std::vector<uint8_t> colourTable;
+    for (uint32_t i = 0; i < 16; ++i) {
+        const uint8_t entry[4] = {static_cast<uint8_t>(i * 16), static_cast<uint8_t>(255 - i * 16),
+                                  static_cast<uint8_t>(i * 37), 0};
+        colourTable.insert(colourTable.end(), entry, entry + 4);
+    }
+    colour.setColourTable(colourTable);
+
+    std::printf("%dx%d source, scales 0.25 | 0.5 | 0.75 | 1.5 | 2\n", w, h);
+    matrix("8-bit", grey);
+    matrix("8-bit ct", colour);
+    matrix("24-bit", rgb);
+    matrix("32-bit", rgba);
+
+    return 0;
+}
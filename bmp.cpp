@@ -1,10 +1,13 @@
 #include "bmp.h"
 #include <iostream>
 #include <cstdlib>
+#include <vector>
+#include <cstring>
+#include <sys/stat.h>
 
 static constexpr uint16_t BM = 'B' + ('M' << 8); // Little-endian
 
-BMP::BMP() : fileHeader({0}), infoHeader({0}) {
+BMP::BMP() : fileHeader({0}), infoHeader({0}), bottomUp(false) {
     fileHeader.bfType = BM;
     infoHeader.biPlanes = 1;
     infoHeader.biSize = 40;
@@ -14,10 +17,7 @@ BMP::BMP(const std::string &filename) : BMP() {
     std::ifstream f(filename, std::ios::binary);
 
     // Check if the file exists
-    if (!f) {
-        std::cerr << "BMP: The file does not exist." << std::endl;
-        std::exit(1);
-    }
+    assertInvalidFile(f);
 
     // Read in headers
     f.read(reinterpret_cast<char *>(&fileHeader.bfType), sizeof(fileHeader.bfType));
@@ -59,62 +59,176 @@ BMP::BMP(const int32_t &w, const int32_t &h) : BMP() {
 }
 
 size_t BMP::getRowSize() const {
-    return (infoHeader.biBitCount * infoHeader.biWidth + 31) / 32 * 4;
+    return getRowSize(infoHeader.biWidth);
 }
 
-bool BMP::save(std::ofstream &f) const {
+size_t BMP::getRowSize(const int32_t &w) const {
+    return (static_cast<size_t>(infoHeader.biBitCount) * w + 31) / 32 * 4;
+}
+
+std::streamoff BMP::getFileOffset(const int32_t &x, const int32_t &y) const {
+    const int32_t row = infoHeader.biHeight < 0 ? y : infoHeader.biHeight - 1 - y; // Row number in the file
+
+    return fileHeader.bfOffBits + static_cast<std::streamoff>(row) * getRowSize() +
+           static_cast<std::streamoff>(x) * infoHeader.biBitCount / 8;
+}
+
+void BMP::setDimensions(const int32_t &w, const int32_t &h) {
+    infoHeader.biWidth = w;
+    infoHeader.biHeight = infoHeader.biHeight < 0 ? -h : h;
+    infoHeader.biSizeImage = getRowSize() * h;
+    fileHeader.bfSize = fileHeader.bfOffBits + infoHeader.biSizeImage;
+}
+
+void BMP::readSubsampledRows(std::ifstream &f, const uint32_t &factor,
+                             const std::function<void(const int32_t &, const uint8_t *)> &row) const {
+    const int32_t h = (std::abs(infoHeader.biHeight) + factor - 1) / factor;
+    std::vector<uint8_t> buf(getRowSize());
+
+    for (int32_t i = 0; i < h; ++i) {
+        const int32_t y = infoHeader.biHeight < 0 ? i : h - 1 - i; // Row in the subsampled image
+
+        f.seekg(getFileOffset(0, y * factor));
+        f.read(reinterpret_cast<char *>(&buf[0]), buf.size());
+        row(y, &buf[0]);
+    }
+}
+
+bool BMP::save(std::ofstream &f, const int32_t &w, const int32_t &h) const {
     // Check if the file has been successfully opened
     if (!f) {
         std::cerr << "BMP: The file location cannot be accessed." << std::endl;
         return false;
     }
 
+    // Headers for a w by h image
+    FileHeader file = fileHeader;
+    InfoHeader info = infoHeader;
+    info.biWidth = w;
+    info.biHeight = infoHeader.biHeight < 0 ? -h : h;
+    info.biSizeImage = getRowSize(w) * h;
+    file.bfSize = file.bfOffBits + info.biSizeImage;
+
     // Write headers
-    f.write(reinterpret_cast<const char *>(&fileHeader.bfType), sizeof(fileHeader.bfType));
-    f.write(reinterpret_cast<const char *>(&fileHeader.bfSize), sizeof(fileHeader.bfSize));
-    f.write(reinterpret_cast<const char *>(&fileHeader.bfReserved1), sizeof(fileHeader.bfReserved1));
-    f.write(reinterpret_cast<const char *>(&fileHeader.bfReserved2), sizeof(fileHeader.bfReserved2));
-    f.write(reinterpret_cast<const char *>(&fileHeader.bfOffBits), sizeof(fileHeader.bfOffBits));
-
-    f.write(reinterpret_cast<const char *>(&infoHeader.biSize), sizeof(infoHeader.biSize));
-    f.write(reinterpret_cast<const char *>(&infoHeader.biWidth), sizeof(infoHeader.biWidth));
-    f.write(reinterpret_cast<const char *>(&infoHeader.biHeight), sizeof(infoHeader.biHeight));
-    f.write(reinterpret_cast<const char *>(&infoHeader.biPlanes), sizeof(infoHeader.biPlanes));
-    f.write(reinterpret_cast<const char *>(&infoHeader.biBitCount), sizeof(infoHeader.biBitCount));
-    f.write(reinterpret_cast<const char *>(&infoHeader.biCompression), sizeof(infoHeader.biCompression));
-    f.write(reinterpret_cast<const char *>(&infoHeader.biSizeImage), sizeof(infoHeader.biSizeImage));
-    f.write(reinterpret_cast<const char *>(&infoHeader.biXPelsPerMeter), sizeof(infoHeader.biXPelsPerMeter));
-    f.write(reinterpret_cast<const char *>(&infoHeader.biYPelsPerMeter), sizeof(infoHeader.biYPelsPerMeter));
-    f.write(reinterpret_cast<const char *>(&infoHeader.biClrUsed), sizeof(infoHeader.biClrUsed));
-    f.write(reinterpret_cast<const char *>(&infoHeader.biClrImportant), sizeof(infoHeader.biClrImportant));
+    f.write(reinterpret_cast<const char *>(&file.bfType), sizeof(file.bfType));
+    f.write(reinterpret_cast<const char *>(&file.bfSize), sizeof(file.bfSize));
+    f.write(reinterpret_cast<const char *>(&file.bfReserved1), sizeof(file.bfReserved1));
+    f.write(reinterpret_cast<const char *>(&file.bfReserved2), sizeof(file.bfReserved2));
+    f.write(reinterpret_cast<const char *>(&file.bfOffBits), sizeof(file.bfOffBits));
+
+    f.write(reinterpret_cast<const char *>(&info.biSize), sizeof(info.biSize));
+    f.write(reinterpret_cast<const char *>(&info.biWidth), sizeof(info.biWidth));
+    f.write(reinterpret_cast<const char *>(&info.biHeight), sizeof(info.biHeight));
+    f.write(reinterpret_cast<const char *>(&info.biPlanes), sizeof(info.biPlanes));
+    f.write(reinterpret_cast<const char *>(&info.biBitCount), sizeof(info.biBitCount));
+    f.write(reinterpret_cast<const char *>(&info.biCompression), sizeof(info.biCompression));
+    f.write(reinterpret_cast<const char *>(&info.biSizeImage), sizeof(info.biSizeImage));
+    f.write(reinterpret_cast<const char *>(&info.biXPelsPerMeter), sizeof(info.biXPelsPerMeter));
+    f.write(reinterpret_cast<const char *>(&info.biYPelsPerMeter), sizeof(info.biYPelsPerMeter));
+    f.write(reinterpret_cast<const char *>(&info.biClrUsed), sizeof(info.biClrUsed));
+    f.write(reinterpret_cast<const char *>(&info.biClrImportant), sizeof(info.biClrImportant));
 
     return true;
 }
 
-size_t BMP::getIndex(const int32_t &x, const int32_t &y) const {
-    assertInvalidIndex(x, y);
+bool BMP::mapPixels(const uint8_t *data, const size_t &size, const uint16_t &bitCount, const uint8_t *&origin,
+                    int32_t &w, int32_t &h, ptrdiff_t &stride) {
+    // Read the fields needed from the headers, they are not aligned
+    const auto field = [&](const size_t &offset, void *dst, const size_t &n) -> void {
+        std::memcpy(dst, data + offset, n);
+    };
+
+    if (size < fileHeaderSize + 40u) {
+        std::cerr << "BMP: The data is too small to be a BMP file." << std::endl;
+        return false;
+    }
+
+    uint16_t bfType = 0, biBitCount = 0;
+    uint32_t bfOffBits = 0, biSize = 0, biCompression = 0;
+    int32_t biWidth = 0, biHeight = 0;
+    field(0, &bfType, sizeof(bfType));
+    field(10, &bfOffBits, sizeof(bfOffBits));
+    field(14, &biSize, sizeof(biSize));
+    field(18, &biWidth, sizeof(biWidth));
+    field(22, &biHeight, sizeof(biHeight));
+    field(28, &biBitCount, sizeof(biBitCount));
+    field(30, &biCompression, sizeof(biCompression));
 
-    return y * infoHeader.biWidth + x;
+    // Check if the format is supported
+    if (bfType != BM || biSize != 40 || (biCompression != 0 && biCompression != 3) || biWidth < 0) {
+        std::cerr << "BMP: This format is not supported." << std::endl;
+        return false;
+    }
+
+    if (biBitCount != bitCount) {
+        std::cerr << "BMP: This is not a " << bitCount << "-bit BMP file." << std::endl;
+        return false;
+    }
+
+    const size_t rowSize = (static_cast<size_t>(biBitCount) * biWidth + 31) / 32 * 4;
+    if (bfOffBits > size || rowSize * std::abs(biHeight) > size - bfOffBits) {
+        std::cerr << "BMP: The pixel array is incomplete." << std::endl;
+        return false;
+    }
+
+    w = biWidth;
+    h = std::abs(biHeight);
+    stride = biHeight < 0 ? rowSize : -static_cast<ptrdiff_t>(rowSize);
+    origin = data + bfOffBits + (biHeight < 0 ? 0 : rowSize * (h - 1)); // Bottom-up files start from the bottom row
+
+    return true;
+}
+
+ptrdiff_t BMP::getStride(const size_t &rowSize) const {
+    return bottomUp ? -static_cast<ptrdiff_t>(rowSize) : static_cast<ptrdiff_t>(rowSize);
 }
 
-bool BMP::validIndex(const size_t &index) const {
-    return index < infoHeader.biWidth * std::abs(infoHeader.biHeight);
+bool BMP::validRegion(const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h) const {
+    return x >= 0 && y >= 0 && w > 0 && h > 0 && static_cast<int64_t>(x) + w <= infoHeader.biWidth &&
+           static_cast<int64_t>(y) + h <= std::abs(infoHeader.biHeight);
 }
 
-bool BMP::validIndex(const int32_t &x, const int32_t &y) const {
-    return x >= 0 && x < infoHeader.biWidth && y >= 0 && y < std::abs(infoHeader.biHeight);
+void BMP::assertInvalidRegion(const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h) const {
+    if (!validRegion(x, y, w, h)) {
+        std::cerr << "BMP: Region out of bounds" << std::endl;
+        std::exit(1);
+    }
 }
 
-void BMP::assertInvalidIndex(const size_t &index) const {
-    if (!validIndex(index)) {
-        assertInvalidIndex();
+void BMP::assertInvalidFile(const std::ifstream &f) {
+    if (!f) {
+        std::cerr << "BMP: The file does not exist." << std::endl;
         std::exit(1);
     }
 }
 
-void BMP::assertInvalidIndex(const int32_t &x, const int32_t &y) const {
-    if (!validIndex(x, y)) {
-        assertInvalidIndex();
+BMP::FileStamp BMP::getFileStamp(const std::string &filename) {
+    struct stat file;
+    if (stat(filename.c_str(), &file) != 0)
+        return {0, 0};
+
+    return {static_cast<int64_t>(file.st_mtime), static_cast<uint64_t>(file.st_size)};
+}
+
+bool BMP::openUnchanged(std::ifstream &f, const std::string &filename, const FileStamp &stamp) {
+    const FileStamp now = getFileStamp(filename);
+    if (now.mtime != stamp.mtime || now.size != stamp.size) {
+        std::cerr << "BMP: The file was changed or removed since the image was constructed." << std::endl;
+        return false;
+    }
+
+    f.open(filename, std::ios::binary);
+    if (!f) {
+        std::cerr << "BMP: The file does not exist." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void BMP::assertInvalidFactor(const uint32_t &factor) {
+    if (!factor) {
+        std::cerr << "BMP: Subsampling factor must be at least 1" << std::endl;
         std::exit(1);
     }
 }
@@ -123,6 +237,11 @@ void BMP::assertInvalidIndex() {
     std::cerr << "BMP: Index out of bounds" << std::endl;
 }
 
+void BMP::flipVertical() {
+    infoHeader.biHeight = -infoHeader.biHeight;
+    bottomUp = !bottomUp;
+}
+
 const BMP::FileHeader &BMP::getFileHeader() const {
     return fileHeader;
 }
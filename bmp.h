@@ -3,9 +3,11 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <cstdlib>
 #include <climits>
 #include <string>
 #include <fstream>
+#include <functional>
 
 /**
  * @mainpage tearfur's BMP Library
@@ -48,12 +50,98 @@ protected:
     /// To get the size in bytes for each row in memory.
     size_t getRowSize() const;
 
-    /// Performs all the common functions for save.
-    bool save(std::ofstream &f) const;
+    /// To get the size in bytes for each row in memory, for an image with the same bit count but w pixels wide.
+    size_t getRowSize(const int32_t &w) const;
+
+    /**
+     * @brief Position of the byte containing pixel (x, y) in the file, user does not need to handle row-order.
+     *
+     * Only meaningful while the headers still describe the file being read.
+     */
+    std::streamoff getFileOffset(const int32_t &x, const int32_t &y) const;
+
+    /**
+     * @brief Changes the dimensions of the image, and updates biSizeImage and bfSize to match.
+     *
+     * The row-order of the image is kept.
+     *
+     * @param w[in] New width
+     * @param h[in] New height, positive only
+     */
+    void setDimensions(const int32_t &w, const int32_t &h);
+
+    /**
+     * @brief Reads every factor-th row of the pixel array in file order, starting from the top row.
+     *
+     * Each row is read whole, one read per row, see Sampling.
+     *
+     * @param f[in] The file
+     * @param factor[in] Subsampling factor, must be at least 1
+     * @param row[in] Called with the row number in the subsampled image and the bytes of the row in the file
+     */
+    void readSubsampledRows(std::ifstream &f, const uint32_t &factor,
+                            const std::function<void(const int32_t &, const uint8_t *)> &row) const;
+
+    /// Size and modification time of a file, taken when it is read
+    struct FileStamp {
+        int64_t mtime;
+        uint64_t size;
+    };
+
+    /// Returns the size and modification time of a file, both 0 if it does not exist.
+    static FileStamp getFileStamp(const std::string &filename);
+
+    /**
+     * @brief Opens a file for a lazy loader, if it is unchanged since the stamp was taken.
+     *
+     * Does not exit, as it is called from the first pixel access: prints an error and returns false if the file cannot
+     * be opened or its size or modification time changed, see Decode::lazy.
+     *
+     * @param f[out] The file, opened in binary mode
+     * @param filename[in] Name of the file
+     * @param stamp[in] Stamp taken in the constructor
+     * @return Whether the file is open and unchanged
+     */
+    static bool openUnchanged(std::ifstream &f, const std::string &filename, const FileStamp &stamp);
+
+    /**
+     * @brief Performs all the common functions for save.
+     *
+     * The headers are written for a w by h image, as the pixels saved may come from a view of a different size.
+     */
+    bool save(std::ofstream &f, const int32_t &w, const int32_t &h) const;
+
+    /**
+     * @brief Finds the pixel array of a BMP file that is already in memory (e.g. a memory-mapped file).
+     *
+     * @param data[in] The whole file
+     * @param size[in] Size of data in bytes
+     * @param bitCount[in] Expected bits per pixel
+     * @param origin[out] First byte of the top row
+     * @param w[out] Width
+     * @param h[out] Height, positive only
+     * @param stride[out] Distance in bytes from the start of a row to the start of the row below
+     * @return Whether data is a supported, complete BMP file with the expected bit count
+     */
+    static bool mapPixels(const uint8_t *data, const size_t &size, const uint16_t &bitCount, const uint8_t *&origin,
+                          int32_t &w, int32_t &h, ptrdiff_t &stride);
 
     /// Returns the index for a certain x, y.
     size_t getIndex(const int32_t &x, const int32_t &y) const;
 
+    /// Returns the index in memory of the pixel at an index counted row by row from the top-left corner of the image.
+    size_t getIndex(const size_t &index) const;
+
+    /// Row of the pixel array in memory holding row y of the image, see bottomUp.
+    int32_t getRow(const int32_t &y) const;
+
+    /**
+     * @brief Distance in bytes from the start of a row in memory to the start of the row below it in the image.
+     *
+     * @param rowSize[in] Size in bytes of a row in memory
+     */
+    ptrdiff_t getStride(const size_t &rowSize) const;
+
     /**
      * @{
      * @brief Assert: Invalid img index
@@ -63,6 +151,15 @@ protected:
     void assertInvalidIndex(const int32_t &x, const int32_t &y) const;
     ///@}
 
+    /// Assert: The file could not be opened
+    static void assertInvalidFile(const std::ifstream &f);
+
+    /// Assert: Subsampling factor is 0
+    static void assertInvalidFactor(const uint32_t &factor);
+
+    /// Assert: Region not inside the image
+    void assertInvalidRegion(const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h) const;
+
     /// Assignment operator
     BMP &operator=(const BMP &n) = default;
 
@@ -80,6 +177,44 @@ private:
     static void assertInvalidIndex();
 
 public:
+    /**
+     * @brief How columns are sampled when decoding a subsampled image.
+     *
+     * Rows are always point-sampled, so that only every n-th row has to be read from the file. Those rows are read
+     * whole with either sampling: the pixels skipped within a row are a few bytes apart, and the file is read from the
+     * disk in pages, so skipping them would not read less. Subsampling by n therefore reads about 1 / n of the pixel
+     * array, not 1 / (n * n).
+     */
+    enum class Sampling {
+        point, ///< Take the first pixel of every n pixels
+        box ///< Average every n pixels
+    };
+
+    /**
+     * @brief When the pixels of an image read from a file are decoded.
+     *
+     * A lazily decoded image reads the file again on the first access. If the file was removed, or its size or
+     * modification time changed since the constructor, an error is printed and every pixel is left 0 instead of
+     * exiting or decoding different content.
+     */
+    enum class Decode {
+        eager, ///< In the constructor
+        lazy ///< The first time the pixels are accessed or saved, the constructor only reads the headers
+    };
+
+    /**
+     * @brief How the rows of an image are laid out in memory.
+     *
+     * With a padded layout, the rows are stored in the order of the file (bottom-up unless the height is negative) and
+     * start at a 64-byte boundary if the stride is a multiple of 64 bytes. Accessors taking a plain index still count
+     * the pixels row by row from the top-left corner, skipping the padding.
+     */
+    enum class Layout {
+        packed, ///< Rows are width pixels apart, the default
+        file, ///< Rows are as far apart as in the file (padded to 4 bytes), read and saved with one call
+        aligned ///< Rows are as far apart as in the file, rounded up to 64 bytes, so every row is cache-line aligned
+    };
+
     // https://learn.microsoft.com/en-us/windows/win32/api/wingdi/ns-wingdi-bitmapfileheader
     struct FileHeader {
         uint16_t bfType;
@@ -111,6 +246,9 @@ protected:
     /// BITMAPINFOHEADER
     InfoHeader infoHeader;
 
+    /// Whether the rows are stored bottom-up in memory (top-down otherwise), toggled by flipVertical()
+    bool bottomUp;
+
 public:
     /**
      * @brief Accessor function to get the bitmap file header
@@ -132,6 +270,61 @@ public:
 
     bool validIndex(const int32_t &x, const int32_t &y) const;
     ///@}
+
+    /// Check if a non-empty region with top-left corner (x, y) lies inside the image
+    bool validRegion(const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h) const;
+
+    /**
+     * @brief Flips the image upside down in O(1), no pixels are moved.
+     *
+     * The sign of biHeight is negated and the rows in memory are reinterpreted in the opposite order, so the image is
+     * still saved with the same bytes in the same order, only the header changes. Views, (x, y) accessors and accessors
+     * taking a plain index all see the flipped image: index y * width + x is the pixel at (x, y).
+     */
+    void flipVertical();
 };
 
+// Called for every pixel access, so defined here to be inlined
+
+inline size_t BMP::getIndex(const int32_t &x, const int32_t &y) const {
+    assertInvalidIndex(x, y);
+
+    return static_cast<size_t>(getRow(y)) * infoHeader.biWidth + x;
+}
+
+inline size_t BMP::getIndex(const size_t &index) const {
+    assertInvalidIndex(index);
+    if (!bottomUp)
+        return index;
+
+    const size_t w = infoHeader.biWidth;
+    return static_cast<size_t>(getRow(static_cast<int32_t>(index / w))) * w + index % w;
+}
+
+inline int32_t BMP::getRow(const int32_t &y) const {
+    return bottomUp ? std::abs(infoHeader.biHeight) - 1 - y : y;
+}
+
+inline bool BMP::validIndex(const size_t &index) const {
+    return index < static_cast<size_t>(infoHeader.biWidth) * std::abs(infoHeader.biHeight);
+}
+
+inline bool BMP::validIndex(const int32_t &x, const int32_t &y) const {
+    return x >= 0 && x < infoHeader.biWidth && y >= 0 && y < std::abs(infoHeader.biHeight);
+}
+
+inline void BMP::assertInvalidIndex(const size_t &index) const {
+    if (!validIndex(index)) {
+        assertInvalidIndex();
+        std::exit(1);
+    }
+}
+
+inline void BMP::assertInvalidIndex(const int32_t &x, const int32_t &y) const {
+    if (!validIndex(x, y)) {
+        assertInvalidIndex();
+        std::exit(1);
+    }
+}
+
 #endif //BMP_BMP_H
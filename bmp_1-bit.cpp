@@ -2,8 +2,9 @@
 #include <fstream>
 #include <cstddef>
 #include <cstdlib>
+#include <algorithm>
 
-BMP_1bit::BMP_1bit(const std::string &filename) : BMP_CT(filename) {
+BMP_1bit::BMP_1bit(const std::string &filename, const Decode &decode) : BMP_CT(filename) {
     if (infoHeader.biBitCount != 1) {
         std::cerr << "BMP_1bit: This is not a 1-bit BMP file." << std::endl;
         std::exit(1);
@@ -22,42 +23,108 @@ BMP_1bit::BMP_1bit(const std::string &filename) : BMP_CT(filename) {
     // Read colour table.
     readClrTable(f);
 
-    f.seekg(fileHeader.bfOffBits); // Seek to the start of image array
+    f.close();
+
+    // Read image data into img, now or the first time it is accessed
+    const int32_t w = infoHeader.biWidth, h = infoHeader.biHeight;
+    const uint32_t offset = fileHeader.bfOffBits;
+    const size_t rowSize = getRowSize(); // Size of each row in bytes, including padding
+    const FileStamp stamp = getFileStamp(filename);
+    img.setLoader([filename, stamp, w, h, offset, rowSize](std::vector<Pixel> &img) -> void {
+        img.resize(static_cast<size_t>(w) * std::abs(h)); // Left 0 if the file changed
+        std::ifstream f;
+        if (!openUnchanged(f, filename, stamp))
+            return;
 
-    const size_t padSize = getRowSize() - (infoHeader.biWidth + 7) / 8; // Size of padding on each row in bytes
+        f.seekg(offset); // Seek to the start of image array
 
-    // Read image data into img
-    uint8_t buf = 0; // For storing each byte read
-    img.resize(infoHeader.biWidth * std::abs(infoHeader.biHeight));
-    if (infoHeader.biHeight < 0) { // Check if height is positive or negative
-        for (int32_t y = 0; y < -infoHeader.biHeight; ++y) {
-            for (int32_t x = 0; x < infoHeader.biWidth; ++x) {
-                // If divisible by 8, read the new byte (8-bits in 1 byte)
-                const uint8_t remainder = x % 8;
-                if (!remainder)
-                    f.read(reinterpret_cast<char *>(&buf), sizeof(buf));
+        std::vector<uint8_t> buf(rowSize); // For storing each row read
+        for (int32_t i = 0; i < std::abs(h); ++i) {
+            const int32_t y = h < 0 ? i : h - 1 - i; // Rows are stored bottom-up if height is positive
 
-                operator()(x, y) = buf >> (8u - 1u - remainder) & 0b1u; // Extract the bit
-            }
+            f.read(reinterpret_cast<char *>(&buf[0]), rowSize);
 
-            f.seekg(padSize, std::ios::cur); // Skip pad bytes
+            for (int32_t x = 0; x < w; ++x)
+                img[static_cast<size_t>(y) * w + x] = buf[x / 8] >> (8u - 1u - x % 8) & 0b1u; // Extract the bit
         }
-    } else {
-        for (int32_t y = infoHeader.biHeight - 1; y >= 0; --y) {
-            for (int32_t x = 0; x < infoHeader.biWidth; ++x) {
-                // If divisible by 8, read the new byte (8-bits in 1 byte)
-                const uint8_t &remainder = x % 8;
-                if (!remainder)
-                    f.read(reinterpret_cast<char *>(&buf), sizeof(buf));
 
-                operator()(x, y) = buf >> (8u - 1u - remainder) & 0b1u; // Extract the bit
-            }
+        f.close();
+    });
+
+    if (decode == Decode::eager)
+        img.load();
+}
+
+BMP_1bit::BMP_1bit(const std::string &filename, const int32_t &x, const int32_t &y, const int32_t &w,
+                   const int32_t &h) : BMP_CT(filename) {
+    if (infoHeader.biBitCount != 1) {
+        std::cerr << "BMP_1bit: This is not a 1-bit BMP file." << std::endl;
+        std::exit(1);
+    }
+
+    assertInvalidRegion(x, y, w, h);
+
+    std::ifstream f(filename, std::ios::binary);
+    f.seekg(fileHeaderSize + infoHeader.biSize); // Seek to colour table
+
+    // Read colour table.
+    readClrTable(f);
+
+    // Read image data into img, rows are read in file order and only the bytes inside the region are read
+    std::vector<uint8_t> buf((x % 8 + w + 7) / 8); // Bytes covering the region in each row
+    img.resize(static_cast<size_t>(w) * h);
+    for (int32_t i = 0; i < h; ++i) {
+        const int32_t row = infoHeader.biHeight < 0 ? i : h - 1 - i; // Row inside the region
+
+        f.seekg(getFileOffset(x, y + row));
+        f.read(reinterpret_cast<char *>(&buf[0]), buf.size());
 
-            f.seekg(padSize, std::ios::cur); // Skip pad bytes
+        for (int32_t j = 0; j < w; ++j) {
+            const uint32_t bit = x % 8 + j; // Bit position counting from the start of buf
+            img[static_cast<size_t>(row) * w + j] = buf[bit / 8] >> (8u - 1u - bit % 8) & 0b1u; // Extract the bit
         }
     }
 
     f.close();
+
+    setDimensions(w, h);
+}
+
+BMP_1bit::BMP_1bit(const std::string &filename, const uint32_t &factor, const Sampling &sampling) : BMP_CT(filename) {
+    if (infoHeader.biBitCount != 1) {
+        std::cerr << "BMP_1bit: This is not a 1-bit BMP file." << std::endl;
+        std::exit(1);
+    }
+
+    assertInvalidFactor(factor);
+
+    std::ifstream f(filename, std::ios::binary);
+    f.seekg(fileHeaderSize + infoHeader.biSize); // Seek to colour table
+
+    // Read colour table.
+    readClrTable(f);
+
+    const int32_t w = (infoHeader.biWidth + factor - 1) / factor;
+    const int32_t h = (std::abs(infoHeader.biHeight) + factor - 1) / factor;
+
+    // Decode every factor-th row into img
+    std::vector<uint8_t> indices(factor); // Unpacked bits of the pixels being averaged
+    img.resize(static_cast<size_t>(w) * h);
+    readSubsampledRows(f, factor, [&](const int32_t &y, const uint8_t *src) {
+        for (int32_t x = 0; x < w; ++x) {
+            const uint32_t begin = x * factor, count = std::min<uint32_t>(factor, infoHeader.biWidth - begin);
+
+            for (uint32_t i = 0; i < (sampling == Sampling::box ? count : 1); ++i)
+                indices[i] = src[(begin + i) / 8] >> (8u - 1u - (begin + i) % 8) & 0b1u; // Extract the bit
+
+            img[static_cast<size_t>(y) * w + x] = sampling == Sampling::box ? averageColour(&indices[0], count)
+                                                                             : indices[0];
+        }
+    });
+
+    f.close();
+
+    setDimensions(w, h);
 }
 
 BMP_1bit::BMP_1bit(const int32_t &w, const int32_t &h, bool background) : BMP_CT(w, h),
@@ -73,13 +140,18 @@ BMP_1bit::BMP_1bit(const int32_t &w, const int32_t &h, bool background) : BMP_CT
     colourTable.resize(8);
     colourTable[0] = colourTable[1] = colourTable[2] = colourTable[3] = colourTable[7] = 0;
     colourTable[4] = colourTable[5] = colourTable[6] = 255;
+    updatePalette();
 }
 
 bool BMP_1bit::save(const std::string &filename) const {
+    return save(filename, view());
+}
+
+bool BMP_1bit::save(const std::string &filename, const ConstView &view) const {
     std::ofstream f(filename, std::ios::binary);
 
     // Pass to base class function
-    if (!BMP_CT::save(f)) {
+    if (!BMP_CT::save(f, view.width(), view.height())) {
         f.close();
         return false;
     }
@@ -87,60 +159,62 @@ bool BMP_1bit::save(const std::string &filename) const {
     // Seek to offset
     f.seekp(fileHeader.bfOffBits);
 
-    const size_t &padSize = getRowSize() - (infoHeader.biWidth + 7) / 8; // Size of padding on each row in bytes
+    const size_t padSize = getRowSize(view.width()) - (view.width() + 7) / 8; // Size of padding on each row in bytes
 
-    // Write image data
-    uint8_t buf = 0; // Buffer for storing each byte
-    if (infoHeader.biHeight < 0) {
-        for (int32_t y = 0; y < -infoHeader.biHeight; ++y) {
-            for (int32_t x = 0; x < infoHeader.biWidth; ++x) {
-                const uint8_t remainder = x % 8;
-                if (!remainder)
-                    buf = 0;
+    // Packs a row into bytes and writes them
+    const auto writeRow = [&](const int32_t &y) -> void {
+        const Pixel *row = view.row(y);
+        uint8_t buf = 0; // Buffer for storing each byte
+        for (int32_t x = 0; x < view.width(); ++x) {
+            const uint8_t remainder = x % 8;
+            if (!remainder)
+                buf = 0;
 
-                buf |= (operator()(x, y) != 0) << (8 - 1 - remainder); // Ensure the value is either 1 or 0
+            buf |= (row[x] != 0) << (8 - 1 - remainder); // Ensure the value is either 1 or 0
 
-                // Write whenever a byte is complete
-                if (remainder == 7 || x == infoHeader.biWidth - 1)
-                    f.write(reinterpret_cast<char *>(&buf), sizeof(buf));
-            }
-
-            for (size_t i = 0; i < padSize; ++i)
-                f.put(0); // Skip padding
+            // Write whenever a byte is complete
+            if (remainder == 7 || x == view.width() - 1)
+                f.write(reinterpret_cast<char *>(&buf), sizeof(buf));
         }
-    } else {
-        for (int32_t y = infoHeader.biHeight - 1; y >= 0; --y) {
-            for (int32_t x = 0; x < infoHeader.biWidth; ++x) {
-                const uint8_t remainder = x % 8;
-                if (!remainder)
-                    buf = 0;
 
-                buf |= (operator()(x, y) != 0) << (8 - 1 - remainder); // Ensure the value is either 1 or 0
+        for (size_t i = 0; i < padSize; ++i)
+            f.put(0); // Skip padding
+    };
 
-                // Write whenever a byte is complete
-                if (remainder == 7 || x == infoHeader.biWidth - 1)
-                    f.write(reinterpret_cast<char *>(&buf), sizeof(buf));
-            }
-
-            for (size_t i = 0; i < padSize; ++i)
-                f.put(0); // Skip padding
-        }
+    // Write image data
+    if (infoHeader.biHeight < 0) {
+        for (int32_t y = 0; y < view.height(); ++y)
+            writeRow(y);
+    } else {
+        for (int32_t y = view.height() - 1; y >= 0; --y)
+            writeRow(y);
     }
 
     f.close();
     return true;
 }
 
-uint8_t &BMP_1bit::operator[](const size_t &index) {
-    assertInvalidIndex(index);
+void BMP_1bit::setCopyOnWrite(const bool &enable) {
+    img.setShared(enable);
+}
 
-    return img[index];
+BMP_1bit::View BMP_1bit::view() {
+    Pixel *top = img.data() + static_cast<size_t>(getRow(0)) * infoHeader.biWidth; // Top row in memory
+    return View(top, infoHeader.biWidth, std::abs(infoHeader.biHeight), getStride(infoHeader.biWidth * sizeof(Pixel)));
 }
 
-const uint8_t &BMP_1bit::operator[](const size_t &index) const {
-    assertInvalidIndex(index);
+BMP_1bit::ConstView BMP_1bit::view() const {
+    const Pixel *top = img.data() + static_cast<size_t>(getRow(0)) * infoHeader.biWidth; // Top row in memory
+    return ConstView(top, infoHeader.biWidth, std::abs(infoHeader.biHeight),
+                     getStride(infoHeader.biWidth * sizeof(Pixel)));
+}
 
-    return img[index];
+uint8_t &BMP_1bit::operator[](const size_t &index) {
+    return img[getIndex(index)];
+}
+
+const uint8_t &BMP_1bit::operator[](const size_t &index) const {
+    return img[getIndex(index)];
 }
 
 uint8_t &BMP_1bit::operator()(const int32_t &x, const int32_t &y) {
@@ -150,3 +224,7 @@ uint8_t &BMP_1bit::operator()(const int32_t &x, const int32_t &y) {
 const uint8_t &BMP_1bit::operator()(const int32_t &x, const int32_t &y) const {
     return img[getIndex(x, y)];
 }
+
+uint32_t BMP_1bit::getRGB(const int32_t &x, const int32_t &y) const {
+    return palette[operator()(x, y) != 0];
+}
@@ -2,6 +2,8 @@
 #define BMP_BMP_1_BIT_H
 
 #include "bmp_with-ct.h"
+#include "bmp_view.h"
+#include "bmp_buffer.h"
 #include <vector>
 #include <cstdint>
 #include <string>
@@ -12,12 +14,49 @@
  */
 class BMP_1bit : public BMP_CT {
 public:
+    /// Type of each element in img
+    typedef uint8_t Pixel;
+
+    ///@{
+    /// Views of the pixels, see BMP_View
+    typedef BMP_View<Pixel> View;
+    typedef BMP_ConstView<Pixel> ConstView;
+    ///@}
+
     /**
      * @brief Constructor for reading from a file.
      *
      * @param filename[in] The filename
+     * @param decode[in] Decode the pixels in the constructor (default), or the first time they are accessed or saved
+     */
+    explicit BMP_1bit(const std::string &filename, const Decode &decode = Decode::eager);
+
+    /**
+     * @brief Constructor for reading a rectangular region from a file.
+     *
+     * Only the rows and bytes covered by the region are read, the rest of the pixel array is skipped.
+     *
+     * @param filename[in] The filename
+     * @param x[in] x of the top-left corner of the region
+     * @param y[in] y of the top-left corner of the region
+     * @param w[in] Width of the region
+     * @param h[in] Height of the region
      */
-    explicit BMP_1bit(const std::string &filename);
+    BMP_1bit(const std::string &filename, const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h);
+
+    /**
+     * @brief Constructor for decoding a subsampled thumbnail from a file.
+     *
+     * Only every factor-th row is read from the file, whole, so about 1 / factor of the pixel array is read (see
+     * BMP::Sampling). The thumbnail is ceil(width / factor) by ceil(height / factor).
+     *
+     * Box-averaging averages the colours of the pixels and picks the closest colour in the colour table.
+     *
+     * @param filename[in] The filename
+     * @param factor[in] Subsampling factor, 1 or larger
+     * @param sampling[in] Point-sample (default) or box-average every factor pixels in a row
+     */
+    BMP_1bit(const std::string &filename, const uint32_t &factor, const Sampling &sampling = Sampling::point);
 
     /// Copy constructor
     BMP_1bit(const BMP_1bit &n) = default;
@@ -39,10 +78,42 @@ public:
      */
     bool save(const std::string &filename) const;
 
+    /**
+     * @brief Saves a view (e.g. a crop of this image) to a BMP file, using the colour table and row-order of this image.
+     *
+     * @param filename[in] Output filename
+     * @param view[in] The pixels to save
+     * @return Whether the BMP file has been saved successfully
+     */
+    bool save(const std::string &filename, const ConstView &view) const;
+
+    /**
+     * @brief Turns copy-on-write sharing of the pixels on or off, off by default.
+     *
+     * With sharing on, copies of this image share its pixels until one of them uses a non-const accessor. References
+     * and mutable views taken before copying still point to the shared pixels.
+     *
+     * @param enable[in] Whether copies share the pixels
+     */
+    void setCopyOnWrite(const bool &enable);
+
+    ///@{
+    /**
+     * @brief View of the whole image, no pixels are copied.
+     *
+     * The view is invalidated when the image is destroyed or assigned to.
+     */
+    View view();
+
+    ConstView view() const;
+    ///@}
+
     ///@{
     /**
      * @brief Operator[] for accessing img elements.
      *
+     * Index y * width + x is the pixel at (x, y).
+     *
      * @param index[in] img[index]
      * @return Reference to the element
      */
@@ -72,9 +143,24 @@ public:
      */
     BMP_1bit &operator=(const BMP_1bit &n) = default;
 
+    ///@{
+    /// Colour table accessors, see BMP_CT
+    using BMP_CT::setColourTable;
+    using BMP_CT::getColourTable;
+    ///@}
+
+    /**
+     * @brief Colour of the pixel at (x, y), looked up in the colour table.
+     *
+     * @param x[in] x
+     * @param y[in] y
+     * @return RGB888 value, hex format: 00 RR GG BB
+     */
+    uint32_t getRGB(const int32_t &x, const int32_t &y) const;
+
 private:
     /// Vector for storing image data, stored in row-order.
-    std::vector<uint8_t> img;
+    BMP_Buffer<Pixel> img;
 };
 
 #endif //BMP_BMP_1_BIT_H
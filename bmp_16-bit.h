@@ -2,27 +2,46 @@
 #define BMP_BMP_16_BIT_H
 
 #include "bmp_with-bm.h"
+#include "bmp_image.h"
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <functional>
 
 //TODO: Not tested
 
+/// Pixel format of BMP_16bit, see BMP_Image
+struct BMP_16bitFormat {
+    typedef uint16_t Pixel;
+    typedef BMP_BM Base;
+    static constexpr uint16_t bitCount = 16;
+
+    static const char *name() {
+        return "BMP_16bit";
+    }
+};
+
+template<>
+void BMP_Image<BMP_16bitFormat>::readFormat(const std::string &filename);
+
+template<>
+void BMP_Image<BMP_16bitFormat>::newHeaders();
+
+template<>
+std::function<uint16_t(const uint8_t *, const uint32_t &)> BMP_Image<BMP_16bitFormat>::averager() const;
+
 /**
  * @brief Class for 16-bit BMP images, defaults to RGB555 if bitmask is not used.
  *
  * The bitmask will be used if it is not empty (i.e. empty() returns false), any arbitrary bitmask can be used.
  *
  * Image with invalid bitmasks will be treated as RGB565
+ *
+ * Reading, saving and accessing the pixels are inherited from BMP_Image.
  */
-class BMP_16bit : public BMP_BM {
+class BMP_16bit : public BMP_Image<BMP_16bitFormat> {
 public:
-    /**
-     * @brief Constructor for reading from a file.
-     *
-     * @param filename[in] The filename
-     */
-    explicit BMP_16bit(const std::string &filename);
+    using BMP_Image::BMP_Image;
 
     /// Copy constructor
     BMP_16bit(const BMP_16bit &n) = default;
@@ -40,39 +59,6 @@ public:
     BMP_16bit(const int32_t &w, const int32_t &h, const uint16_t &background = 0,
               std::vector<uint32_t> bm = std::vector<uint32_t>());
 
-    /**
-     * @brief Saves the object to a BMP file.
-     *
-     * @param filename[in] Output filename
-     * @return Whether the BMP file has been saved successfully
-     */
-    bool save(const std::string &filename) const;
-
-    ///@{
-    /**
-     * @brief Operator[] for accessing img elements.
-     *
-     * @param index[in] img[index]
-     * @return Reference to the element
-     */
-    uint16_t &operator[](const size_t &index);
-
-    const uint16_t &operator[](const size_t &index) const;
-    ///@}
-
-    ///@{
-    /**
-     * @brief Access pixel at (x, y), user does not need to handle row-order.
-     *
-     * @param x[in] x
-     * @param y[in] y
-     * @return Reference to the element
-     */
-    uint16_t &operator()(const int32_t &x, const int32_t &y);
-
-    const uint16_t &operator()(const int32_t &x, const int32_t &y) const;
-    ///@}
-
     /**
      * @brief Assignment operator.
      *
@@ -86,13 +72,6 @@ public:
     static const std::vector<uint32_t> RGB565_bitmask;
     static const std::vector<uint32_t> RGB555_bitmask;
     ///@}
-
-    /// Size in bytes for 1 pixel
-    static const uint8_t pixel_size = 2;
-
-private:
-    /// Vector for storing image data, stored in row-order.
-    std::vector<uint16_t> img;
 };
 
 #endif //BMP_BMP_16_BIT_H
@@ -1,42 +1,132 @@
 #include "bmp_24-bit.h"
 #include <iostream>
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 
-BMP_24bit::BMP_24bit(const std::string &filename) : BMP(filename) {
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+const uint8_t BMP_24bit::pixel_size;
+
+static_assert(sizeof(BMP_24bit::Pixel) == BMP_24bit::pixel_size, "BMP_24bit::Pixel must not be padded");
+
+BMP_24bit::BMP_24bit(const std::string &filename, const Decode &decode, const Storage &storage) : BMP(filename),
+                                                                                                  storage(storage) {
     if (infoHeader.biBitCount != 24) {
         std::cerr << "BMP_24bit: This is not a 24-bit BMP file." << std::endl;
         std::exit(1);
     }
 
+    // Read image data into img, now or the first time it is accessed
+    const int32_t w = infoHeader.biWidth, h = infoHeader.biHeight;
+    const uint32_t offset = fileHeader.bfOffBits;
+    const size_t padSize = getRowSize() - infoHeader.biWidth * pixel_size; // Size of padding on each row in bytes
+    const FileStamp stamp = getFileStamp(filename);
+    img.setLoader([filename, stamp, w, h, offset, padSize, storage](std::vector<uint8_t> &img) -> void {
+        const size_t planeSize = static_cast<size_t>(w) * std::abs(h);
+        img.resize(planeSize * pixel_size); // Left 0 if the file changed
+        std::ifstream f;
+        if (!openUnchanged(f, filename, stamp))
+            return;
+
+        f.seekg(offset); // Seek to the start of image array
+
+        std::vector<uint8_t> row(storage == Storage::planar ? w * pixel_size : 0);
+        for (int32_t i = 0; i < std::abs(h); ++i) {
+            const int32_t y = h < 0 ? i : h - 1 - i; // Rows are stored bottom-up if height is positive
+
+            if (storage == Storage::planar) {
+                f.read(reinterpret_cast<char *>(row.data()), pixel_size * w);
+                uint8_t *b = &img[static_cast<size_t>(y) * w];
+                deinterleave(row.data(), b, b + planeSize, b + 2 * planeSize, w);
+            } else {
+                f.read(reinterpret_cast<char *>(&img[static_cast<size_t>(y) * w * pixel_size]), pixel_size * w);
+            }
+
+            f.seekg(padSize, std::ios::cur);
+        }
+
+        f.close();
+    });
+
+    if (decode == Decode::eager)
+        img.load();
+}
+
+BMP_24bit::BMP_24bit(const std::string &filename, const int32_t &x, const int32_t &y, const int32_t &w,
+                     const int32_t &h) : BMP(filename), storage(Storage::interleaved) {
+    if (infoHeader.biBitCount != 24) {
+        std::cerr << "BMP_24bit: This is not a 24-bit BMP file." << std::endl;
+        std::exit(1);
+    }
+
+    assertInvalidRegion(x, y, w, h);
+
     std::ifstream f(filename, std::ios::binary);
 
-    f.seekg(fileHeader.bfOffBits); // Seek to pixel array
+    // Read image data into img, rows are read in file order and only the bytes inside the region are read
+    img.resize(static_cast<size_t>(w) * h * pixel_size);
+    for (int32_t i = 0; i < h; ++i) {
+        const int32_t row = infoHeader.biHeight < 0 ? i : h - 1 - i; // Row inside the region
 
-    const size_t &padSize = getRowSize() - infoHeader.biWidth * pixel_size; // Size of padding on each row in bytes
+        f.seekg(getFileOffset(x, y + row));
+        f.read(reinterpret_cast<char *>(&img[static_cast<size_t>(row) * w * pixel_size]), pixel_size * w);
+    }
 
-    //Read image data into img
-    img.resize(infoHeader.biWidth * std::abs(infoHeader.biHeight) * pixel_size);
-    if (infoHeader.biHeight < 0) {
-        for (int32_t y = 0; y < -infoHeader.biHeight; ++y) {
-            // Read row
-            f.read(reinterpret_cast<char *>(&img[getInternalIndex(0, y)]), pixel_size * infoHeader.biWidth);
+    f.close();
 
-            f.seekg(padSize, std::ios::cur);
-        }
-    } else {
-        for (int32_t y = infoHeader.biHeight - 1; y >= 0; --y) {
-            // Read row
-            f.read(reinterpret_cast<char *>(&img[getInternalIndex(0, y)]), pixel_size * infoHeader.biWidth);
+    setDimensions(w, h);
+}
 
-            f.seekg(padSize, std::ios::cur);
-        }
+BMP_24bit::BMP_24bit(const std::string &filename, const uint32_t &factor, const Sampling &sampling)
+        : BMP(filename), storage(Storage::interleaved) {
+    if (infoHeader.biBitCount != 24) {
+        std::cerr << "BMP_24bit: This is not a 24-bit BMP file." << std::endl;
+        std::exit(1);
     }
 
+    assertInvalidFactor(factor);
+
+    std::ifstream f(filename, std::ios::binary);
+
+    const int32_t w = (infoHeader.biWidth + factor - 1) / factor;
+    const int32_t h = (std::abs(infoHeader.biHeight) + factor - 1) / factor;
+
+    // Decode every factor-th row into img
+    img.resize(static_cast<size_t>(w) * h * pixel_size);
+    readSubsampledRows(f, factor, [&](const int32_t &y, const uint8_t *src) {
+        for (int32_t x = 0; x < w; ++x) {
+            const uint32_t begin = x * factor, count = std::min<uint32_t>(factor, infoHeader.biWidth - begin);
+            uint8_t *dst = &img[(static_cast<size_t>(y) * w + x) * pixel_size];
+
+            for (uint8_t c = 0; c < pixel_size; ++c) {
+                if (sampling == Sampling::box) {
+                    uint32_t sum = 0;
+                    for (uint32_t i = 0; i < count; ++i)
+                        sum += src[(begin + i) * pixel_size + c];
+
+                    dst[c] = (sum + count / 2) / count;
+                } else {
+                    dst[c] = src[begin * pixel_size + c];
+                }
+            }
+        }
+    });
+
     f.close();
+
+    setDimensions(w, h);
 }
 
 BMP_24bit::BMP_24bit(const int32_t &w, const int32_t &h, const uint32_t &background) : BMP(w, h), img(w * std::abs(h) *
-                                                                                                      pixel_size) {
+                                                                                                      pixel_size),
+                                                                                        storage(Storage::interleaved) {
     // Fill in header values
     infoHeader.biBitCount = 24;
     infoHeader.biClrUsed = 0;
@@ -44,39 +134,74 @@ BMP_24bit::BMP_24bit(const int32_t &w, const int32_t &h, const uint32_t &backgro
     infoHeader.biSizeImage = getRowSize() * std::abs(h);
     fileHeader.bfSize = fileHeader.bfOffBits + infoHeader.biSizeImage;
 
-    for (int32_t y = 0; y < std::abs(h); ++y) {
-        for (int32_t x = 0; x < w; ++x) {
-            setPixel(x, y, background);
+    // Fill the first row, then copy it to the other rows (the pixels are already 0)
+    if (background && w) {
+        uint8_t *pixels = img.data();
+        const size_t rowBytes = static_cast<size_t>(w) * pixel_size;
+        for (size_t i = 0; i < rowBytes; i += pixel_size) {
+            pixels[i + getChannelOffset(Channel::red)] = background >> 16u;
+            pixels[i + getChannelOffset(Channel::green)] = background >> 8u;
+            pixels[i + getChannelOffset(Channel::blue)] = background;
         }
+
+        for (int32_t y = 1; y < std::abs(h); ++y)
+            std::memcpy(pixels + y * rowBytes, pixels, rowBytes);
     }
 }
 
 bool BMP_24bit::save(const std::string &filename) const {
+    if (storage == Storage::interleaved)
+        return save(filename, view());
+
     std::ofstream f(filename, std::ios::binary);
 
     // Pass to base class function
-    if (!BMP::save(f)) {
+    if (!BMP::save(f, infoHeader.biWidth, std::abs(infoHeader.biHeight))) {
         f.close();
         return false;
     }
 
     f.seekp(fileHeader.bfOffBits); // Seek to pixel array
 
-    const size_t &padSize = getRowSize() - infoHeader.biWidth * pixel_size; // Size of padding on each row in bytes
+    // Write image data, each row is interleaved with its padding into a buffer first
+    const int32_t w = infoHeader.biWidth, h = std::abs(infoHeader.biHeight);
+    const ConstPlaneView b = plane(Channel::blue), g = plane(Channel::green), r = plane(Channel::red);
+    std::vector<uint8_t> row(getRowSize());
+    for (int32_t i = 0; i < h; ++i) {
+        const int32_t y = infoHeader.biHeight < 0 ? i : h - 1 - i;
+
+        interleave(b.row(y), g.row(y), r.row(y), row.data(), w);
+        f.write(reinterpret_cast<const char *>(row.data()), row.size());
+    }
+
+    f.close();
+    return true;
+}
+
+bool BMP_24bit::save(const std::string &filename, const ConstView &view) const {
+    std::ofstream f(filename, std::ios::binary);
+
+    // Pass to base class function
+    if (!BMP::save(f, view.width(), view.height())) {
+        f.close();
+        return false;
+    }
+
+    f.seekp(fileHeader.bfOffBits); // Seek to pixel array
+
+    const size_t padSize = getRowSize(view.width()) - view.width() * sizeof(Pixel); // Size of padding on each row in bytes
 
     // Write image data
     if (infoHeader.biHeight < 0) {
-        for (int32_t y = 0; y < -infoHeader.biHeight; ++y) {
-            // Write row
-            f.write(reinterpret_cast<const char *>(&img[getInternalIndex(0, y)]), pixel_size * infoHeader.biWidth);
+        for (int32_t y = 0; y < view.height(); ++y) {
+            f.write(reinterpret_cast<const char *>(view.row(y)), sizeof(Pixel) * view.width());
 
             for (size_t i = 0; i < padSize; ++i)
                 f.put(0);
         }
     } else {
-        for (int32_t y = infoHeader.biHeight - 1; y >= 0; --y) {
-            // Write row
-            f.write(reinterpret_cast<const char *>(&img[getInternalIndex(0, y)]), pixel_size * infoHeader.biWidth);
+        for (int32_t y = view.height() - 1; y >= 0; --y) {
+            f.write(reinterpret_cast<const char *>(view.row(y)), sizeof(Pixel) * view.width());
 
             for (size_t i = 0; i < padSize; ++i)
                 f.put(0);
@@ -87,105 +212,260 @@ bool BMP_24bit::save(const std::string &filename) const {
     return true;
 }
 
-void BMP_24bit::setPixel(const size_t &index, const uint32_t &colour) {
-    red(index) = colour >> 16u;
-    green(index) = colour >> 8u;
-    blue(index) = colour;
+void BMP_24bit::setCopyOnWrite(const bool &enable) {
+    img.setShared(enable);
 }
 
-void BMP_24bit::setPixel(const int32_t &x, const int32_t &y, const uint32_t &colour) {
-    red(x, y) = colour >> 16u;
-    green(x, y) = colour >> 8u;
-    blue(x, y) = colour;
+BMP_24bit::Storage BMP_24bit::getStorage() const {
+    return storage;
 }
 
-uint32_t BMP_24bit::getPixel(const size_t &index) const {
-    return (red(index) << 16u) + (green(index) << 8u) + blue(index);
-}
+void BMP_24bit::setStorage(const Storage &storage) {
+    if (storage == this->storage)
+        return;
 
-uint32_t BMP_24bit::getPixel(const int32_t &x, const int32_t &y) const {
-    return (red(x, y) << 16u) + (green(x, y) << 8u) + blue(x, y);
+    BMP_Buffer<uint8_t> out = convert(storage);
+    out.setShared(img.isShared());
+    img.swap(out);
+    this->storage = storage;
 }
 
-uint8_t &BMP_24bit::red(const size_t &index) {
-    return img[getInternalRedIndex(index)];
-}
+BMP_24bit BMP_24bit::interleaved() const {
+    if (storage == Storage::interleaved)
+        return *this;
 
-const uint8_t &BMP_24bit::red(const size_t &index) const {
-    return img[getInternalRedIndex(index)];
+    BMP_Buffer<uint8_t> out = convert(Storage::interleaved);
+    return BMP_24bit(*this, out, Storage::interleaved);
 }
 
-uint8_t &BMP_24bit::red(const int32_t &x, const int32_t &y) {
-    return img[getInternalRedIndex(x, y)];
+BMP_24bit::BMP_24bit(const BMP &n, BMP_Buffer<uint8_t> &img, const Storage &storage) : BMP(n), storage(storage) {
+    this->img.swap(img);
 }
 
-const uint8_t &BMP_24bit::red(const int32_t &x, const int32_t &y) const {
-    return img[getInternalRedIndex(x, y)];
-}
+BMP_Buffer<uint8_t> BMP_24bit::convert(const Storage &storage) const {
+    // Convert every row in memory, their order is kept
+    const size_t planeSize = static_cast<size_t>(infoHeader.biWidth) * std::abs(infoHeader.biHeight);
+    const uint8_t *src = img.data();
+    BMP_Buffer<uint8_t> out(planeSize * pixel_size);
+    uint8_t *dst = out.data();
+    for (int32_t y = 0; y < std::abs(infoHeader.biHeight); ++y) {
+        const size_t row = static_cast<size_t>(y) * infoHeader.biWidth;
+
+        if (storage == Storage::planar)
+            deinterleave(src + row * pixel_size, dst + row, dst + planeSize + row, dst + 2 * planeSize + row,
+                         infoHeader.biWidth);
+        else
+            interleave(src + row, src + planeSize + row, src + 2 * planeSize + row, dst + row * pixel_size,
+                       infoHeader.biWidth);
+    }
 
-uint8_t &BMP_24bit::green(const size_t &index) {
-    return img[getInternalGreenIndex(index)];
+    return out;
 }
 
-const uint8_t &BMP_24bit::green(const size_t &index) const {
-    return img[getInternalGreenIndex(index)];
-}
+BMP_24bit::View BMP_24bit::view() {
+    assertInvalidStorage(Storage::interleaved);
 
-uint8_t &BMP_24bit::green(const int32_t &x, const int32_t &y) {
-    return img[getInternalGreenIndex(x, y)];
+    Pixel *top = reinterpret_cast<Pixel *>(img.data()) + static_cast<size_t>(getRow(0)) * infoHeader.biWidth; // Top row in memory
+    return View(top, infoHeader.biWidth, std::abs(infoHeader.biHeight), getStride(infoHeader.biWidth * sizeof(Pixel)));
 }
 
-const uint8_t &BMP_24bit::green(const int32_t &x, const int32_t &y) const {
-    return img[getInternalGreenIndex(x, y)];
-}
+BMP_24bit::ConstView BMP_24bit::view() const {
+    assertInvalidStorage(Storage::interleaved);
 
-uint8_t &BMP_24bit::blue(const size_t &index) {
-    return img[getInternalBlueIndex(index)];
+    const Pixel *top = reinterpret_cast<const Pixel *>(img.data()) + static_cast<size_t>(getRow(0)) * infoHeader.biWidth; // Top row in memory
+    return ConstView(top, infoHeader.biWidth, std::abs(infoHeader.biHeight), getStride(infoHeader.biWidth * sizeof(Pixel)));
 }
 
-const uint8_t &BMP_24bit::blue(const size_t &index) const {
-    return img[getInternalBlueIndex(index)];
+BMP_24bit::PlaneView BMP_24bit::plane(const Channel &channel) {
+    assertInvalidStorage(Storage::planar);
+
+    uint8_t *top = img.data() + getChannelOffset(channel) + static_cast<size_t>(getRow(0)) * infoHeader.biWidth;
+    return PlaneView(top, infoHeader.biWidth, std::abs(infoHeader.biHeight), getStride(infoHeader.biWidth));
 }
 
-uint8_t &BMP_24bit::blue(const int32_t &x, const int32_t &y) {
-    return img[getInternalBlueIndex(x, y)];
+BMP_24bit::ConstPlaneView BMP_24bit::plane(const Channel &channel) const {
+    assertInvalidStorage(Storage::planar);
+
+    const uint8_t *top = img.data() + getChannelOffset(channel) + static_cast<size_t>(getRow(0)) * infoHeader.biWidth;
+    return ConstPlaneView(top, infoHeader.biWidth, std::abs(infoHeader.biHeight), getStride(infoHeader.biWidth));
 }
 
-const uint8_t &BMP_24bit::blue(const int32_t &x, const int32_t &y) const {
-    return img[getInternalBlueIndex(x, y)];
+BMP_24bit::ConstView BMP_24bit::fileView(const uint8_t *data, const size_t &size) {
+    const uint8_t *origin = nullptr;
+    int32_t w = 0, h = 0;
+    ptrdiff_t stride = 0;
+    if (!mapPixels(data, size, 24, origin, w, h, stride))
+        return ConstView();
+
+    return ConstView(reinterpret_cast<const Pixel *>(origin), w, h, stride);
 }
 
-size_t BMP_24bit::getInternalIndex(const size_t &index) const {
-    assertInvalidIndex(index);
+void BMP_24bit::setPixel(const size_t &index, const uint32_t &colour) {
+    setPixelAt(getInternalIndex(index), colour);
+}
 
-    return index * pixel_size;
+void BMP_24bit::setPixel(const int32_t &x, const int32_t &y, const uint32_t &colour) {
+    setPixelAt(getInternalIndex(x, y), colour);
 }
 
-size_t BMP_24bit::getInternalRedIndex(const size_t &index) const {
-    return getInternalIndex(index) + 2;
+uint32_t BMP_24bit::getPixel(const size_t &index) const {
+    return getPixelAt(getInternalIndex(index));
 }
 
-size_t BMP_24bit::getInternalGreenIndex(const size_t &index) const {
-    return getInternalIndex(index) + 1;
+uint32_t BMP_24bit::getPixel(const int32_t &x, const int32_t &y) const {
+    return getPixelAt(getInternalIndex(x, y));
 }
 
-size_t BMP_24bit::getInternalBlueIndex(const size_t &index) const {
-    return getInternalIndex(index);
+void BMP_24bit::deinterleave(const uint8_t *src, uint8_t *b, uint8_t *g, uint8_t *r, const int32_t &n) {
+    int32_t x = 0;
+#ifdef __SSSE3__
+    // For each channel and each 16-byte third of 16 pixels, where its bytes go in the 16 bytes of the channel
+    const __m128i masks[3][3] = {
+            {
+                    _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1),
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13)
+            },
+            {
+                    _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1),
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14)
+            },
+            {
+                    _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1),
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1),
+                    _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15)
+            }
+    };
+    uint8_t *dst[3] = {b, g, r};
+
+#ifdef __AVX2__
+    // 32 pixels at a time, each 128-bit lane splits 16 of them with the same shuffles
+    for (; x + 32 <= n; x += 32) {
+        __m256i p[3];
+        for (uint8_t i = 0; i < 3; ++i)
+            p[i] = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * x + 16 * i))),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * x + 48 + 16 * i)), 1);
+
+        for (uint8_t c = 0; c < 3; ++c) {
+            const __m256i v = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_shuffle_epi8(p[0], _mm256_broadcastsi128_si256(masks[c][0])),
+                                    _mm256_shuffle_epi8(p[1], _mm256_broadcastsi128_si256(masks[c][1]))),
+                    _mm256_shuffle_epi8(p[2], _mm256_broadcastsi128_si256(masks[c][2])));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst[c] + x), v);
+        }
+    }
+#endif
+
+    for (; x + 16 <= n; x += 16) {
+        const __m128i p[3] = {
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * x)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * x + 16)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * x + 32))
+        };
+
+        for (uint8_t c = 0; c < 3; ++c) {
+            const __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(p[0], masks[c][0]),
+                                                        _mm_shuffle_epi8(p[1], masks[c][1])),
+                                           _mm_shuffle_epi8(p[2], masks[c][2]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst[c] + x), v);
+        }
+    }
+#endif
+
+    for (; x < n; ++x) {
+        b[x] = src[3 * x];
+        g[x] = src[3 * x + 1];
+        r[x] = src[3 * x + 2];
+    }
 }
 
-size_t BMP_24bit::getInternalIndex(const int32_t &x, const int32_t &y) const {
-    return getIndex(x, y) * pixel_size;
+void BMP_24bit::interleave(const uint8_t *b, const uint8_t *g, const uint8_t *r, uint8_t *dst, const int32_t &n) {
+    int32_t x = 0;
+#ifdef __SSSE3__
+    // For each 16-byte third of 16 pixels and each channel, where the bytes of the channel go in the third
+    const __m128i masks[3][3] = {
+            {
+                    _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5),
+                    _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1),
+                    _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1)
+            },
+            {
+                    _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1),
+                    _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10),
+                    _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1)
+            },
+            {
+                    _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1),
+                    _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1),
+                    _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15)
+            }
+    };
+
+#ifdef __AVX2__
+    // 32 pixels at a time, each 128-bit lane joins 16 of them with the same shuffles
+    for (; x + 32 <= n; x += 32) {
+        const __m256i c[3] = {
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + x)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(g + x)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(r + x))
+        };
+
+        for (uint8_t i = 0; i < 3; ++i) {
+            const __m256i v = _mm256_or_si256(
+                    _mm256_or_si256(_mm256_shuffle_epi8(c[0], _mm256_broadcastsi128_si256(masks[i][0])),
+                                    _mm256_shuffle_epi8(c[1], _mm256_broadcastsi128_si256(masks[i][1]))),
+                    _mm256_shuffle_epi8(c[2], _mm256_broadcastsi128_si256(masks[i][2])));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * x + 16 * i), _mm256_castsi256_si128(v));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * x + 48 + 16 * i), _mm256_extracti128_si256(v, 1));
+        }
+    }
+#endif
+
+    for (; x + 16 <= n; x += 16) {
+        const __m128i c[3] = {
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + x)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(g + x)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(r + x))
+        };
+
+        for (uint8_t i = 0; i < 3; ++i) {
+            const __m128i v = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c[0], masks[i][0]),
+                                                        _mm_shuffle_epi8(c[1], masks[i][1])),
+                                           _mm_shuffle_epi8(c[2], masks[i][2]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * x + 16 * i), v);
+        }
+    }
+#endif
+
+    for (; x < n; ++x) {
+        dst[3 * x] = b[x];
+        dst[3 * x + 1] = g[x];
+        dst[3 * x + 2] = r[x];
+    }
 }
 
-size_t BMP_24bit::getInternalRedIndex(const int32_t &x, const int32_t &y) const {
-    return getInternalIndex(x, y) + 2;
+void BMP_24bit::setPixelAt(const size_t &internal, const uint32_t &colour) {
+    // The channels are one byte apart, or one plane apart
+    const size_t step = getChannelOffset(Channel::green);
+    uint8_t *blue = img.data() + internal;
+    blue[0] = colour;
+    blue[step] = colour >> 8u;
+    blue[2 * step] = colour >> 16u;
 }
 
-size_t BMP_24bit::getInternalGreenIndex(const int32_t &x, const int32_t &y) const {
-    return getInternalIndex(x, y) + 1;
+uint32_t BMP_24bit::getPixelAt(const size_t &internal) const {
+    const size_t step = getChannelOffset(Channel::green);
+    const uint8_t *blue = img.data() + internal;
+    return (blue[2 * step] << 16u) + (blue[step] << 8u) + blue[0];
 }
 
-size_t BMP_24bit::getInternalBlueIndex(const int32_t &x, const int32_t &y) const {
-    return getInternalIndex(x, y);
+void BMP_24bit::assertInvalidStorage(const Storage &needed) const {
+    if (storage != needed) {
+        std::cerr << "BMP_24bit: This needs the "
+                  << (needed == Storage::planar ? "planar" : "interleaved") << " storage." << std::endl;
+        std::exit(1);
+    }
 }
 
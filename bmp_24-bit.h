@@ -2,21 +2,84 @@
 #define BMP_BMP_24_BIT_H
 
 #include "bmp.h"
+#include "bmp_view.h"
+#include "bmp_buffer.h"
 #include <string>
 #include <vector>
 #include <cstddef>
 
 /**
  * @brief A class for 24-bit RGB888 BMP images.
+ *
+ * The channels are interleaved in memory like in the file by default. With the planar storage, each channel is a
+ * separate plane of bytes instead, so single-channel operations work on contiguous rows, see plane(). The other
+ * modules accept either storage, they read a planar image through an interleaved copy (see BMP_Interleaved) and the
+ * images they return are interleaved.
  */
 class BMP_24bit : public BMP {
 public:
+    /// A pixel, in the same byte order as in the file
+    struct Pixel {
+        uint8_t b, g, r;
+    };
+
+    ///@{
+    /// Views of the pixels, see BMP_View
+    typedef BMP_View<Pixel> View;
+    typedef BMP_ConstView<Pixel> ConstView;
+    ///@}
+
+    ///@{
+    /// Views of a channel plane, see BMP_View
+    typedef BMP_View<uint8_t> PlaneView;
+    typedef BMP_ConstView<uint8_t> ConstPlaneView;
+    ///@}
+
+    /// How the channels are stored in memory
+    enum class Storage {
+        interleaved, ///< B, G and R bytes of each pixel next to each other like in the file, the default
+        planar ///< A plane of all the blue bytes, then one of the green bytes, then one of the red bytes
+    };
+
+    /// A channel, in the order of the bytes of a pixel in the file
+    enum class Channel {
+        blue, green, red
+    };
+
     /**
      * @brief Constructor for reading from a file.
      *
      * @param filename[in] The filename
+     * @param decode[in] Decode the pixels in the constructor (default), or the first time they are accessed or saved
+     * @param storage[in] How the channels are stored in memory, the rows are split into planes as they are read
+     */
+    explicit BMP_24bit(const std::string &filename, const Decode &decode = Decode::eager,
+                       const Storage &storage = Storage::interleaved);
+
+    /**
+     * @brief Constructor for reading a rectangular region from a file.
+     *
+     * Only the rows and bytes covered by the region are read, the rest of the pixel array is skipped.
+     *
+     * @param filename[in] The filename
+     * @param x[in] x of the top-left corner of the region
+     * @param y[in] y of the top-left corner of the region
+     * @param w[in] Width of the region
+     * @param h[in] Height of the region
      */
-    explicit BMP_24bit(const std::string &filename);
+    BMP_24bit(const std::string &filename, const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h);
+
+    /**
+     * @brief Constructor for decoding a subsampled thumbnail from a file.
+     *
+     * Only every factor-th row is read from the file, whole, so about 1 / factor of the pixel array is read (see
+     * BMP::Sampling). The thumbnail is ceil(width / factor) by ceil(height / factor).
+     *
+     * @param filename[in] The filename
+     * @param factor[in] Subsampling factor, 1 or larger
+     * @param sampling[in] Point-sample (default) or box-average every factor pixels in a row
+     */
+    BMP_24bit(const std::string &filename, const uint32_t &factor, const Sampling &sampling = Sampling::point);
 
     /// Copy constructor
     BMP_24bit(const BMP_24bit &n) = default;
@@ -31,17 +94,86 @@ public:
     BMP_24bit(const int32_t &w, const int32_t &h, const uint32_t &background = 0);
 
     /**
-     * @brief Saves the object to a BMP file.
+     * @brief Saves the object to a BMP file, planes are interleaved as the rows are written.
      *
      * @param filename[in] Output filename
      * @return Whether the BMP file has been saved successfully
      */
     bool save(const std::string &filename) const;
 
+    /**
+     * @brief Saves a view (e.g. a crop of this image) to a BMP file, using the row-order of this image.
+     *
+     * @param filename[in] Output filename
+     * @param view[in] The pixels to save
+     * @return Whether the BMP file has been saved successfully
+     */
+    bool save(const std::string &filename, const ConstView &view) const;
+
+    /**
+     * @brief Turns copy-on-write sharing of the pixels on or off, off by default.
+     *
+     * With sharing on, copies of this image share its pixels until one of them uses a non-const accessor. References
+     * and mutable views taken before copying still point to the shared pixels.
+     *
+     * @param enable[in] Whether copies share the pixels
+     */
+    void setCopyOnWrite(const bool &enable);
+
+    /// How the channels are stored in memory
+    Storage getStorage() const;
+
+    /**
+     * @brief Changes how the channels are stored in memory, the pixels are copied if it changes.
+     *
+     * Views, references and pointers taken before are invalidated if the storage changes.
+     *
+     * @param storage[in] The storage
+     */
+    void setStorage(const Storage &storage);
+
+    /// Copy of this image with the interleaved storage, the planes are interleaved as they are copied
+    BMP_24bit interleaved() const;
+
+    ///@{
+    /**
+     * @brief View of the whole image, no pixels are copied, only with the interleaved storage.
+     *
+     * The view is invalidated when the image is destroyed or assigned to.
+     */
+    View view();
+
+    ConstView view() const;
+    ///@}
+
+    ///@{
+    /**
+     * @brief View of one channel of the whole image, no pixels are copied, only with the planar storage.
+     *
+     * The view is invalidated when the image is destroyed or assigned to.
+     *
+     * @param channel[in] The channel
+     */
+    PlaneView plane(const Channel &channel);
+
+    ConstPlaneView plane(const Channel &channel) const;
+    ///@}
+
+    /**
+     * @brief View of the pixel array of a 24-bit BMP file that is already in memory (e.g. a memory-mapped file).
+     *
+     * @param data[in] The whole file
+     * @param size[in] Size of data in bytes
+     * @return The view, empty if data is not a complete 24-bit BMP file
+     */
+    static ConstView fileView(const uint8_t *data, const size_t &size);
+
     /**
      * @{
      *
      * @brief Pixel accessors function.
+     *
+     * Index y * width + x is the pixel at (x, y).
      */
     void setPixel(const size_t &index, const uint32_t &colour);
 
@@ -82,12 +214,58 @@ public:
     const uint8_t &blue(const int32_t &x, const int32_t &y) const;
     ///@}
 
+    /**
+     * @brief Splits a row of pixels (B, G, R bytes) into a row of each channel, with SSSE3 shuffles when compiled with
+     * SSSE3 enabled, 32 pixels at a time with AVX2.
+     *
+     * @param src[in] n pixels
+     * @param b[out] n blue bytes
+     * @param g[out] n green bytes
+     * @param r[out] n red bytes
+     * @param n[in] Number of pixels
+     */
+    static void deinterleave(const uint8_t *src, uint8_t *b, uint8_t *g, uint8_t *r, const int32_t &n);
+
+    /**
+     * @brief Joins a row of each channel into a row of pixels (B, G, R bytes), with SSSE3 shuffles when compiled with
+     * SSSE3 enabled, 32 pixels at a time with AVX2.
+     *
+     * @param b[in] n blue bytes
+     * @param g[in] n green bytes
+     * @param r[in] n red bytes
+     * @param dst[out] n pixels
+     * @param n[in] Number of pixels
+     */
+    static void interleave(const uint8_t *b, const uint8_t *g, const uint8_t *r, uint8_t *dst, const int32_t &n);
+
     /// Size in bytes for 1 pixel
     static const uint8_t pixel_size = 3;
 
 private:
     /// Vector for storing image data, stored in row-order.
-    std::vector<uint8_t> img;
+    BMP_Buffer<uint8_t> img;
+
+    /// How the channels are stored in img
+    Storage storage;
+
+    /// Constructor for an image with the headers of n, taking the pixels of img
+    BMP_24bit(const BMP &n, BMP_Buffer<uint8_t> &img, const Storage &storage);
+
+    /// Pixels of img in a storage, rows in the same order
+    BMP_Buffer<uint8_t> convert(const Storage &storage) const;
+
+    /// Position of a channel in img, relative to the position of a pixel
+    size_t getChannelOffset(const Channel &channel) const;
+
+    ///@{
+    /// Pixel whose blue byte is at an internal index, the index is computed once for the three channels
+    void setPixelAt(const size_t &internal, const uint32_t &colour);
+
+    uint32_t getPixelAt(const size_t &internal) const;
+    ///@}
+
+    /// Assert: The pixels are not stored in the storage needed
+    void assertInvalidStorage(const Storage &needed) const;
 
     /**
      * @{
@@ -96,20 +274,74 @@ private:
      */
     size_t getInternalIndex(const size_t &index) const;
 
-    size_t getInternalRedIndex(const size_t &index) const;
+    size_t getInternalIndex(const int32_t &x, const int32_t &y) const;
+    ///@}
+};
 
-    size_t getInternalGreenIndex(const size_t &index) const;
+// Called for every pixel access, so defined here to be inlined
 
-    size_t getInternalBlueIndex(const size_t &index) const;
+inline size_t BMP_24bit::getChannelOffset(const Channel &channel) const {
+    const size_t c = static_cast<size_t>(channel);
 
-    size_t getInternalIndex(const int32_t &x, const int32_t &y) const;
+    return storage == Storage::planar ? c * infoHeader.biWidth * std::abs(infoHeader.biHeight) : c;
+}
 
-    size_t getInternalRedIndex(const int32_t &x, const int32_t &y) const;
+inline size_t BMP_24bit::getInternalIndex(const size_t &index) const {
+    const size_t i = getIndex(index);
 
-    size_t getInternalGreenIndex(const int32_t &x, const int32_t &y) const;
+    return storage == Storage::planar ? i : i * pixel_size;
+}
 
-    size_t getInternalBlueIndex(const int32_t &x, const int32_t &y) const;
-    ///@}
-};
+inline size_t BMP_24bit::getInternalIndex(const int32_t &x, const int32_t &y) const {
+    return storage == Storage::planar ? getIndex(x, y) : getIndex(x, y) * pixel_size;
+}
+
+inline uint8_t &BMP_24bit::red(const size_t &index) {
+    return img[getInternalIndex(index) + getChannelOffset(Channel::red)];
+}
+
+inline const uint8_t &BMP_24bit::red(const size_t &index) const {
+    return img[getInternalIndex(index) + getChannelOffset(Channel::red)];
+}
+
+inline uint8_t &BMP_24bit::red(const int32_t &x, const int32_t &y) {
+    return img[getInternalIndex(x, y) + getChannelOffset(Channel::red)];
+}
+
+inline const uint8_t &BMP_24bit::red(const int32_t &x, const int32_t &y) const {
+    return img[getInternalIndex(x, y) + getChannelOffset(Channel::red)];
+}
+
+inline uint8_t &BMP_24bit::green(const size_t &index) {
+    return img[getInternalIndex(index) + getChannelOffset(Channel::green)];
+}
+
+inline const uint8_t &BMP_24bit::green(const size_t &index) const {
+    return img[getInternalIndex(index) + getChannelOffset(Channel::green)];
+}
+
+inline uint8_t &BMP_24bit::green(const int32_t &x, const int32_t &y) {
+    return img[getInternalIndex(x, y) + getChannelOffset(Channel::green)];
+}
+
+inline const uint8_t &BMP_24bit::green(const int32_t &x, const int32_t &y) const {
+    return img[getInternalIndex(x, y) + getChannelOffset(Channel::green)];
+}
+
+inline uint8_t &BMP_24bit::blue(const size_t &index) {
+    return img[getInternalIndex(index) + getChannelOffset(Channel::blue)];
+}
+
+inline const uint8_t &BMP_24bit::blue(const size_t &index) const {
+    return img[getInternalIndex(index) + getChannelOffset(Channel::blue)];
+}
+
+inline uint8_t &BMP_24bit::blue(const int32_t &x, const int32_t &y) {
+    return img[getInternalIndex(x, y) + getChannelOffset(Channel::blue)];
+}
+
+inline const uint8_t &BMP_24bit::blue(const int32_t &x, const int32_t &y) const {
+    return img[getInternalIndex(x, y) + getChannelOffset(Channel::blue)];
+}
 
 #endif //BMP_BMP_24_BIT_H
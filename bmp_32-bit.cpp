@@ -1,5 +1,4 @@
 #include "bmp_32-bit.h"
-#include <iostream>
 
 const std::vector<uint32_t> BMP_32bit::RGB888_bitmask = {
         0xFF000000, //r
@@ -13,101 +12,31 @@ const std::vector<uint32_t> BMP_32bit::RGB101010_bitmask = {
         0xFFC //b
 };
 
-BMP_32bit::BMP_32bit(const std::string &filename) : BMP_BM(filename) {
-    if (infoHeader.biBitCount != 32) {
-        std::cerr << "BMP_32bit: This is not a 32-bit BMP file." << std::endl;
-        std::exit(1);
-    }
-
+template<>
+void BMP_Image<BMP_32bitFormat>::readFormat(const std::string &) {
     // Set to RGB888 if cannot read valid bitmask (i.e. bitmask left untouched)
     if (infoHeader.biCompression == 3 && bitmask.empty())
-        bitmask = RGB888_bitmask;
-
-    std::ifstream f(filename, std::ios::binary);
-
-    f.seekg(fileHeader.bfOffBits); // Seek to pixel array
-
-    const size_t &padSize = getRowSize() - infoHeader.biWidth * pixel_size; // Size of padding on each row in bytes
-
-    //Read image data into img
-    img.resize(infoHeader.biWidth * std::abs(infoHeader.biHeight));
-    if (infoHeader.biHeight < 0) {
-        for (int32_t y = 0; y < -infoHeader.biHeight; ++y) {
-            f.read(reinterpret_cast<char *>(&operator()(0, y)), pixel_size * infoHeader.biWidth);
-
-            f.seekg(padSize, std::ios::cur);
-        }
-    } else {
-        for (int32_t y = infoHeader.biHeight - 1; y >= 0; --y) {
-            f.read(reinterpret_cast<char *>(&operator()(0, y)), pixel_size * infoHeader.biWidth);
-
-            f.seekg(padSize, std::ios::cur);
-        }
-    }
-
-    f.close();
+        bitmask = BMP_32bit::RGB888_bitmask;
 }
 
-BMP_32bit::BMP_32bit(const int32_t &w, const int32_t &h, const uint32_t &background, std::vector<uint32_t> bm) : BMP_BM(
-        w, h, std::move(bm)), img(w * std::abs(h), background) {
+template<>
+void BMP_Image<BMP_32bitFormat>::newHeaders() {
     // Fill in header values
-    infoHeader.biBitCount = 32;
+    infoHeader.biBitCount = bitCount;
     infoHeader.biClrUsed = 0;
     fileHeader.bfOffBits = fileHeaderSize + infoHeader.biSize + 3 * sizeof(uint32_t);
-    infoHeader.biSizeImage = getRowSize() * std::abs(h);
+    infoHeader.biSizeImage = rowSize(infoHeader.biWidth) * std::abs(infoHeader.biHeight);
     fileHeader.bfSize = fileHeader.bfOffBits + infoHeader.biSizeImage;
 }
 
-bool BMP_32bit::save(const std::string &filename) const {
-    std::ofstream f(filename, std::ios::binary);
-
-    // Pass to base class function
-    if (!BMP_BM::save(f)) {
-        f.close();
-        return false;
-    }
-
-    f.seekp(fileHeader.bfOffBits); // Seek to pixel array
-
-    const size_t &padSize = getRowSize() - infoHeader.biWidth * pixel_size; // Size of padding on each row in bytes
-
-    // Write image data
-    if (infoHeader.biHeight < 0) {
-        for (int32_t y = 0; y < -infoHeader.biHeight; ++y) {
-            f.write(reinterpret_cast<const char *>(&operator()(0, y)), pixel_size * infoHeader.biWidth);
-
-            for (size_t i = 0; i < padSize; ++i)
-                f.put(0);
-        }
-    } else {
-        for (int32_t y = infoHeader.biHeight - 1; y >= 0; --y) {
-            f.write(reinterpret_cast<const char *>(&operator()(0, y)), pixel_size * infoHeader.biWidth);
-
-            for (size_t i = 0; i < padSize; ++i)
-                f.put(0);
-        }
-    }
-
-    f.close();
-    return true;
-}
-
-uint32_t &BMP_32bit::operator[](const size_t &index) {
-    assertInvalidIndex(index);
-
-    return img[index];
-}
-
-const uint32_t &BMP_32bit::operator[](const size_t &index) const {
-    assertInvalidIndex(index);
-
-    return img[index];
-}
-
-uint32_t &BMP_32bit::operator()(const int32_t &x, const int32_t &y) {
-    return img[getIndex(x, y)];
+template<>
+std::function<uint32_t(const uint8_t *, const uint32_t &)> BMP_Image<BMP_32bitFormat>::averager() const {
+    const std::vector<uint32_t> masks = getPixelMasks();
+    return [masks](const uint8_t *src, const uint32_t &count) -> uint32_t {
+        return averagePixels(src, count, pixel_size, masks);
+    };
 }
 
-const uint32_t &BMP_32bit::operator()(const int32_t &x, const int32_t &y) const {
-    return img[getIndex(x, y)];
+BMP_32bit::BMP_32bit(const int32_t &w, const int32_t &h, const uint32_t &background, std::vector<uint32_t> bm)
+        : BMP_Image(w, h, background, std::move(bm)) {
 }
@@ -2,7 +2,31 @@
 #define BMP_BMP_32_BIT_H
 
 #include "bmp_with-bm.h"
+#include "bmp_image.h"
 #include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+
+/// Pixel format of BMP_32bit, see BMP_Image
+struct BMP_32bitFormat {
+    typedef uint32_t Pixel;
+    typedef BMP_BM Base;
+    static constexpr uint16_t bitCount = 32;
+
+    static const char *name() {
+        return "BMP_32bit";
+    }
+};
+
+template<>
+void BMP_Image<BMP_32bitFormat>::readFormat(const std::string &filename);
+
+template<>
+void BMP_Image<BMP_32bitFormat>::newHeaders();
+
+template<>
+std::function<uint32_t(const uint8_t *, const uint32_t &)> BMP_Image<BMP_32bitFormat>::averager() const;
 
 /**
  * @brief Class for 32-bit BMP images, defaults to RGB888 if bitmask is not used.
@@ -10,15 +34,12 @@
  * The bitmask will be used if it is not empty (i.e. empty() returns false), any arbitrary bitmask can be used.
  *
  * Image with invalid bitmasks will be treated as RGB565
+ *
+ * Reading, saving and accessing the pixels are inherited from BMP_Image.
  */
-class BMP_32bit : public BMP_BM {
+class BMP_32bit : public BMP_Image<BMP_32bitFormat> {
 public:
-    /**
-     * @brief Constructor for reading from a file.
-     *
-     * @param filename[in] The filename
-     */
-    explicit BMP_32bit(const std::string &filename);
+    using BMP_Image::BMP_Image;
 
     /// Copy constructor
     BMP_32bit(const BMP_32bit &n) = default;
@@ -30,45 +51,12 @@ public:
      *
      * @param x[in] Width, positive only
      * @param y[in] Height, negative value means flipped row-order
-     * @param background[in] 16-bit value, format depends on bitmask
+     * @param background[in] 32-bit value, format depends on bitmask
      * @param bitmask[in] Vector containing the bit mask, default to empty bitmask (no bitmask used)
      */
     BMP_32bit(const int32_t &w, const int32_t &h, const uint32_t &background = 0,
               std::vector<uint32_t> bm = std::vector<uint32_t>());
 
-    /**
-     * @brief Saves the object to a BMP file.
-     *
-     * @param filename[in] Output filename
-     * @return Whether the BMP file has been saved successfully
-     */
-    bool save(const std::string &filename) const;
-
-    ///@{
-    /**
-     * @brief Operator[] for accessing img elements.
-     *
-     * @param index[in] img[index]
-     * @return Reference to the element
-     */
-    uint32_t &operator[](const size_t &index);
-
-    const uint32_t &operator[](const size_t &index) const;
-    ///@}
-
-    ///@{
-    /**
-     * @brief Access pixel at (x, y), user does not need to handle row-order.
-     *
-     * @param x[in] x
-     * @param y[in] y
-     * @return Reference to the element
-     */
-    uint32_t &operator()(const int32_t &x, const int32_t &y);
-
-    const uint32_t &operator()(const int32_t &x, const int32_t &y) const;
-    ///@}
-
     /**
      * @brief Assignment operator.
      *
@@ -82,13 +70,6 @@ public:
     static const std::vector<uint32_t> RGB888_bitmask;
     static const std::vector<uint32_t> RGB101010_bitmask;
     ///@}
-
-    /// Size in bytes for 1 pixel
-    static const uint8_t pixel_size = 4;
-
-private:
-    /// Vector for storing image data, stored in row-order.
-    std::vector<uint32_t> img;
 };
 
 #endif //BMP_BMP_32_BIT_H
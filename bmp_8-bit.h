@@ -2,22 +2,39 @@
 #define BMP_BMP_8_BIT_H
 
 #include "bmp_with-ct.h"
+#include "bmp_image.h"
 #include <cstdint>
-#include <cstddef>
 #include <string>
-#include <vector>
+#include <functional>
+
+/// Pixel format of BMP_8bit, see BMP_Image
+struct BMP_8bitFormat {
+    typedef uint8_t Pixel;
+    typedef BMP_CT Base;
+    static constexpr uint16_t bitCount = 8;
+
+    static const char *name() {
+        return "BMP_8bit";
+    }
+};
+
+template<>
+void BMP_Image<BMP_8bitFormat>::readFormat(const std::string &filename);
+
+template<>
+void BMP_Image<BMP_8bitFormat>::newHeaders();
+
+template<>
+std::function<uint8_t(const uint8_t *, const uint32_t &)> BMP_Image<BMP_8bitFormat>::averager() const;
 
 /**
  * @brief Class for 8-bit BMP images, usually greyscale
+ *
+ * Reading, saving and accessing the pixels are inherited from BMP_Image.
  */
-class BMP_8bit : public BMP_CT {
+class BMP_8bit : public BMP_Image<BMP_8bitFormat> {
 public:
-    /**
-     * @brief Constructor for reading from a file.
-     *
-     * @param filename[in] The filename
-     */
-    explicit BMP_8bit(const std::string &filename);
+    using BMP_Image::BMP_Image;
 
     /// Copy constructor
     BMP_8bit(const BMP_8bit &n) = default;
@@ -32,45 +49,27 @@ public:
     BMP_8bit(const int32_t &w, const int32_t &h, const uint8_t &background = 0);
 
     /**
-     * @brief Saves the object to a BMP file.
+     * @brief Assignment operator.
      *
-     * @param filename[in] Output filename
-     * @return Whether the BMP file has been saved successfully
+     * @param n[in] To be copied to the this
+     * @return Reference to this
      */
-    bool save(const std::string &filename) const;
+    BMP_8bit &operator=(const BMP_8bit &n) = default;
 
     ///@{
-    /**
-     * @brief Operator[] for accessing img elements.
-     *
-     * @param index[in] img[index]
-     * @return Reference to the element
-     */
-    uint8_t &operator[](const size_t &index);
-
-    const uint8_t &operator[](const size_t &index) const;
+    /// Colour table accessors, see BMP_CT
+    using BMP_CT::setColourTable;
+    using BMP_CT::getColourTable;
     ///@}
 
-    ///@{
     /**
-     * @brief Access pixel at (x, y), user does not need to handle row-order.
+     * @brief Colour of the pixel at (x, y), looked up in the colour table.
      *
      * @param x[in] x
      * @param y[in] y
-     * @return Reference to the element
-     */
-    uint8_t &operator()(const int32_t &x, const int32_t &y);
-
-    const uint8_t &operator()(const int32_t &x, const int32_t &y) const;
-    ///@}
-
-    /**
-     * @brief Assignment operator.
-     *
-     * @param n[in] To be copied to the this
-     * @return Reference to this
+     * @return RGB888 value, hex format: 00 RR GG BB
      */
-    BMP_8bit &operator=(const BMP_8bit &n) = default;
+    uint32_t getRGB(const int32_t &x, const int32_t &y) const;
 
     /**
      * @brief Converts a greyscale value to an RGB888 value using the default colour table.
@@ -78,10 +77,6 @@ public:
      * @return RGB888 value, hex format: XX RR GG BB
      */
     static uint32_t toRGB888(const uint8_t &grey);
-
-private:
-    /// Vector for storing image data, stored in row-order.
-    std::vector<uint8_t> img;
 };
 
 #endif //BMP_BMP_8_BIT_H
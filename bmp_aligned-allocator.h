@@ -0,0 +1,67 @@
+#ifndef BMP_BMP_ALIGNED_ALLOCATOR_H
+#define BMP_BMP_ALIGNED_ALLOCATOR_H
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+
+/**
+ * @brief Allocator for std::vector whose storage starts at a multiple of Alignment bytes (e.g. a cache line).
+ *
+ * Only the start of the storage is aligned. Rows of an image are aligned as well if their stride is a multiple of
+ * Alignment, see BMP::Layout.
+ *
+ * @tparam T Type of the elements
+ * @tparam Alignment Alignment in bytes, a power of 2
+ */
+template<typename T, size_t Alignment = 64>
+class BMP_AlignedAllocator {
+    static_assert(Alignment >= sizeof(void *) && (Alignment & (Alignment - 1)) == 0,
+                  "BMP_AlignedAllocator: Alignment must be a power of 2, at least the size of a pointer");
+
+public:
+    typedef T value_type;
+
+    template<typename U>
+    struct rebind {
+        typedef BMP_AlignedAllocator<U, Alignment> other;
+    };
+
+    BMP_AlignedAllocator() = default;
+
+    template<typename U>
+    BMP_AlignedAllocator(const BMP_AlignedAllocator<U, Alignment> &) {
+    }
+
+    /// Allocates n elements, the pointer returned by ::operator new is kept just before the aligned storage
+    T *allocate(const size_t &n) {
+        if (n > (SIZE_MAX - Alignment - sizeof(void *)) / sizeof(T))
+            throw std::bad_alloc();
+
+        void *raw = ::operator new(n * sizeof(T) + Alignment + sizeof(void *));
+        const uintptr_t mask = Alignment - 1;
+        const uintptr_t aligned = (reinterpret_cast<uintptr_t>(raw) + sizeof(void *) + mask) & ~mask;
+        reinterpret_cast<void **>(aligned)[-1] = raw;
+
+        return reinterpret_cast<T *>(aligned);
+    }
+
+    void deallocate(T *p, const size_t &) {
+        ::operator delete(reinterpret_cast<void **>(p)[-1]);
+    }
+};
+
+///@{
+/// Every allocator of the same alignment can free the storage of the others
+template<typename T, typename U, size_t Alignment>
+bool operator==(const BMP_AlignedAllocator<T, Alignment> &, const BMP_AlignedAllocator<U, Alignment> &) {
+    return true;
+}
+
+template<typename T, typename U, size_t Alignment>
+bool operator!=(const BMP_AlignedAllocator<T, Alignment> &, const BMP_AlignedAllocator<U, Alignment> &) {
+    return false;
+}
+///@}
+
+#endif //BMP_BMP_ALIGNED_ALLOCATOR_H
@@ -0,0 +1,125 @@
+#include "bmp_bitmap.h"
+#include "bmp_parallel.h"
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+BMP_Bitmap::BMP_Bitmap(const int32_t &w, const int32_t &h) : w(w), h(h), stride((static_cast<size_t>(w) + 63) / 64) {
+    if (w < 0 || h < 0) {
+        std::cerr << "BMP_Bitmap: Invalid dimensions." << std::endl;
+        std::exit(1);
+    }
+
+    bits.resize(stride * h, 0);
+}
+
+BMP_Bitmap::BMP_Bitmap(const BMP_1bit::ConstView &view, const bool &foreground) : BMP_Bitmap(view.width(),
+                                                                                              view.height()) {
+    BMP_Parallel::forRows(0, h, [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y) {
+            const BMP_1bit::Pixel *src = view.row(y);
+            uint64_t *dst = row(y);
+
+            for (size_t i = 0; i < stride; ++i) {
+                const int32_t x0 = static_cast<int32_t>(i * 64), n = std::min(64, w - x0);
+                uint64_t word = 0;
+
+                int32_t x = 0;
+#ifdef __SSE2__
+                // Bits of the zero pixels, 16 at a time
+                const __m128i zero = _mm_setzero_si128();
+                for (; x + 16 <= n; x += 16) {
+                    const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x0 + x));
+                    word |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(p, zero)) ^ 0xFFFF) << x;
+                }
+#endif
+
+                for (; x < n; ++x)
+                    word |= static_cast<uint64_t>(src[x0 + x] != 0) << x;
+
+                // Complement the bits inside the width if zero pixels are the foreground
+                if (!foreground)
+                    word ^= n == 64 ? ~0ull : (1ull << n) - 1;
+
+                dst[i] = word;
+            }
+        }
+    });
+}
+
+BMP_1bit BMP_Bitmap::toBMP_1bit(const bool &foreground) const {
+    BMP_1bit out(w, h);
+    const BMP_1bit::View dst = out.view();
+
+    BMP_Parallel::forRows(0, h, [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y) {
+            const uint64_t *src = row(y);
+            BMP_1bit::Pixel *p = dst.row(y);
+
+            for (int32_t x = 0; x < w; ++x)
+                p[x] = (src[x / 64] >> (x % 64) & 1u) == foreground;
+        }
+    });
+
+    return out;
+}
+
+int32_t BMP_Bitmap::width() const {
+    return w;
+}
+
+int32_t BMP_Bitmap::height() const {
+    return h;
+}
+
+size_t BMP_Bitmap::words() const {
+    return stride;
+}
+
+uint64_t *BMP_Bitmap::row(const int32_t &y) {
+    return bits.data() + static_cast<size_t>(y) * stride;
+}
+
+const uint64_t *BMP_Bitmap::row(const int32_t &y) const {
+    return bits.data() + static_cast<size_t>(y) * stride;
+}
+
+bool BMP_Bitmap::get(const int32_t &x, const int32_t &y) const {
+    if (!validIndex(x, y)) {
+        std::cerr << "BMP_Bitmap: Index out of bounds" << std::endl;
+        std::exit(1);
+    }
+
+    return row(y)[x / 64] >> (x % 64) & 1u;
+}
+
+void BMP_Bitmap::set(const int32_t &x, const int32_t &y, const bool &value) {
+    if (!validIndex(x, y)) {
+        std::cerr << "BMP_Bitmap: Index out of bounds" << std::endl;
+        std::exit(1);
+    }
+
+    uint64_t &word = row(y)[x / 64];
+    const uint64_t bit = 1ull << (x % 64);
+    word = value ? word | bit : word & ~bit;
+}
+
+uint64_t BMP_Bitmap::count() const {
+    uint64_t n = 0;
+    for (const uint64_t &word : bits)
+        n += __builtin_popcountll(word);
+
+    return n;
+}
+
+bool BMP_Bitmap::operator==(const BMP_Bitmap &n) const {
+    return w == n.w && h == n.h && bits == n.bits;
+}
+
+bool BMP_Bitmap::validIndex(const int32_t &x, const int32_t &y) const {
+    return x >= 0 && x < w && y >= 0 && y < h;
+}
@@ -0,0 +1,102 @@
+#ifndef BMP_BMP_BITMAP_H
+#define BMP_BMP_BITMAP_H
+
+#include "bmp_1-bit.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Packed black and white image, 64 pixels in each word, for bit-parallel processing (see BMP_Morphology).
+ *
+ * Rows are top-down and start on a new word. Pixel x of a row is bit x % 64 of word x / 64, so the lowest bit is the
+ * leftmost pixel. The bits past the width of a row are always 0.
+ */
+class BMP_Bitmap {
+public:
+    /// Value of a pixel, whether it is set
+    typedef bool Pixel;
+
+    /**
+     * @brief Constructor for a new bitmap with every pixel cleared.
+     *
+     * @param w[in] Width, non-negative only
+     * @param h[in] Height, non-negative only
+     */
+    BMP_Bitmap(const int32_t &w, const int32_t &h);
+
+    /**
+     * @brief Constructor for packing the pixels of a 1-bit image, 16 pixels at a time with SSE2.
+     *
+     * @param view[in] Pixels, e.g. the view() of a BMP_1bit
+     * @param foreground[in] Pixels set in the bitmap, true for non-zero colour indices (default) or false for 0
+     */
+    explicit BMP_Bitmap(const BMP_1bit::ConstView &view, const bool &foreground = true);
+
+    /**
+     * @brief Unpacks the bitmap to a 1-bit image with the default colour table (0 is black, 1 is white).
+     *
+     * @param foreground[in] Colour index of the set pixels, true for 1 (default) or false for 0
+     * @return The 1-bit image
+     */
+    BMP_1bit toBMP_1bit(const bool &foreground = true) const;
+
+    ///@{
+    /// Dimensions of the bitmap
+    int32_t width() const;
+
+    int32_t height() const;
+    ///@}
+
+    /// Number of words in each row
+    size_t words() const;
+
+    ///@{
+    /**
+     * @brief Pointer to the first word of row y, y is not checked.
+     *
+     * The bits past the width must be left cleared.
+     */
+    uint64_t *row(const int32_t &y);
+
+    const uint64_t *row(const int32_t &y) const;
+    ///@}
+
+    /**
+     * @brief Whether the pixel at (x, y) is set.
+     *
+     * @param x[in] x
+     * @param y[in] y
+     */
+    bool get(const int32_t &x, const int32_t &y) const;
+
+    /**
+     * @brief Sets or clears the pixel at (x, y).
+     *
+     * @param x[in] x
+     * @param y[in] y
+     * @param value[in] Whether the pixel is set
+     */
+    void set(const int32_t &x, const int32_t &y, const bool &value);
+
+    /// Number of set pixels
+    uint64_t count() const;
+
+    /// Whether two bitmaps have the same dimensions and pixels
+    bool operator==(const BMP_Bitmap &n) const;
+
+private:
+    /// Check for valid pixel index
+    bool validIndex(const int32_t &x, const int32_t &y) const;
+
+    /// Width and height
+    int32_t w, h;
+
+    /// Words in each row
+    size_t stride;
+
+    /// Rows of words, top-down
+    std::vector<uint64_t> bits;
+};
+
+#endif //BMP_BMP_BITMAP_H
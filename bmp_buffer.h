@@ -0,0 +1,211 @@
+#ifndef BMP_BMP_BUFFER_H
+#define BMP_BMP_BUFFER_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+/**
+ * @brief Pixel storage that can be shared between copies of an image (copy-on-write) and filled lazily.
+ *
+ * Sharing is off by default, a copy then owns its own elements like a std::vector does. With sharing on, copying only
+ * copies a reference-counted pointer, and the elements are copied the first time a mutable accessor is used while they
+ * are still shared.
+ *
+ * A loader can be set to fill the elements the first time any accessor is used, e.g. to decode the pixels of a file
+ * only when they are needed.
+ *
+ * The reference count is atomic and loading is done once under a lock, so copies sharing the same elements can be
+ * read, copied and detached from different threads. A single buffer object must not be modified from several threads
+ * at once.
+ *
+ * Element access only checks a plain pointer while the buffer is loaded, not shared and the only owner of its elements
+ * (e.g. without copy-on-write and lazy loading), the atomic checks are done once when that pointer is set.
+ *
+ * @tparam T Type of the elements
+ * @tparam Allocator Allocator of the elements, e.g. BMP_AlignedAllocator for aligned storage
+ */
+template<typename T, typename Allocator = std::allocator<T>>
+class BMP_Buffer {
+public:
+    /// Vector holding the elements
+    typedef std::vector<T, Allocator> Vector;
+
+    /// Function that fills the elements, called at most once
+    typedef std::function<void(Vector &)> Loader;
+
+    /// Constructs an empty buffer
+    BMP_Buffer() : storage(std::make_shared<Storage>()), shared(false), owned(nullptr) {
+    }
+
+    /// Constructs a buffer of n copies of value
+    explicit BMP_Buffer(const size_t &n, const T &value = T()) : storage(std::make_shared<Storage>()), shared(false) {
+        // Filled after value-initialising, assign() constructs one element at a time with an allocator other than
+        // std::allocator, reloading value each time as it could be one of the elements
+        storage->elements.resize(n);
+        if (value != T())
+            std::fill(storage->elements.begin(), storage->elements.end(), value);
+        owned = storage->elements.data();
+    }
+
+    /// Copy constructor, only copies the elements if sharing is off
+    BMP_Buffer(const BMP_Buffer &n) : storage(n.shared ? n.storage : n.clone()), shared(n.shared) {
+        owned = shared ? nullptr : storage->elements.data();
+    }
+
+    /// Assignment operator, only copies the elements if sharing is off
+    BMP_Buffer &operator=(const BMP_Buffer &n) {
+        if (this != &n) {
+            storage = n.shared ? n.storage : n.clone();
+            shared = n.shared;
+            owned = shared ? nullptr : storage->elements.data();
+        }
+
+        return *this;
+    }
+
+    /// Turns copy-on-write sharing on or off for future copies
+    void setShared(const bool &enable) {
+        shared = enable;
+        if (enable)
+            owned = nullptr; // Copies will share the elements from now on
+    }
+
+    /// Whether future copies share the elements
+    bool isShared() const {
+        return shared;
+    }
+
+    /// Swaps the elements and the sharing of two buffers, no elements are copied
+    void swap(BMP_Buffer &n) {
+        std::swap(storage, n.storage);
+        std::swap(shared, n.shared);
+        std::swap(owned, n.owned);
+    }
+
+    /**
+     * @brief Replaces the elements with ones filled by loader the first time they are accessed.
+     *
+     * @param loader[in] Fills the (empty) vector it is given
+     */
+    void setLoader(const Loader &loader) {
+        storage = std::make_shared<Storage>();
+        storage->loader = loader;
+        storage->loaded = false;
+        owned = nullptr;
+    }
+
+    /// Runs the loader now if it has not been run yet
+    void load() const {
+        if (storage->loaded.load(std::memory_order_acquire))
+            return;
+
+        std::lock_guard<std::mutex> lock(storage->mutex);
+        if (!storage->loaded.load(std::memory_order_relaxed)) {
+            storage->loader(storage->elements);
+            storage->loader = Loader();
+            storage->loaded.store(true, std::memory_order_release);
+        }
+    }
+
+    /// Number of elements
+    size_t size() const {
+        load();
+        return storage->elements.size();
+    }
+
+    /// Resizes the buffer, new elements are value-initialised
+    void resize(const size_t &n) {
+        detach();
+        storage->elements.resize(n);
+        if (owned)
+            owned = storage->elements.data();
+    }
+
+    ///@{
+    /// Pointer to the first element, the mutable version stops sharing first
+    T *data() {
+        if (owned)
+            return owned;
+
+        detach();
+        return storage->elements.data();
+    }
+
+    const T *data() const {
+        if (owned)
+            return owned;
+
+        load();
+        return storage->elements.data();
+    }
+    ///@}
+
+    ///@{
+    /// Access an element, the mutable version stops sharing first
+    T &operator[](const size_t &index) {
+        return data()[index];
+    }
+
+    const T &operator[](const size_t &index) const {
+        return data()[index];
+    }
+    ///@}
+
+private:
+    /// Elements and how to load them, shared between buffers
+    struct Storage {
+        Storage() : loaded(true) {
+        }
+
+        Vector elements;
+
+        /// Fills elements if loaded is false
+        Loader loader;
+
+        /// Whether elements is filled
+        std::atomic<bool> loaded;
+
+        /// Held while loading
+        std::mutex mutex;
+    };
+
+    /// A loaded, unshared copy of the storage
+    std::shared_ptr<Storage> clone() const {
+        load();
+
+        std::shared_ptr<Storage> n = std::make_shared<Storage>();
+        n->elements = storage->elements;
+        return n;
+    }
+
+    /// Makes sure this buffer is loaded and the only owner of its elements before they are modified
+    void detach() {
+        load();
+
+        if (storage.use_count() != 1)
+            storage = clone();
+        else
+            std::atomic_thread_fence(std::memory_order_acquire); // Pairs with the release of the last other owner
+
+        // Without sharing, no other buffer can own these elements until setShared() is called
+        if (!shared)
+            owned = storage->elements.data();
+    }
+
+    /// The elements, possibly shared with other buffers
+    std::shared_ptr<Storage> storage;
+
+    /// Whether copies share the elements
+    bool shared;
+
+    /// The elements while this buffer is loaded, not shared and their only owner, nullptr otherwise
+    T *owned;
+};
+
+#endif //BMP_BMP_BUFFER_H
@@ -0,0 +1,313 @@
+#include "bmp_cache.h"
+#include "bmp_hash.h"
+#include "bmp_1-bit.h"
+#include "bmp_8-bit.h"
+#include "bmp_16-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include "bmp_interleaved.h"
+#include <sys/stat.h>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <list>
+#include <limits>
+#include <typeindex>
+#include <unordered_map>
+
+namespace {
+    /// Identifies an image, by file (path) or by content (hash, with an empty path)
+    struct Key {
+        std::type_index type;
+        std::string path;
+        uint64_t hash;
+
+        bool operator==(const Key &n) const {
+            return type == n.type && hash == n.hash && path == n.path;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &n) const {
+            return std::hash<std::string>()(n.path) ^ n.type.hash_code() * 31 ^ n.hash;
+        }
+    };
+
+    /// An image in the cache
+    struct Entry {
+        Key key;
+        std::shared_ptr<const BMP> image;
+        size_t bytes;     ///< Memory taken by the image
+        int64_t mtime;    ///< Modification time of the file, by file only
+        uint64_t size;    ///< Size of the file, by file only
+        uint64_t used;    ///< Value of the clock when the image was last used
+    };
+
+    /// Entries whose keys have the same shard number, from the most to the least recently used
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    };
+}
+
+/// Number of shards
+static const size_t shardCount = 16;
+
+static Shard shards[shardCount];
+
+/// Budget and memory taken by the images in the cache, in bytes
+static std::atomic<size_t> budget(256u << 20), bytes(0);
+
+/// Clock counting every use of an image, for least recently used eviction across shards
+static std::atomic<uint64_t> ticks(0);
+
+static std::atomic<uint64_t> hits(0), misses(0), evictions(0);
+
+/// Shard holding a key
+static Shard &shardOf(const Key &key) {
+    return shards[static_cast<uint64_t>(KeyHash()(key)) * 0x9E3779B97F4A7C15ull >> 60 & (shardCount - 1)];
+}
+
+/// Removes an entry from its shard, the lock of the shard must be held (it is copied, it may be owned by the index)
+static void erase(Shard &shard, const std::list<Entry>::iterator it) {
+    bytes -= it->bytes;
+    shard.index.erase(it->key);
+    shard.entries.erase(it);
+}
+
+/// Marks an entry as the most recently used, the lock of the shard must be held
+static void touch(Shard &shard, const std::list<Entry>::iterator &it) {
+    it->used = ++ticks;
+    shard.entries.splice(shard.entries.begin(), shard.entries, it);
+}
+
+/// Evicts the least recently used entries until the cache is within the budget
+static void trim() {
+    while (bytes > budget) {
+        // The least recently used entry of each shard is the last one
+        size_t oldest = shardCount;
+        uint64_t used = std::numeric_limits<uint64_t>::max();
+        for (size_t i = 0; i < shardCount; ++i) {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            if (!shards[i].entries.empty() && shards[i].entries.back().used < used) {
+                used = shards[i].entries.back().used;
+                oldest = i;
+            }
+        }
+
+        if (oldest == shardCount)
+            return;
+
+        // Another thread may have used or evicted the entry in the meantime
+        Shard &shard = shards[oldest];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (!shard.entries.empty() && shard.entries.back().used == used) {
+            erase(shard, std::prev(shard.entries.end()));
+            ++evictions;
+        }
+    }
+}
+
+/**
+ * @brief Cached image of a key.
+ *
+ * @param key[in] The key
+ * @param valid[in] Whether an entry is still valid, invalid entries are removed
+ * @return The image, null if there is no valid entry
+ */
+template<typename Valid>
+static std::shared_ptr<const BMP> find(const Key &key, const Valid &valid) {
+    Shard &shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto it = shard.index.find(key);
+    if (it == shard.index.end())
+        return nullptr;
+
+    if (!valid(*it->second)) {
+        erase(shard, it->second);
+        return nullptr;
+    }
+
+    touch(shard, it->second);
+    return it->second->image;
+}
+
+/**
+ * @brief Adds an entry to the cache, unless it is larger than the budget.
+ *
+ * @param entry[in] The entry
+ * @param same[in] Whether an entry already cached with the same key (e.g. added by another thread) has the same image
+ * @param replace[in] Whether an entry with the same key but a different image is replaced, or kept and entry not added
+ * @return The image of the entry with the same key and image if there is one, the image of entry otherwise
+ */
+template<typename Same>
+static std::shared_ptr<const BMP> insert(Entry entry, const Same &same, const bool &replace) {
+    const std::shared_ptr<const BMP> image = entry.image;
+    if (entry.bytes > budget)
+        return image;
+
+    {
+        Shard &shard = shardOf(entry.key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        const auto it = shard.index.find(entry.key);
+        if (it != shard.index.end()) {
+            if (same(*it->second)) {
+                touch(shard, it->second);
+                return it->second->image;
+            }
+
+            if (!replace)
+                return image;
+
+            erase(shard, it->second);
+        }
+
+        entry.used = ++ticks;
+        shard.entries.push_front(entry);
+        shard.index.emplace(entry.key, shard.entries.begin());
+        bytes += entry.bytes;
+    }
+
+    trim();
+    return image;
+}
+
+/// Memory taken by an image
+template<typename Image>
+static size_t footprint(const Image &n) {
+    return sizeof(Image) + static_cast<size_t>(n.getInfoHeader().biWidth) * std::abs(n.getInfoHeader().biHeight) *
+                           sizeof(typename Image::Pixel);
+}
+
+///@{
+/// Whether the colour tables or bit masks of 2 images are the same
+static bool sameFormat(const BMP_CT &a, const BMP_CT &b) {
+    for (uint16_t i = 0; i < 256; ++i)
+        if (a.getPalette()[i] != b.getPalette()[i])
+            return false;
+
+    return true;
+}
+
+static bool sameFormat(const BMP_BM &a, const BMP_BM &b) {
+    return a.getPixelMasks() == b.getPixelMasks();
+}
+
+static bool sameFormat(const BMP &, const BMP &) {
+    return true;
+}
+///@}
+
+/// Whether 2 images have the same content, see BMP_Cache::share()
+template<typename Image>
+static bool sameContent(const Image &a, const Image &b) {
+    if (a.getInfoHeader().biWidth != b.getInfoHeader().biWidth ||
+        a.getInfoHeader().biHeight != b.getInfoHeader().biHeight || !sameFormat(a, b))
+        return false;
+
+    const BMP_Interleaved<Image> ia(a), ib(b);
+    const typename Image::ConstView va = ia->view(), vb = ib->view();
+    const size_t rowBytes = static_cast<size_t>(va.width()) * sizeof(typename Image::Pixel);
+    for (int32_t y = 0; y < va.height(); ++y)
+        if (std::memcmp(va.row(y), vb.row(y), rowBytes) != 0)
+            return false;
+
+    return true;
+}
+
+size_t BMP_Cache::getBudget() {
+    return budget;
+}
+
+void BMP_Cache::setBudget(const size_t &bytes) {
+    budget = bytes;
+    trim();
+}
+
+template<typename Image>
+std::shared_ptr<const Image> BMP_Cache::load(const std::string &filename) {
+    struct stat file;
+    if (stat(filename.c_str(), &file) != 0) {
+        std::cerr << "BMP_Cache: The file does not exist." << std::endl;
+        std::exit(1);
+    }
+
+    const int64_t mtime = file.st_mtime;
+    const uint64_t size = file.st_size;
+    const auto unchanged = [&](const Entry &entry) -> bool {
+        return entry.mtime == mtime && entry.size == size;
+    };
+
+    const Key key = {std::type_index(typeid(Image)), filename, 0};
+    std::shared_ptr<const BMP> image = find(key, unchanged);
+    if (image) {
+        ++hits;
+    } else {
+        ++misses;
+        const std::shared_ptr<const Image> decoded = std::make_shared<Image>(filename);
+        image = insert({key, decoded, footprint(*decoded), mtime, size, 0}, unchanged, true);
+    }
+
+    return std::static_pointer_cast<const Image>(image);
+}
+
+template<typename Image>
+std::shared_ptr<const Image> BMP_Cache::share(const Image &n) {
+    const auto same = [&](const Entry &entry) -> bool {
+        return sameContent(*std::static_pointer_cast<const Image>(entry.image), n);
+    };
+
+    // Entries with the same hash but a different content are kept, and n is not cached
+    const Key key = {std::type_index(typeid(Image)), std::string(), BMP_Hash::content(n)};
+    std::shared_ptr<const BMP> image = find(key, [](const Entry &) -> bool {
+        return true;
+    });
+
+    if (image && sameContent(*std::static_pointer_cast<const Image>(image), n)) {
+        ++hits;
+    } else {
+        ++misses;
+        const std::shared_ptr<const Image> copy = std::make_shared<Image>(n);
+        image = insert({key, copy, footprint(n), 0, 0, 0}, same, false);
+    }
+
+    return std::static_pointer_cast<const Image>(image);
+}
+
+void BMP_Cache::clear() {
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        while (!shard.entries.empty())
+            erase(shard, shard.entries.begin());
+    }
+}
+
+BMP_Cache::Statistics BMP_Cache::getStatistics() {
+    Statistics out = {hits, misses, evictions, 0, bytes};
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        out.entries += shard.entries.size();
+    }
+
+    return out;
+}
+
+void BMP_Cache::resetStatistics() {
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+}
+
+/// Instantiates every function for an image class
+#define BMP_CACHE_INSTANTIATE(Image) \
+    template std::shared_ptr<const Image> BMP_Cache::load(const std::string &); \
+    template std::shared_ptr<const Image> BMP_Cache::share(const Image &);
+
+BMP_CACHE_INSTANTIATE(BMP_1bit)
+BMP_CACHE_INSTANTIATE(BMP_8bit)
+BMP_CACHE_INSTANTIATE(BMP_16bit)
+BMP_CACHE_INSTANTIATE(BMP_24bit)
+BMP_CACHE_INSTANTIATE(BMP_32bit)
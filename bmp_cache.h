@@ -0,0 +1,81 @@
+#ifndef BMP_BMP_CACHE_H
+#define BMP_BMP_CACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Process-wide cache of decoded images, so images used again and again (e.g. templates, masks, sprites) are only
+ * decoded once.
+ *
+ * Should not be constructed, it only groups static functions. Images are kept by file (path, modification time and file
+ * size) or by content (see BMP_Hash::content()), and handed out as shared read-only objects that stay valid after they
+ * are evicted. The least recently used images are evicted when the images in the cache take more than the memory
+ * budget.
+ *
+ * Safe to use from several threads at once. Images are spread over shards by key, each with its own lock, so lookups
+ * of different images rarely wait for each other, and files are decoded without holding any lock.
+ *
+ * Every function is available for BMP_1bit, BMP_8bit, BMP_16bit, BMP_24bit and BMP_32bit, each image class having its
+ * own entries.
+ */
+class BMP_Cache {
+public:
+    BMP_Cache() = delete;
+
+    /// Counters of the cache, since the start of the process or the last call to resetStatistics()
+    struct Statistics {
+        uint64_t hits;      ///< Lookups that found an image
+        uint64_t misses;    ///< Lookups that had to decode or copy an image
+        uint64_t evictions; ///< Images evicted to stay within the budget
+        size_t entries;     ///< Images in the cache now
+        size_t bytes;       ///< Memory taken by the images in the cache now
+    };
+
+    /// Memory budget in bytes, 256 MiB by default
+    static size_t getBudget();
+
+    /**
+     * @brief Sets the memory budget, and evicts images until the cache is within it.
+     *
+     * @param bytes[in] Budget in bytes, 0 to keep nothing
+     */
+    static void setBudget(const size_t &bytes);
+
+    /**
+     * @brief Image of a file, decoded only if it is not cached yet or the file changed since it was cached.
+     *
+     * A file is considered unchanged if its modification time (in seconds) and size are the same. Images larger than
+     * the budget are decoded but not cached.
+     *
+     * @param filename[in] The filename
+     * @return The image
+     */
+    template<typename Image>
+    static std::shared_ptr<const Image> load(const std::string &filename);
+
+    /**
+     * @brief Cached image with the same content as an image, the image is copied into the cache if there is none.
+     *
+     * Images have the same content if they have the same dimensions, row-order, pixels, and colour table or bit masks.
+     * Useful to keep a single copy of images generated or loaded several times.
+     *
+     * @param n[in] Image
+     * @return The cached image, or a copy of n if it is larger than the budget
+     */
+    template<typename Image>
+    static std::shared_ptr<const Image> share(const Image &n);
+
+    /// Removes every image from the cache, images already handed out stay valid
+    static void clear();
+
+    /// Counters and current size of the cache
+    static Statistics getStatistics();
+
+    /// Sets the hit, miss and eviction counters to 0
+    static void resetStatistics();
+};
+
+#endif //BMP_BMP_CACHE_H
@@ -0,0 +1,393 @@
+#include "bmp_compare.h"
+#include "bmp_parallel.h"
+#include "bmp_interleaved.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+typedef BMP_Compare::Difference Difference;
+
+///@{
+/// Bits of a pixel that are compared, repeated every 4 bytes
+static uint32_t colourBits(const BMP_24bit &) {
+    return ~0u;
+}
+
+static uint32_t colourBits(const BMP_32bit &n) {
+    const std::vector<uint32_t> masks = n.getPixelMasks();
+    return masks[0] | masks[1] | masks[2];
+}
+///@}
+
+namespace {
+    /**
+     * @brief Read access through view() to an image with the pixels stored like those of another, see
+     * BMP_Interleaved.
+     *
+     * Refers to the interleaved image itself, except for a BMP_32bit whose masks differ from those of the other image:
+     * it then holds a copy of it with every channel moved to the mask of the other image, and scaled if their widths
+     * differ, so that both are compared channel by channel.
+     */
+    template<typename Image>
+    class SameMasks {
+    public:
+        SameMasks(const Image &n, const Image &) : image(n) {
+        }
+
+        const Image *operator->() const {
+            return &*image;
+        }
+
+    private:
+        const BMP_Interleaved<Image> image;
+    };
+
+    template<>
+    class SameMasks<BMP_32bit> {
+    public:
+        SameMasks(const BMP_32bit &n, const BMP_32bit &like) : copy(convert(n, like)), image(copy ? *copy : n) {
+        }
+
+        const BMP_32bit *operator->() const {
+            return &image;
+        }
+
+    private:
+        /// A copy of n with the masks of like, nullptr if they already have the same masks
+        static BMP_32bit *convert(const BMP_32bit &n, const BMP_32bit &like) {
+            const std::vector<uint32_t> from = n.getPixelMasks(), to = like.getPixelMasks();
+            if (std::equal(from.begin(), from.begin() + 3, to.begin()))
+                return nullptr;
+
+            BMP_32bit *out = new BMP_32bit(n.getInfoHeader().biWidth, n.getInfoHeader().biHeight, 0,
+                                           like.getBitmask());
+            const BMP_32bit::ConstView src = n.view();
+            const BMP_32bit::View dst = out->view();
+            BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+                for (int32_t y = begin; y < end; ++y) {
+                    for (int32_t x = 0; x < src.width(); ++x) {
+                        uint32_t pixel = 0;
+                        for (uint8_t c = 0; c < 3; ++c) {
+                            if (!from[c] || !to[c])
+                                continue;
+
+                            const uint32_t shift = __builtin_ctz(from[c]), max = from[c] >> shift;
+                            const uint32_t toShift = __builtin_ctz(to[c]), toMax = to[c] >> toShift;
+                            const uint64_t value = (src.row(y)[x] & from[c]) >> shift;
+                            pixel |= static_cast<uint32_t>((value * toMax + max / 2) / max) << toShift;
+                        }
+                        dst.row(y)[x] = pixel;
+                    }
+                }
+            });
+
+            return out;
+        }
+
+        /// Copy with the masks of the other image
+        const std::unique_ptr<const BMP_32bit> copy;
+
+        const BMP_32bit &image;
+    };
+}
+
+/// Exits if two images have different dimensions
+template<typename Image>
+static void assertSameDimensions(const typename Image::ConstView &a, const typename Image::ConstView &b) {
+    if (a.width() != b.width() || a.height() != b.height()) {
+        std::cerr << "BMP_Compare: Different dimensions." << std::endl;
+        std::exit(1);
+    }
+}
+
+/// Whether n bytes are the same once masked with the mask repeated every 4 bytes
+static bool sameBytes(const uint8_t *a, const uint8_t *b, const size_t &n, const uint32_t &mask) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i m = _mm_set1_epi32(mask), zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(_mm_xor_si128(va, vb), m), zero)) != 0xFFFF)
+            return false;
+    }
+#endif
+
+    for (; i < n; ++i)
+        if ((a[i] ^ b[i]) & mask >> (i % 4 * 8))
+            return false;
+
+    return true;
+}
+
+/**
+ * @brief Sum of the squared differences and largest difference of n masked bytes.
+ *
+ * @param squares[in, out] Sum of the squared differences, added to
+ * @param max[in, out] Largest difference, updated
+ * @return Whether any byte differs
+ */
+static bool compareBytes(const uint8_t *a, const uint8_t *b, const size_t &n, const uint32_t &mask, uint64_t &squares,
+                         uint8_t &max) {
+    uint8_t any = 0;
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i m = _mm_set1_epi32(mask), zero = _mm_setzero_si128();
+    __m128i largest = zero;
+    while (i + 16 <= n) {
+        // Squares are added in 32-bit lanes, 2 * 255 ^ 2 per lane and iteration, then moved to 64 bits
+        __m128i sum = zero;
+        for (uint32_t k = 0; k < 8192 && i + 16 <= n; ++k, i += 16) {
+            const __m128i va = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)), m);
+            const __m128i vb = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)), m);
+            const __m128i d = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            largest = _mm_max_epu8(largest, d);
+
+            const __m128i lo = _mm_unpacklo_epi8(d, zero), hi = _mm_unpackhi_epi8(d, zero);
+            sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+        }
+
+        uint32_t lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), sum);
+        squares += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    uint8_t errors[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(errors), largest);
+    for (const uint8_t &d : errors) {
+        max = std::max(max, d);
+        any |= d;
+    }
+#endif
+
+    for (; i < n; ++i) {
+        const uint8_t byteMask = mask >> (i % 4 * 8);
+        const uint8_t x = a[i] & byteMask, y = b[i] & byteMask;
+        const uint8_t d = x > y ? x - y : y - x;
+        squares += d * d;
+        max = std::max(max, d);
+        any |= d;
+    }
+
+    return any;
+}
+
+/// SSIM of a window of n pixels, from the sums of the values, squares and products
+static double ssimWindow(const double &n, const double &a, const double &b, const double &aa, const double &bb,
+                         const double &ab) {
+    const double c1 = 0.01 * 255 * 0.01 * 255, c2 = 0.03 * 255 * 0.03 * 255;
+    const double ma = a / n, mb = b / n;
+    const double va = aa / n - ma * ma, vb = bb / n - mb * mb, cov = ab / n - ma * mb;
+
+    return (2 * ma * mb + c1) * (2 * cov + c2) / ((ma * ma + mb * mb + c1) * (va + vb + c2));
+}
+
+template<typename Image>
+bool BMP_Compare::equal(const Image &a, const Image &b) {
+    const BMP_Interleaved<Image> ia(a);
+    const SameMasks<Image> ib(b, a);
+    const typename Image::ConstView va = ia->view(), vb = ib->view();
+    if (va.width() != vb.width() || va.height() != vb.height())
+        return false;
+
+    const uint32_t mask = colourBits(a);
+    const size_t rowBytes = static_cast<size_t>(va.width()) * sizeof(typename Image::Pixel);
+    std::atomic<bool> same(true);
+
+    BMP_Parallel::forRows(0, va.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end && same.load(std::memory_order_relaxed); ++y)
+            if (!sameBytes(va.bytes(y), vb.bytes(y), rowBytes, mask))
+                same.store(false, std::memory_order_relaxed);
+    });
+
+    return same;
+}
+
+template<typename Image>
+Difference BMP_Compare::diff(const Image &a, const Image &b) {
+    typedef typename Image::Pixel Pixel;
+
+    const BMP_Interleaved<Image> ia(a);
+    const SameMasks<Image> ib(b, a);
+    const typename Image::ConstView va = ia->view(), vb = ib->view();
+    assertSameDimensions<Image>(va, vb);
+
+    const uint32_t mask = colourBits(a);
+    const int32_t w = va.width();
+    const size_t rowBytes = static_cast<size_t>(w) * sizeof(Pixel);
+
+    // Corners of the bounding box, empty if left > right
+    int32_t left = std::numeric_limits<int32_t>::max(), top = left, right = -1, bottom = -1;
+    uint64_t pixels = 0, squares = 0;
+    uint8_t maxError = 0;
+    std::mutex mutex;
+
+    BMP_Parallel::forRows(0, va.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        int32_t l = std::numeric_limits<int32_t>::max(), t = l, r = -1, bt = -1;
+        uint64_t p = 0, s = 0;
+        uint8_t m = 0;
+
+        for (int32_t y = begin; y < end; ++y) {
+            const uint8_t *ra = va.bytes(y), *rb = vb.bytes(y);
+            if (!compareBytes(ra, rb, rowBytes, mask, s, m))
+                continue;
+
+            // Only rows with differences are compared pixel by pixel
+            t = std::min(t, y);
+            bt = y;
+            for (int32_t x = 0; x < w; ++x) {
+                if (sameBytes(ra + x * sizeof(Pixel), rb + x * sizeof(Pixel), sizeof(Pixel), mask))
+                    continue;
+
+                l = std::min(l, x);
+                r = std::max(r, x);
+                ++p;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        left = std::min(left, l);
+        top = std::min(top, t);
+        right = std::max(right, r);
+        bottom = std::max(bottom, bt);
+        pixels += p;
+        squares += s;
+        maxError = std::max(maxError, m);
+    });
+
+    Difference out = {0, 0, 0, 0, pixels, maxError, std::numeric_limits<double>::infinity()};
+    if (pixels) {
+        out.x = left;
+        out.y = top;
+        out.w = right - left + 1;
+        out.h = bottom - top + 1;
+
+        // Mean of the squared differences over every channel of every pixel
+        uint8_t channels = 0;
+        for (uint8_t i = 0; i < sizeof(Pixel); ++i)
+            channels += (mask >> (i * 8) & 0xFFu) != 0;
+
+        const double mse = static_cast<double>(squares) / (static_cast<double>(w) * va.height() * channels);
+        out.psnr = 10 * std::log10(255.0 * 255.0 / mse);
+    }
+
+    return out;
+}
+
+template<typename Image>
+double BMP_Compare::ssim(const Image &a, const Image &b) {
+    typedef typename Image::Pixel Pixel;
+
+    const BMP_Interleaved<Image> ia(a);
+    const SameMasks<Image> ib(b, a);
+    const typename Image::ConstView va = ia->view(), vb = ib->view();
+    assertSameDimensions<Image>(va, vb);
+
+    // Offsets and masks of the bytes holding colour bits
+    const uint32_t mask = colourBits(a);
+    std::vector<uint8_t> offsets, masks;
+    for (uint8_t i = 0; i < sizeof(Pixel); ++i) {
+        if (mask >> (i * 8) & 0xFFu) {
+            offsets.push_back(i);
+            masks.push_back(mask >> (i * 8));
+        }
+    }
+
+    const size_t channels = offsets.size();
+    const int32_t w = va.width(), h = va.height(), bw = w / 4, bh = h / 4;
+    if (!w || !h || !channels)
+        return 1;
+
+    // Sums of a block (or window) of one channel
+    struct Sums {
+        uint64_t a, b, aa, bb, ab;
+    };
+
+    // Sums of the pixels x0 to x1 - 1 of rows y0 to y1 - 1, for each channel
+    const auto sums = [&](const int32_t &x0, const int32_t &x1, const int32_t &y0, const int32_t &y1, Sums *out) {
+        for (size_t c = 0; c < channels; ++c)
+            out[c] = {0, 0, 0, 0, 0};
+
+        for (int32_t y = y0; y < y1; ++y) {
+            const uint8_t *ra = va.bytes(y), *rb = vb.bytes(y);
+            for (int32_t x = x0; x < x1; ++x) {
+                for (size_t c = 0; c < channels; ++c) {
+                    const uint32_t p = ra[x * sizeof(Pixel) + offsets[c]] & masks[c];
+                    const uint32_t q = rb[x * sizeof(Pixel) + offsets[c]] & masks[c];
+                    out[c].a += p;
+                    out[c].b += q;
+                    out[c].aa += p * p;
+                    out[c].bb += q * q;
+                    out[c].ab += p * q;
+                }
+            }
+        }
+    };
+
+    // A single window for images smaller than a window
+    if (bw < 2 || bh < 2) {
+        std::vector<Sums> total(channels);
+        sums(0, w, 0, h, total.data());
+
+        double ssim = 0;
+        for (const Sums &s : total)
+            ssim += ssimWindow(static_cast<double>(w) * h, s.a, s.b, s.aa, s.bb, s.ab);
+
+        return ssim / channels;
+    }
+
+    std::vector<Sums> blocks(static_cast<size_t>(bw) * bh * channels);
+    BMP_Parallel::forRows(0, bh, [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t by = begin; by < end; ++by)
+            for (int32_t bx = 0; bx < bw; ++bx)
+                sums(bx * 4, bx * 4 + 4, by * 4, by * 4 + 4, &blocks[(static_cast<size_t>(by) * bw + bx) * channels]);
+    }, 4);
+
+    // Each window is made of 2 by 2 blocks
+    double total = 0;
+    std::mutex mutex;
+    BMP_Parallel::forRows(0, bh - 1, [&](const int32_t &begin, const int32_t &end) -> void {
+        double local = 0;
+        for (int32_t by = begin; by < end; ++by) {
+            for (int32_t bx = 0; bx + 1 < bw; ++bx) {
+                for (size_t c = 0; c < channels; ++c) {
+                    Sums s = {0, 0, 0, 0, 0};
+                    for (int32_t k = 0; k < 4; ++k) {
+                        const Sums &block = blocks[((static_cast<size_t>(by) + k / 2) * bw + bx + k % 2) * channels + c];
+                        s.a += block.a;
+                        s.b += block.b;
+                        s.aa += block.aa;
+                        s.bb += block.bb;
+                        s.ab += block.ab;
+                    }
+
+                    local += ssimWindow(64, s.a, s.b, s.aa, s.bb, s.ab);
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        total += local;
+    }, 4);
+
+    return total / (static_cast<double>(bw - 1) * (bh - 1) * channels);
+}
+
+/// Instantiates every function for an image class
+#define BMP_COMPARE_INSTANTIATE(Image) \
+    template bool BMP_Compare::equal(const Image &, const Image &); \
+    template Difference BMP_Compare::diff(const Image &, const Image &); \
+    template double BMP_Compare::ssim(const Image &, const Image &);
+
+BMP_COMPARE_INSTANTIATE(BMP_24bit)
+BMP_COMPARE_INSTANTIATE(BMP_32bit)
@@ -0,0 +1,69 @@
+#ifndef BMP_BMP_COMPARE_H
+#define BMP_BMP_COMPARE_H
+
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include <cstdint>
+
+/**
+ * @brief Comparison of images: equality, differences and similarity.
+ *
+ * Should not be constructed, it only groups static functions. Each function is available for BMP_24bit (either
+ * storage) and BMP_32bit. Pixels are compared through views, so the row-order and the storage of the images do not
+ * matter, and only the colour bits of 32-bit pixels are compared (the bits of the red, green and blue masks of the
+ * first image, see BMP_BM::getPixelMasks()), so the unused byte of RGB888 pixels is ignored. If the masks of the
+ * second image differ, a copy of it with its channels moved to the masks of the first, and scaled to their widths, is
+ * compared instead, so that e.g. a BGRX and an RGBX image of the same colours are equal. Errors are measured on each
+ * byte of a pixel that holds colour bits, as 8-bit channels.
+ *
+ * Rows are compared 16 bytes at a time with SSE2 when compiled with SSE2 enabled, and strips of rows are compared in
+ * parallel.
+ */
+class BMP_Compare {
+public:
+    BMP_Compare() = delete;
+
+    /// Differences between two images
+    struct Difference {
+        int32_t x, y, w, h; ///< Bounding box of the differing pixels, all 0 if there are none
+        uint64_t pixels;    ///< Number of differing pixels
+        uint8_t maxError;   ///< Largest difference of a channel
+        double psnr;        ///< Peak signal-to-noise ratio in dB, infinity if the images are the same
+    };
+
+    /**
+     * @brief Whether two images have the same dimensions and pixels.
+     *
+     * Every thread stops as soon as any of them finds a difference.
+     *
+     * @param a[in] First image
+     * @param b[in] Second image
+     */
+    template<typename Image>
+    static bool equal(const Image &a, const Image &b);
+
+    /**
+     * @brief Differences between two images of the same dimensions, in a single pass.
+     *
+     * @param a[in] First image
+     * @param b[in] Second image
+     * @return The differences
+     */
+    template<typename Image>
+    static Difference diff(const Image &a, const Image &b);
+
+    /**
+     * @brief Structural similarity (SSIM) of two images of the same dimensions.
+     *
+     * Computed on 8 by 8 windows every 4 pixels, from the sums of 4 by 4 blocks, and averaged over the windows and the
+     * channels. Images smaller than a window are compared as a single window.
+     *
+     * @param a[in] First image
+     * @param b[in] Second image
+     * @return The SSIM, 1 for images with the same pixels
+     */
+    template<typename Image>
+    static double ssim(const Image &a, const Image &b);
+};
+
+#endif //BMP_BMP_COMPARE_H
@@ -0,0 +1,134 @@
+#include "bmp_composite.h"
+#include "bmp_parallel.h"
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+typedef BMP_Composite::Mode Mode;
+
+/// v / 255 rounded to the nearest integer, for v up to 255 * 255
+static inline uint32_t div255(const uint32_t &v) {
+    const uint32_t t = v + 128;
+    return (t + (t >> 8u)) >> 8u;
+}
+
+/// Blends a single pixel
+template<Mode mode>
+static inline uint32_t blendPixel(const uint32_t &s, const uint32_t &d) {
+    const uint32_t a = s >> 24u;
+
+    uint32_t out = 0;
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+        const uint32_t sc = s >> shift & 0xFFu, dc = d >> shift & 0xFFu;
+        const bool alpha = shift == 24;
+
+        uint32_t c;
+        if (mode == Mode::overPremultiplied) {
+            c = std::min(sc + div255(dc * (255 - a)), 255u);
+        } else {
+            // Colour of the source for the blend mode, the alpha is always taken from the source
+            uint32_t b = sc;
+            if (!alpha && mode == Mode::multiply)
+                b = div255(sc * dc);
+            else if (!alpha && mode == Mode::screen)
+                b = sc + dc - div255(sc * dc);
+            else if (!alpha && mode == Mode::add)
+                b = std::min(sc + dc, 255u);
+
+            c = div255(b * (alpha ? 255 : a) + dc * (255 - a));
+        }
+
+        out |= c << shift;
+    }
+
+    return out;
+}
+
+#ifdef __SSE2__
+/// v / 255 rounded to the nearest integer in every 16-bit lane, for v up to 255 * 255
+static inline __m128i div255(const __m128i &v) {
+    const __m128i t = _mm_add_epi16(v, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+/// Blends 2 pixels whose channels are in 16-bit lanes, the result may need saturating to 8 bits
+template<Mode mode>
+static inline __m128i blendPixels(const __m128i &s, const __m128i &d) {
+    const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i inv = _mm_sub_epi16(_mm_set1_epi16(255), a);
+    if (mode == Mode::overPremultiplied)
+        return _mm_add_epi16(s, div255(_mm_mullo_epi16(d, inv)));
+
+    const __m128i alpha = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+
+    __m128i b = s;
+    if (mode == Mode::multiply)
+        b = div255(_mm_mullo_epi16(s, d));
+    else if (mode == Mode::screen)
+        b = _mm_sub_epi16(_mm_add_epi16(s, d), div255(_mm_mullo_epi16(s, d)));
+    else if (mode == Mode::add)
+        b = _mm_min_epi16(_mm_add_epi16(s, d), _mm_set1_epi16(255));
+
+    // The alpha is always taken from the source and weighted by 255 instead of a
+    b = _mm_or_si128(_mm_andnot_si128(alpha, b), _mm_and_si128(alpha, s));
+    const __m128i w = _mm_or_si128(_mm_andnot_si128(alpha, a), _mm_and_si128(alpha, _mm_set1_epi16(255)));
+
+    return div255(_mm_add_epi16(_mm_mullo_epi16(b, w), _mm_mullo_epi16(d, inv)));
+}
+#endif
+
+/// Blends a row of n pixels
+template<Mode mode>
+static void blendRow(const uint32_t *src, uint32_t *dst, const int32_t &n) {
+    int32_t x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 4 <= n; x += 4) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + x));
+
+        const __m128i lo = blendPixels<mode>(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero));
+        const __m128i hi = blendPixels<mode>(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; x < n; ++x)
+        dst[x] = blendPixel<mode>(src[x], dst[x]);
+}
+
+void BMP_Composite::blend(const BMP_32bit::ConstView &src, const BMP_32bit::View &dst, const int32_t &x,
+                          const int32_t &y, const Mode &mode) {
+    // Part of the source inside the destination
+    const int64_t left = std::max<int64_t>(0, -static_cast<int64_t>(x));
+    const int64_t top = std::max<int64_t>(0, -static_cast<int64_t>(y));
+    const int64_t right = std::min<int64_t>(src.width(), static_cast<int64_t>(dst.width()) - x);
+    const int64_t bottom = std::min<int64_t>(src.height(), static_cast<int64_t>(dst.height()) - y);
+    if (left >= right || top >= bottom)
+        return;
+
+    void (*row)(const uint32_t *, uint32_t *, const int32_t &);
+    switch (mode) {
+        case Mode::overPremultiplied:
+            row = blendRow<Mode::overPremultiplied>;
+            break;
+        case Mode::multiply:
+            row = blendRow<Mode::multiply>;
+            break;
+        case Mode::screen:
+            row = blendRow<Mode::screen>;
+            break;
+        case Mode::add:
+            row = blendRow<Mode::add>;
+            break;
+        default:
+            row = blendRow<Mode::over>;
+    }
+
+    BMP_Parallel::forRows(top, bottom, [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t i = begin; i < end; ++i)
+            row(src.row(i) + left, dst.row(y + i) + x + left, right - left);
+    });
+}
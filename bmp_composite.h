@@ -0,0 +1,46 @@
+#ifndef BMP_BMP_COMPOSITE_H
+#define BMP_BMP_COMPOSITE_H
+
+#include "bmp_32-bit.h"
+#include <cstdint>
+
+/**
+ * @brief Alpha compositing of 32-bit images.
+ *
+ * Should not be constructed, it only groups static functions. Pixels are read as B, G, R, A bytes (hex format:
+ * AA RR GG BB), the alpha byte being the unused byte of an RGB888 BMP_32bit pixel. 255 is opaque.
+ *
+ * Blending is done in 8-bit fixed-point with exact rounding of every division by 255, 4 pixels at a time with SSE2 when
+ * compiled with SSE2 enabled, and rows are processed in parallel.
+ */
+class BMP_Composite {
+public:
+    BMP_Composite() = delete;
+
+    /// How a source pixel s is combined with a destination pixel d, a being the alpha of s
+    enum class Mode {
+        over,              ///< Porter-Duff over with straight alpha: d + (s - d) * a for the colour
+        overPremultiplied, ///< Porter-Duff over with premultiplied alpha: s + d * (1 - a) for every channel
+        multiply,          ///< over with s * d as the colour of s
+        screen,            ///< over with s + d - s * d as the colour of s
+        add                ///< over with s + d (saturated) as the colour of s
+    };
+
+    /**
+     * @brief Blends a source into a destination, with the top-left corner of the source at (x, y).
+     *
+     * Only the part of the source that lies inside the destination is blended, (x, y) may be negative. Except for
+     * overPremultiplied, the colour is blended as if the destination were opaque, and the alpha of the result is
+     * a + alpha of d * (1 - a).
+     *
+     * @param src[in] Source pixels, e.g. the view() of a BMP_32bit
+     * @param dst[in, out] Destination pixels
+     * @param x[in] x of the source in the destination
+     * @param y[in] y of the source in the destination
+     * @param mode[in] Blend mode
+     */
+    static void blend(const BMP_32bit::ConstView &src, const BMP_32bit::View &dst, const int32_t &x, const int32_t &y,
+                      const Mode &mode = Mode::over);
+};
+
+#endif //BMP_BMP_COMPOSITE_H
@@ -0,0 +1,188 @@
+#include "bmp_convert.h"
+#include "bmp_parallel.h"
+#include "bmp_interleaved.h"
+#include <vector>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+/// Weights of red, green and blue in 8-bit fixed-point, they add up to 256
+struct Weights {
+    uint16_t r, g, b;
+};
+
+static Weights weights(const BMP_Convert::Luma &luma) {
+    return luma == BMP_Convert::Luma::bt709 ? Weights{54, 183, 19} : Weights{77, 150, 29};
+}
+
+/// Weighted sum of a colour, rounded
+static inline uint8_t grey(const Weights &w, const uint32_t &r, const uint32_t &g, const uint32_t &b) {
+    return (w.r * r + w.g * g + w.b * b + 128) >> 8u;
+}
+
+/// Converts a row of 24-bit pixels (B, G, R bytes) to greyscale
+static void greyRow(const Weights &w, const uint8_t *src, uint8_t *dst, const int32_t &n) {
+    int32_t x = 0;
+#ifdef __SSSE3__
+    // Pixels 0 to 4 are taken from the bytes at 0, pixels 5 to 7 from the bytes at 8, each channel into 16-bit lanes
+    const __m128i lo[3] = {
+            _mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1, -1, -1, -1, -1, -1, -1),
+            _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1, -1, -1, -1, -1, -1),
+            _mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1)
+    };
+    const __m128i hi[3] = {
+            _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 7, -1, 10, -1, 13, -1),
+            _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 8, -1, 11, -1, 14, -1),
+            _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 9, -1, 12, -1, 15, -1)
+    };
+    const __m128i wb = _mm_set1_epi16(w.b), wg = _mm_set1_epi16(w.g), wr = _mm_set1_epi16(w.r);
+    const __m128i half = _mm_set1_epi16(128);
+
+    // 8 pixels, the sum is at most 256 * 255 so it does not overflow 16 bits
+    const auto eight = [&](const uint8_t *p) -> __m128i {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 8));
+
+        __m128i sum = _mm_mullo_epi16(_mm_or_si128(_mm_shuffle_epi8(a, lo[0]), _mm_shuffle_epi8(b, hi[0])), wb);
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(_mm_or_si128(_mm_shuffle_epi8(a, lo[1]), _mm_shuffle_epi8(b, hi[1])), wg));
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(_mm_or_si128(_mm_shuffle_epi8(a, lo[2]), _mm_shuffle_epi8(b, hi[2])), wr));
+        return _mm_srli_epi16(_mm_add_epi16(sum, half), 8);
+    };
+
+    for (; x + 16 <= n; x += 16) {
+        const __m128i g = _mm_packus_epi16(eight(src + 3 * x), eight(src + 3 * x + 24));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), g);
+    }
+#endif
+
+    for (; x < n; ++x)
+        dst[x] = grey(w, src[3 * x + 2], src[3 * x + 1], src[3 * x]);
+}
+
+/// Converts a row of RGB888 pixels to greyscale
+static void greyRow(const Weights &w, const uint32_t *src, uint8_t *dst, const int32_t &n) {
+    int32_t x = 0;
+#ifdef __SSSE3__
+    // Multiplies B, G and R, A by their weights in pairs, then adds the pairs of each pixel together
+    const __m128i weight = _mm_setr_epi16(w.b, w.g, w.r, 0, w.b, w.g, w.r, 0);
+    const __m128i zero = _mm_setzero_si128(), half = _mm_set1_epi32(128);
+
+    // 4 pixels, as 32-bit lanes
+    const auto four = [&](const uint32_t *p) -> __m128i {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const __m128i sum = _mm_hadd_epi32(_mm_madd_epi16(_mm_unpacklo_epi8(a, zero), weight),
+                                           _mm_madd_epi16(_mm_unpackhi_epi8(a, zero), weight));
+        return _mm_srli_epi32(_mm_add_epi32(sum, half), 8);
+    };
+
+    for (; x + 16 <= n; x += 16) {
+        const __m128i lo = _mm_packs_epi32(four(src + x), four(src + x + 4));
+        const __m128i hi = _mm_packs_epi32(four(src + x + 8), four(src + x + 12));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; x < n; ++x)
+        dst[x] = grey(w, src[x] >> 16u & 0xFFu, src[x] >> 8u & 0xFFu, src[x] & 0xFFu);
+}
+
+BMP_24bit BMP_Convert::toBMP_24bit(const BMP_8bit &n) {
+    BMP_24bit out(n.getInfoHeader().biWidth, n.getInfoHeader().biHeight);
+    const BMP_8bit::ConstView src = n.view();
+    const BMP_24bit::View dst = out.view();
+
+    for (int32_t y = 0; y < src.height(); ++y)
+        n.getPalette().expand(src.row(y), src.width(), dst.bytes(y));
+
+    return out;
+}
+
+BMP_24bit BMP_Convert::toBMP_24bit(const BMP_1bit &n) {
+    BMP_24bit out(n.getInfoHeader().biWidth, n.getInfoHeader().biHeight);
+    const BMP_Palette palette = binaryPalette(n);
+    const BMP_1bit::ConstView src = n.view();
+    const BMP_24bit::View dst = out.view();
+
+    for (int32_t y = 0; y < src.height(); ++y)
+        palette.expand(src.row(y), src.width(), dst.bytes(y));
+
+    return out;
+}
+
+BMP_32bit BMP_Convert::toBMP_32bit(const BMP_8bit &n, const uint8_t &alpha) {
+    BMP_32bit out(n.getInfoHeader().biWidth, n.getInfoHeader().biHeight);
+    const BMP_8bit::ConstView src = n.view();
+    const BMP_32bit::View dst = out.view();
+
+    for (int32_t y = 0; y < src.height(); ++y)
+        n.getPalette().expand(src.row(y), src.width(), dst.row(y), alpha);
+
+    return out;
+}
+
+BMP_32bit BMP_Convert::toBMP_32bit(const BMP_1bit &n, const uint8_t &alpha) {
+    BMP_32bit out(n.getInfoHeader().biWidth, n.getInfoHeader().biHeight);
+    const BMP_Palette palette = binaryPalette(n);
+    const BMP_1bit::ConstView src = n.view();
+    const BMP_32bit::View dst = out.view();
+
+    for (int32_t y = 0; y < src.height(); ++y)
+        palette.expand(src.row(y), src.width(), dst.row(y), alpha);
+
+    return out;
+}
+
+BMP_8bit BMP_Convert::toGreyscale(const BMP_24bit &n, const Luma &luma) {
+    BMP_8bit out(n.getInfoHeader().biWidth, n.getInfoHeader().biHeight);
+    const Weights w = weights(luma);
+    const BMP_Interleaved<BMP_24bit> interleaved(n);
+    const BMP_24bit::ConstView src = interleaved->view();
+    const BMP_8bit::View dst = out.view();
+
+    BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y)
+            greyRow(w, src.bytes(y), dst.row(y), src.width());
+    });
+
+    return out;
+}
+
+BMP_8bit BMP_Convert::toGreyscale(const BMP_32bit &n, const Luma &luma) {
+    BMP_8bit out(n.getInfoHeader().biWidth, n.getInfoHeader().biHeight);
+    const Weights w = weights(luma);
+    const std::vector<uint32_t> masks = n.getPixelMasks();
+    const bool rgb888 = masks[0] == 0xFF0000 && masks[1] == 0xFF00 && masks[2] == 0xFF;
+    const BMP_32bit::ConstView src = n.view();
+    const BMP_8bit::View dst = out.view();
+
+    BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y) {
+            const uint32_t *in = src.row(y);
+            uint8_t *o = dst.row(y);
+
+            if (rgb888) {
+                greyRow(w, in, o, src.width());
+            } else {
+                for (int32_t x = 0; x < src.width(); ++x)
+                    o[x] = grey(w, BMP_BM::toByte(in[x], masks[0]), BMP_BM::toByte(in[x], masks[1]),
+                                BMP_BM::toByte(in[x], masks[2]));
+            }
+        }
+    });
+
+    return out;
+}
+
+BMP_Palette BMP_Convert::binaryPalette(const BMP_1bit &n) {
+    std::vector<uint8_t> table(4 * 256);
+    for (uint32_t i = 0; i < 256; ++i) {
+        const uint32_t colour = n.getPalette()[i != 0];
+
+        table[4 * i] = colour;
+        table[4 * i + 1] = colour >> 8u;
+        table[4 * i + 2] = colour >> 16u;
+    }
+
+    return BMP_Palette(table);
+}
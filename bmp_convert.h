@@ -0,0 +1,73 @@
+#ifndef BMP_BMP_CONVERT_H
+#define BMP_BMP_CONVERT_H
+
+#include "bmp_1-bit.h"
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include <cstdint>
+
+/**
+ * @brief Conversions between colour depths.
+ *
+ * Should not be constructed, it only groups static functions. The converted image keeps the dimensions and row-order
+ * of the source.
+ */
+class BMP_Convert {
+public:
+    BMP_Convert() = delete;
+
+    /// Weights of the red, green and blue channels when converting to greyscale
+    enum class Luma {
+        bt601, ///< ITU-R BT.601, 0.299 R + 0.587 G + 0.114 B
+        bt709  ///< ITU-R BT.709, 0.2126 R + 0.7152 G + 0.0722 B
+    };
+
+    ///@{
+    /**
+     * @brief Expands the colour indices of a palette image to 24-bit colours, a row at a time.
+     *
+     * @param n[in] Source image
+     * @return The 24-bit image
+     */
+    static BMP_24bit toBMP_24bit(const BMP_8bit &n);
+
+    static BMP_24bit toBMP_24bit(const BMP_1bit &n);
+    ///@}
+
+    ///@{
+    /**
+     * @brief Expands the colour indices of a palette image to 32-bit colours, a row at a time.
+     *
+     * @param n[in] Source image
+     * @param alpha[in] Value of the unused (alpha) byte of each pixel
+     * @return The 32-bit image, without bitmask
+     */
+    static BMP_32bit toBMP_32bit(const BMP_8bit &n, const uint8_t &alpha = 0);
+
+    static BMP_32bit toBMP_32bit(const BMP_1bit &n, const uint8_t &alpha = 0);
+    ///@}
+
+    ///@{
+    /**
+     * @brief Converts a colour image to a greyscale image with the default colour table.
+     *
+     * Weights are applied in 8-bit fixed-point. Pixels are de-interleaved with SSSE3 shuffles when compiled with
+     * SSSE3 enabled, and rows are processed in parallel. 32-bit images with a bitmask other than RGB888 are converted
+     * with a scalar loop, each channel scaled to 8 bits first.
+     *
+     * @param n[in] Source image
+     * @param luma[in] Weights of the channels
+     * @return The 8-bit image
+     */
+    static BMP_8bit toGreyscale(const BMP_24bit &n, const Luma &luma = Luma::bt601);
+
+    static BMP_8bit toGreyscale(const BMP_32bit &n, const Luma &luma = Luma::bt601);
+    ///@}
+
+private:
+    /// Palette of a 1-bit image where every non-zero index is the second colour, like save() treats them
+    static BMP_Palette binaryPalette(const BMP_1bit &n);
+};
+
+#endif //BMP_BMP_CONVERT_H
@@ -0,0 +1,187 @@
+#include "bmp_dither.h"
+#include "bmp_parallel.h"
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// Fills a row of greyscale values, called with the row number and the destination
+typedef std::function<void(const int32_t &, uint8_t *)> GreyRow;
+
+/// Luma (BT.601) of a colour, weights in 8-bit fixed-point
+static inline uint8_t luma(const uint32_t &r, const uint32_t &g, const uint32_t &b) {
+    return (77 * r + 150 * g + 29 * b + 128) >> 8u;
+}
+
+/// Greyscale rows of an 8-bit image, through its colour table unless it is the default grey one
+static GreyRow greyRows(const BMP_8bit &n) {
+    const BMP_8bit::ConstView src = n.view();
+
+    bool identity = true;
+    uint8_t lut[256];
+    for (uint32_t i = 0; i < 256; ++i) {
+        const uint32_t colour = n.getPalette()[i];
+        lut[i] = luma(colour >> 16u & 0xFFu, colour >> 8u & 0xFFu, colour & 0xFFu);
+        identity = identity && colour == BMP_8bit::toRGB888(i);
+    }
+
+    return [src, identity, lut](const int32_t &y, uint8_t *dst) -> void {
+        const uint8_t *row = src.row(y);
+        for (int32_t x = 0; x < src.width(); ++x)
+            dst[x] = identity ? row[x] : lut[row[x]];
+    };
+}
+
+/// Greyscale rows of a 24-bit image
+static GreyRow greyRows(const BMP_24bit &n) {
+    if (n.getStorage() == BMP_24bit::Storage::planar) {
+        const BMP_24bit::ConstPlaneView b = n.plane(BMP_24bit::Channel::blue);
+        const BMP_24bit::ConstPlaneView g = n.plane(BMP_24bit::Channel::green);
+        const BMP_24bit::ConstPlaneView r = n.plane(BMP_24bit::Channel::red);
+
+        return [b, g, r](const int32_t &y, uint8_t *dst) -> void {
+            for (int32_t x = 0; x < b.width(); ++x)
+                dst[x] = luma(r.row(y)[x], g.row(y)[x], b.row(y)[x]);
+        };
+    }
+
+    const BMP_24bit::ConstView src = n.view();
+
+    return [src](const int32_t &y, uint8_t *dst) -> void {
+        const BMP_24bit::Pixel *row = src.row(y);
+        for (int32_t x = 0; x < src.width(); ++x)
+            dst[x] = luma(row[x].r, row[x].g, row[x].b);
+    };
+}
+
+/// 8x8 Bayer matrix
+static const uint8_t bayer[8][8] = {
+        {0,  32, 8,  40, 2,  34, 10, 42},
+        {48, 16, 56, 24, 50, 18, 58, 26},
+        {12, 44, 4,  36, 14, 46, 6,  38},
+        {60, 28, 52, 20, 62, 30, 54, 22},
+        {3,  35, 11, 43, 1,  33, 9,  41},
+        {51, 19, 59, 27, 49, 17, 57, 25},
+        {15, 47, 7,  39, 13, 45, 5,  37},
+        {63, 31, 55, 23, 61, 29, 53, 21}
+};
+
+static BMP_1bit ordered(const BMP::InfoHeader &info, const GreyRow &grey) {
+    BMP_1bit out(info.biWidth, info.biHeight);
+    const BMP_1bit::View dst = out.view();
+
+    BMP_Parallel::forRows(0, dst.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        std::vector<uint8_t> row(dst.width()), threshold(dst.width() + 16);
+        for (int32_t y = begin; y < end; ++y) {
+            // Thresholds of this row, a pixel is white if its value is larger
+            for (int32_t x = 0; x < dst.width() + 16; ++x)
+                threshold[x] = bayer[y % 8][x % 8] * 4 + 2;
+
+            grey(y, &row[0]);
+            uint8_t *o = dst.row(y);
+
+            int32_t x = 0;
+#ifdef __SSE2__
+            const __m128i one = _mm_set1_epi8(1);
+            for (; x + 16 <= dst.width(); x += 16) {
+                const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&row[x]));
+                const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&threshold[x]));
+
+                // Saturated difference is non-zero only if the value is larger than the threshold
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(o + x), _mm_min_epu8(_mm_subs_epu8(g, t), one));
+            }
+#endif
+            for (; x < dst.width(); ++x)
+                o[x] = row[x] > threshold[x];
+        }
+    });
+
+    return out;
+}
+
+static BMP_1bit floydSteinberg(const BMP::InfoHeader &info, const GreyRow &grey) {
+    BMP_1bit out(info.biWidth, info.biHeight);
+    const BMP_1bit::View dst = out.view();
+    const int32_t w = dst.width(), h = dst.height();
+    if (!w || !h)
+        return out;
+
+    // Pixels processed between two progress updates
+    const int32_t chunk = 64;
+
+    // Each thread takes every threads-th row. Row y reads its error from errors[y % (threads + 1)] and diffuses into
+    // errors[(y + 1) % (threads + 1)], so a buffer is only reused by the thread that last read it.
+    const int32_t threads = std::max<int32_t>(1, std::min<int64_t>(BMP_Parallel::getThreads(), h));
+    std::vector<std::vector<int16_t>> errors(threads + 1, std::vector<int16_t>(w + 2, 0));
+    std::vector<std::atomic<int32_t>> progress(h); // Number of pixels done in each row
+    for (std::atomic<int32_t> &p : progress)
+        p.store(0, std::memory_order_relaxed);
+
+    const auto worker = [&](const int32_t &first) -> void {
+        std::vector<uint8_t> row(w);
+        for (int32_t y = first; y < h; y += threads) {
+            grey(y, &row[0]);
+            const int16_t *in = &errors[y % (threads + 1)][1];
+            int16_t *next = &errors[(y + 1) % (threads + 1)][1];
+            std::fill(next - 1, next + w + 1, 0);
+
+            uint8_t *o = dst.row(y);
+            int32_t right = 0; // Error diffused to the pixel on the right
+            for (int32_t begin = 0; begin < w; begin += chunk) {
+                const int32_t end = std::min(w, begin + chunk);
+
+                // Wait until the row above has diffused all of its error into this chunk
+                if (y) {
+                    const int32_t needed = std::min(w, end + 1);
+                    while (progress[y - 1].load(std::memory_order_acquire) < needed)
+                        std::this_thread::yield();
+                }
+
+                for (int32_t x = begin; x < end; ++x) {
+                    const int32_t value = row[x] + ((in[x] + right + 8) >> 4);
+                    o[x] = value > 127;
+
+                    const int32_t error = value - (o[x] ? 255 : 0);
+                    right = error * 7;
+                    next[x - 1] += error * 3;
+                    next[x] += error * 5;
+                    next[x + 1] += error;
+                }
+
+                progress[y].store(end, std::memory_order_release);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int32_t i = 1; i < threads; ++i)
+        workers.emplace_back(worker, i);
+
+    worker(0);
+
+    for (std::thread &t : workers)
+        t.join();
+
+    return out;
+}
+
+BMP_1bit BMP_Dither::ordered(const BMP_8bit &n) {
+    return ::ordered(n.getInfoHeader(), greyRows(n));
+}
+
+BMP_1bit BMP_Dither::ordered(const BMP_24bit &n) {
+    return ::ordered(n.getInfoHeader(), greyRows(n));
+}
+
+BMP_1bit BMP_Dither::floydSteinberg(const BMP_8bit &n) {
+    return ::floydSteinberg(n.getInfoHeader(), greyRows(n));
+}
+
+BMP_1bit BMP_Dither::floydSteinberg(const BMP_24bit &n) {
+    return ::floydSteinberg(n.getInfoHeader(), greyRows(n));
+}
@@ -0,0 +1,49 @@
+#ifndef BMP_BMP_DITHER_H
+#define BMP_BMP_DITHER_H
+
+#include "bmp_1-bit.h"
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+
+/**
+ * @brief Dithering from 8-bit and 24-bit images down to black and white 1-bit images.
+ *
+ * Should not be constructed, it only groups static functions. Pixels are converted to their luma (BT.601) first, using
+ * the colour table for 8-bit images. The 1-bit image has the default colour table (0 is black, 1 is white) and keeps
+ * the dimensions and row-order of the source.
+ */
+class BMP_Dither {
+public:
+    BMP_Dither() = delete;
+
+    ///@{
+    /**
+     * @brief Ordered dithering with an 8x8 Bayer matrix.
+     *
+     * Every pixel is thresholded independently, 16 pixels at a time with SSE2, and rows are processed in parallel.
+     *
+     * @param n[in] Source image
+     * @return The dithered image
+     */
+    static BMP_1bit ordered(const BMP_8bit &n);
+
+    static BMP_1bit ordered(const BMP_24bit &n);
+    ///@}
+
+    ///@{
+    /**
+     * @brief Floyd-Steinberg error diffusion.
+     *
+     * Rows are processed in parallel as a wavefront, each row staying a few pixels behind the row above it so that
+     * the error diffused from the row above is always complete. The result does not depend on the number of threads.
+     *
+     * @param n[in] Source image
+     * @return The dithered image
+     */
+    static BMP_1bit floydSteinberg(const BMP_8bit &n);
+
+    static BMP_1bit floydSteinberg(const BMP_24bit &n);
+    ///@}
+};
+
+#endif //BMP_BMP_DITHER_H
@@ -0,0 +1,417 @@
+#include "bmp_draw.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+typedef BMP_Draw::Point Point;
+
+///@{
+/// Fills n pixels with a colour
+static inline void fillPixels(uint8_t *p, const size_t &n, const uint8_t &colour) {
+    std::memset(p, colour, n);
+}
+
+static inline void fillPixels(BMP_24bit::Pixel *p, const size_t &n, const BMP_24bit::Pixel &colour) {
+    if (!n)
+        return;
+
+    // Double the filled part with block copies
+    p[0] = colour;
+    for (size_t done = 1; done < n;) {
+        const size_t k = std::min(done, n - done);
+        std::memcpy(p + done, p, k * sizeof(BMP_24bit::Pixel));
+        done += k;
+    }
+}
+
+template<typename Pixel>
+static inline void fillPixels(Pixel *p, const size_t &n, const Pixel &colour) {
+    std::fill_n(p, n, colour);
+}
+///@}
+
+///@{
+/// Whether 2 pixels have the same value
+static inline bool same(const BMP_24bit::Pixel &a, const BMP_24bit::Pixel &b) {
+    return a.b == b.b && a.g == b.g && a.r == b.r;
+}
+
+template<typename Pixel>
+static inline bool same(const Pixel &a, const Pixel &b) {
+    return a == b;
+}
+///@}
+
+/// Integer division rounded up, d positive only
+static inline int64_t ceilDiv(const int64_t &n, const int64_t &d) {
+    return n >= 0 ? (n + d - 1) / d : -(-n / d);
+}
+
+namespace {
+    /// Pixels of an image, filled a span at a time
+    template<typename Image>
+    class Canvas {
+    public:
+        typedef typename Image::Pixel Pixel;
+
+        explicit Canvas(Image &n) : view(n.view()) {
+        }
+
+        int32_t width() const {
+            return view.width();
+        }
+
+        int32_t height() const {
+            return view.height();
+        }
+
+        /// Fills pixels x0 to x1 - 1 of row y, inside the image only
+        void fill(const int32_t &y, const int32_t &x0, const int32_t &x1, const Pixel &colour) const {
+            fillPixels(view.row(y) + x0, x1 - x0, colour);
+        }
+
+        /// Value of the pixel at (x, y), inside the image only
+        Pixel get(const int32_t &x, const int32_t &y) const {
+            return view.row(y)[x];
+        }
+
+    private:
+        typename Image::View view;
+    };
+
+    /// Pixels of a 24-bit image, the planes are filled a span at a time with the planar storage
+    template<>
+    class Canvas<BMP_24bit> {
+    public:
+        typedef BMP_24bit::Pixel Pixel;
+
+        explicit Canvas(BMP_24bit &n) : planar(n.getStorage() == BMP_24bit::Storage::planar) {
+            if (planar) {
+                planes[0] = n.plane(BMP_24bit::Channel::blue);
+                planes[1] = n.plane(BMP_24bit::Channel::green);
+                planes[2] = n.plane(BMP_24bit::Channel::red);
+            } else {
+                view = n.view();
+            }
+        }
+
+        int32_t width() const {
+            return planar ? planes[0].width() : view.width();
+        }
+
+        int32_t height() const {
+            return planar ? planes[0].height() : view.height();
+        }
+
+        void fill(const int32_t &y, const int32_t &x0, const int32_t &x1, const Pixel &colour) const {
+            if (planar) {
+                std::memset(planes[0].row(y) + x0, colour.b, x1 - x0);
+                std::memset(planes[1].row(y) + x0, colour.g, x1 - x0);
+                std::memset(planes[2].row(y) + x0, colour.r, x1 - x0);
+            } else {
+                fillPixels(view.row(y) + x0, x1 - x0, colour);
+            }
+        }
+
+        Pixel get(const int32_t &x, const int32_t &y) const {
+            return planar ? Pixel{planes[0].row(y)[x], planes[1].row(y)[x], planes[2].row(y)[x]} : view.row(y)[x];
+        }
+
+    private:
+        BMP_24bit::View view;
+        BMP_24bit::PlaneView planes[3];
+        bool planar;
+    };
+
+    /// Pixels of a bitmap, spans are filled with word masks
+    template<>
+    class Canvas<BMP_Bitmap> {
+    public:
+        typedef bool Pixel;
+
+        explicit Canvas(BMP_Bitmap &n) : n(n) {
+        }
+
+        int32_t width() const {
+            return n.width();
+        }
+
+        int32_t height() const {
+            return n.height();
+        }
+
+        void fill(const int32_t &y, const int32_t &x0, const int32_t &x1, const bool &colour) const {
+            uint64_t *row = n.row(y);
+            const int32_t q0 = x0 / 64, q1 = (x1 - 1) / 64;
+            const uint64_t first = ~0ull << (x0 % 64), last = ~0ull >> (63 - (x1 - 1) % 64);
+            const auto apply = [&](uint64_t &word, const uint64_t &mask) -> void {
+                word = colour ? word | mask : word & ~mask;
+            };
+
+            if (q0 == q1) {
+                apply(row[q0], first & last);
+            } else {
+                apply(row[q0], first);
+                std::fill(row + q0 + 1, row + q1, colour ? ~0ull : 0);
+                apply(row[q1], last);
+            }
+        }
+
+        bool get(const int32_t &x, const int32_t &y) const {
+            return n.row(y)[x / 64] >> (x % 64) & 1u;
+        }
+
+    private:
+        BMP_Bitmap &n;
+    };
+}
+
+/// Fills pixels x0 to x1 - 1 of row y, clipped to the canvas
+template<typename Image>
+static void span(const Canvas<Image> &canvas, const int64_t &y, const int64_t &x0, const int64_t &x1,
+                 const typename Image::Pixel &colour) {
+    if (y < 0 || y >= canvas.height())
+        return;
+
+    const int64_t first = std::max<int64_t>(x0, 0), last = std::min<int64_t>(x1, canvas.width());
+    if (first < last)
+        canvas.fill(y, first, last, colour);
+}
+
+/// Steps k along an axis, from a coordinate c with a step s of +-1, for which c + s * k is in [0, size)
+static inline void axisRange(const int64_t &c, const int64_t &s, const int64_t &size, int64_t &first, int64_t &last) {
+    first = s > 0 ? -c : c - size + 1;
+    last = s > 0 ? size - 1 - c : c;
+}
+
+/// Steps taken along the minor axis after k steps along the major axis of a line, rounding half up
+static inline int64_t minorSteps(const int64_t &k, const int64_t &major, const int64_t &minor) {
+    if (!major)
+        return 0; // A single pixel
+
+    return static_cast<int64_t>((static_cast<__int128>(2 * minor) * k + major) / (2 * major));
+}
+
+template<typename Image>
+void BMP_Draw::line(Image &n, const Point &a, const Point &b, const typename Image::Pixel &colour) {
+    const Canvas<Image> canvas(n);
+    const int64_t w = canvas.width(), h = canvas.height();
+
+    // Lines entirely on one side of the image
+    if ((a.x < 0 && b.x < 0) || (a.x >= w && b.x >= w) || (a.y < 0 && b.y < 0) || (a.y >= h && b.y >= h))
+        return;
+
+    const int64_t dx = std::abs(static_cast<int64_t>(b.x) - a.x), dy = -std::abs(static_cast<int64_t>(b.y) - a.y);
+    const int64_t sx = a.x < b.x ? 1 : -1, sy = a.y < b.y ? 1 : -1;
+
+    // Every step moves along the major axis, and the k-th pixel is minorSteps(k) along the minor one. Only the steps
+    // inside the canvas are walked: both axes give a range of k, the minor one through the inverse of minorSteps. The
+    // test above keeps the numerators of the inverse positive, and minor is not 0 when the minor axis clips.
+    const bool xMajor = dx >= -dy;
+    const int64_t major = xMajor ? dx : -dy, minor = xMajor ? -dy : dx;
+    int64_t first, last, minorFirst, minorLast;
+    axisRange(xMajor ? a.x : a.y, xMajor ? sx : sy, xMajor ? w : h, first, last);
+    axisRange(xMajor ? a.y : a.x, xMajor ? sy : sx, xMajor ? h : w, minorFirst, minorLast);
+    first = std::max<int64_t>(first, 0);
+    last = std::min(last, major);
+    if (minorFirst > 0)
+        first = std::max(first, static_cast<int64_t>((static_cast<__int128>(major) * (2 * minorFirst - 1) +
+                                                      2 * minor - 1) / (2 * minor)));
+    if (minorLast < minor)
+        last = std::min(last, static_cast<int64_t>((static_cast<__int128>(major) * (2 * minorLast + 1) - 1) /
+                                                   (2 * minor)));
+    if (first > last)
+        return;
+
+    // State of Bresenham's algorithm at the first and last steps inside, the error term only depends on the steps taken
+    // along each axis
+    const int64_t minorStart = minorSteps(first, major, minor), minorEnd = minorSteps(last, major, minor);
+    const int64_t xSteps = xMajor ? first : minorStart, ySteps = xMajor ? minorStart : first;
+    const int64_t endX = a.x + sx * (xMajor ? last : minorEnd), endY = a.y + sy * (xMajor ? minorEnd : last);
+    int64_t x = a.x + sx * xSteps, y = a.y + sy * ySteps, start = x;
+    int64_t err = static_cast<int64_t>(static_cast<__int128>(dx) * (ySteps + 1) + static_cast<__int128>(dy) *
+                                       (xSteps + 1));
+
+    // Pixels on the same row are drawn as one span
+    for (;;) {
+        const int64_t px = x, py = y;
+        if (x == endX && y == endY) {
+            span(canvas, py, std::min(start, px), std::max(start, px) + 1, colour);
+            break;
+        }
+
+        const int64_t e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y += sy;
+        }
+
+        if (y != py) {
+            span(canvas, py, std::min(start, px), std::max(start, px) + 1, colour);
+            start = x;
+        }
+    }
+}
+
+template<typename Image>
+void BMP_Draw::rectangle(Image &n, const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h,
+                         const typename Image::Pixel &colour, const bool &filled) {
+    if (w <= 0 || h <= 0)
+        return;
+
+    const Canvas<Image> canvas(n);
+    const int64_t right = static_cast<int64_t>(x) + w, bottom = static_cast<int64_t>(y) + h;
+    const int64_t first = std::max<int64_t>(y, 0), last = std::min<int64_t>(bottom, canvas.height());
+
+    for (int64_t row = first; row < last; ++row) {
+        if (filled || row == y || row == bottom - 1) {
+            span(canvas, row, x, right, colour);
+        } else {
+            span(canvas, row, x, static_cast<int64_t>(x) + 1, colour);
+            span(canvas, row, right - 1, right, colour);
+        }
+    }
+}
+
+template<typename Image>
+void BMP_Draw::polygon(Image &n, const std::vector<Point> &points, const typename Image::Pixel &colour,
+                       const bool &filled) {
+    if (!filled) {
+        for (size_t i = 0; i < points.size(); ++i)
+            line(n, points[i], points[(i + 1) % points.size()], colour);
+
+        return;
+    }
+
+    // Edges from top to bottom, horizontal edges never cross a row
+    struct Edge {
+        int64_t x, top, bottom, dx;
+    };
+
+    std::vector<Edge> edges;
+    for (size_t i = 0; i < points.size(); ++i) {
+        Point p = points[i], q = points[(i + 1) % points.size()];
+        if (p.y == q.y)
+            continue;
+        if (p.y > q.y)
+            std::swap(p, q);
+
+        edges.push_back({p.x, p.y, q.y, static_cast<int64_t>(q.x) - p.x});
+    }
+
+    if (edges.empty())
+        return;
+
+    std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) -> bool {
+        return a.top < b.top;
+    });
+
+    const Canvas<Image> canvas(n);
+    int64_t bottom = 0;
+    for (const Edge &edge : edges)
+        bottom = std::max(bottom, edge.bottom);
+
+    // Edges crossing the current row, i.e. top <= y < bottom
+    std::vector<const Edge *> active;
+    std::vector<int64_t> xs;
+    size_t next = 0;
+    for (int64_t y = std::max<int64_t>(edges[0].top, 0); y < std::min<int64_t>(bottom, canvas.height()); ++y) {
+        for (; next < edges.size() && edges[next].top <= y; ++next)
+            active.push_back(&edges[next]);
+
+        active.erase(std::remove_if(active.begin(), active.end(), [&](const Edge *edge) -> bool {
+            return edge->bottom <= y;
+        }), active.end());
+
+        // First pixel right of each crossing, computed exactly
+        xs.clear();
+        for (const Edge *edge : active)
+            xs.push_back(edge->x + ceilDiv((y - edge->top) * edge->dx, edge->bottom - edge->top));
+
+        std::sort(xs.begin(), xs.end());
+        for (size_t i = 0; i + 1 < xs.size(); i += 2)
+            span(canvas, y, xs[i], xs[i + 1], colour);
+    }
+}
+
+template<typename Image>
+void BMP_Draw::floodFill(Image &n, const Point &seed, const typename Image::Pixel &colour) {
+    const Canvas<Image> canvas(n);
+    const int32_t w = canvas.width(), h = canvas.height();
+    if (seed.x < 0 || seed.x >= w || seed.y < 0 || seed.y >= h)
+        return;
+
+    const typename Image::Pixel target = canvas.get(seed.x, seed.y);
+    if (same(target, colour))
+        return;
+
+    const auto inside = [&](const int32_t &x, const int32_t &y) -> bool {
+        return same(canvas.get(x, y), target);
+    };
+
+    // Span x0 to x1 (included) of row y was filled, row y + dy next to it is searched
+    struct Segment {
+        int32_t y, x0, x1, dy;
+    };
+
+    std::vector<Segment> stack;
+    const auto push = [&](const int32_t &y, const int32_t &x0, const int32_t &x1, const int32_t &dy) -> void {
+        if (y + dy >= 0 && y + dy < h)
+            stack.push_back({y, x0, x1, dy});
+    };
+
+    // Fills the span of row y through x, returns one past its last pixel and sets left to its first pixel
+    const auto fillSpan = [&](const int32_t &y, const int32_t &x, int32_t &left) -> int32_t {
+        int32_t right = x + 1;
+        for (left = x; left > 0 && inside(left - 1, y); --left);
+        for (; right < w && inside(right, y); ++right);
+
+        canvas.fill(y, left, right, colour);
+        return right;
+    };
+
+    int32_t left;
+    const int32_t right = fillSpan(seed.y, seed.x, left);
+    push(seed.y, left, right - 1, 1);
+    push(seed.y, left, right - 1, -1);
+
+    while (!stack.empty()) {
+        const Segment s = stack.back();
+        stack.pop_back();
+        const int32_t y = s.y + s.dy;
+
+        // Spans of row y touching the segment, the parts past the segment may leak back into the row it came from
+        for (int32_t x = s.x0; x <= s.x1; ++x) {
+            if (!inside(x, y))
+                continue;
+
+            const int32_t end = fillSpan(y, x, left);
+            push(y, left, end - 1, s.dy);
+            if (left < s.x0)
+                push(y, left, s.x0 - 1, -s.dy);
+            if (end - 1 > s.x1)
+                push(y, s.x1 + 1, end - 1, -s.dy);
+
+            x = end;
+        }
+    }
+}
+
+/// Instantiates every function for an image class
+#define BMP_DRAW_INSTANTIATE(Image) \
+    template void BMP_Draw::line(Image &, const Point &, const Point &, const typename Image::Pixel &); \
+    template void BMP_Draw::rectangle(Image &, const int32_t &, const int32_t &, const int32_t &, const int32_t &, \
+                                      const typename Image::Pixel &, const bool &); \
+    template void BMP_Draw::polygon(Image &, const std::vector<Point> &, const typename Image::Pixel &, const bool &); \
+    template void BMP_Draw::floodFill(Image &, const Point &, const typename Image::Pixel &);
+
+BMP_DRAW_INSTANTIATE(BMP_1bit)
+BMP_DRAW_INSTANTIATE(BMP_8bit)
+BMP_DRAW_INSTANTIATE(BMP_16bit)
+BMP_DRAW_INSTANTIATE(BMP_24bit)
+BMP_DRAW_INSTANTIATE(BMP_32bit)
+BMP_DRAW_INSTANTIATE(BMP_Bitmap)
@@ -0,0 +1,93 @@
+#ifndef BMP_BMP_DRAW_H
+#define BMP_BMP_DRAW_H
+
+#include "bmp_1-bit.h"
+#include "bmp_8-bit.h"
+#include "bmp_16-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include "bmp_bitmap.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Drawing of lines, rectangles and polygons, and flood fill.
+ *
+ * Should not be constructed, it only groups static functions. Each function is available for BMP_1bit, BMP_8bit,
+ * BMP_16bit, BMP_24bit, BMP_32bit and BMP_Bitmap, and draws in place with a value of the Pixel type of the image (the
+ * colour index for 1-bit and 8-bit images). Coordinates are the same as operator()(x, y), whatever the row-order, and
+ * shapes are clipped to the image.
+ *
+ * Everything is drawn as horizontal spans of pixels: filled with memset for 1-byte pixels, with repeated block copies
+ * for 24-bit pixels, with std::fill (vectorised by the compiler) for the other pixels, and with word masks for
+ * BMP_Bitmap.
+ */
+class BMP_Draw {
+public:
+    BMP_Draw() = delete;
+
+    /// Pixel coordinates
+    struct Point {
+        int32_t x, y;
+    };
+
+    /**
+     * @brief Draws a line with Bresenham's algorithm, both ends included.
+     *
+     * The line is clipped to the image first and only the steps inside it are walked, so the ends may lie anywhere at
+     * no cost. The pixels drawn are the same as if the whole line were walked.
+     *
+     * @param n[in, out] Image
+     * @param a[in] First end
+     * @param b[in] Second end
+     * @param colour[in] Value of the pixels
+     */
+    template<typename Image>
+    static void line(Image &n, const Point &a, const Point &b, const typename Image::Pixel &colour);
+
+    /**
+     * @brief Draws a rectangle.
+     *
+     * @param n[in, out] Image
+     * @param x[in] x of the top-left corner
+     * @param y[in] y of the top-left corner
+     * @param w[in] Width, nothing is drawn if it is not positive
+     * @param h[in] Height, nothing is drawn if it is not positive
+     * @param colour[in] Value of the pixels
+     * @param filled[in] Whether the inside is filled (default) or only the 1-pixel border is drawn
+     */
+    template<typename Image>
+    static void rectangle(Image &n, const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h,
+                          const typename Image::Pixel &colour, const bool &filled = true);
+
+    /**
+     * @brief Draws a closed polygon.
+     *
+     * Filled polygons are rasterised a row at a time with the even-odd rule: a pixel is inside if a ray from its
+     * centre crosses the edges an odd number of times. Points are pixel centres, and pixels exactly on a right or
+     * bottom edge are left out, so that polygons sharing an edge do not overlap. Outlines are drawn with line().
+     *
+     * @param n[in, out] Image
+     * @param points[in] Vertices, the last one is joined to the first one
+     * @param colour[in] Value of the pixels
+     * @param filled[in] Whether the inside is filled (default) or only the edges are drawn
+     */
+    template<typename Image>
+    static void polygon(Image &n, const std::vector<Point> &points, const typename Image::Pixel &colour,
+                        const bool &filled = true);
+
+    /**
+     * @brief Fills the 4-connected region of pixels with the same value as the seed.
+     *
+     * Uses a stack of spans: every span is filled at once, and the rows above and below it are searched for the spans
+     * to fill next.
+     *
+     * @param n[in, out] Image
+     * @param seed[in] First pixel of the region, nothing is filled if it is outside the image
+     * @param colour[in] Value of the pixels
+     */
+    template<typename Image>
+    static void floodFill(Image &n, const Point &seed, const typename Image::Pixel &colour);
+};
+
+#endif //BMP_BMP_DRAW_H
@@ -0,0 +1,227 @@
+#include "bmp_filter.h"
+#include "bmp_separable.h"
+#include "bmp_parallel.h"
+#include "bmp_interleaved.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// Reciprocal of d in 24-bit fixed-point, for average()
+static inline uint32_t reciprocal(const uint32_t &d) {
+    return ((1u << 24u) + d / 2) / d;
+}
+
+/// Rounded average of the d values adding up to sum, recip is reciprocal(d)
+static inline uint8_t average(const uint32_t &sum, const uint32_t &recip) {
+    return std::min<uint64_t>((static_cast<uint64_t>(sum) * recip + (1u << 23u)) >> 24u, 255);
+}
+
+#ifdef __SSE2__
+/// average() of 4 sums at once, the results are left in the 32-bit lanes
+static inline __m128i average(const __m128i &sum, const __m128i &recip) {
+    const __m128i half = _mm_set1_epi64x(1u << 23u);
+    const __m128i even = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(sum, recip), half), 24);
+    const __m128i odd = _mm_srli_epi64(_mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(sum, 32), recip), half), 24);
+
+    return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+}
+#endif
+
+/// Averages every channel of a row over 2 * r + 1 pixels with a running sum
+static void boxRow(const uint8_t *src, uint8_t *dst, const int32_t &w, const uint8_t &channels, const int32_t &r,
+                   const uint32_t &recip) {
+    for (uint8_t c = 0; c < channels; ++c) {
+        const auto p = [&](const int32_t &x) -> uint32_t {
+            return src[std::min(std::max(x, 0), w - 1) * channels + c];
+        };
+
+        uint32_t sum = 0;
+        for (int32_t k = -r; k <= r; ++k)
+            sum += p(k);
+
+        for (int32_t x = 0; x < w; ++x) {
+            dst[x * channels + c] = average(sum, recip);
+            sum += p(x + r + 1) - p(x - r);
+        }
+    }
+}
+
+/// Writes the averages of the running column sums, then replaces row out by row in in the sums
+static void boxColumns(std::vector<uint32_t> &sums, const uint8_t *in, const uint8_t *out, uint8_t *dst,
+                       const uint32_t &recip) {
+    const size_t n = sums.size();
+
+    size_t x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128(), r = _mm_set1_epi32(recip);
+    for (; x + 16 <= n; x += 16) {
+        __m128i *s = reinterpret_cast<__m128i *>(&sums[x]);
+        __m128i sum[4];
+        for (uint8_t i = 0; i < 4; ++i)
+            sum[i] = _mm_loadu_si128(s + i);
+
+        const __m128i lo = _mm_packs_epi32(average(sum[0], r), average(sum[1], r));
+        const __m128i hi = _mm_packs_epi32(average(sum[2], r), average(sum[3], r));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+
+        // Differences widened to 16 bits then sign-extended to 32 bits
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + x));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(out + x));
+        const __m128i d[2] = {_mm_sub_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)),
+                              _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero))};
+        for (uint8_t i = 0; i < 4; ++i) {
+            const __m128i sign = _mm_srai_epi16(d[i / 2], 15);
+            const __m128i d32 = i % 2 ? _mm_unpackhi_epi16(d[i / 2], sign) : _mm_unpacklo_epi16(d[i / 2], sign);
+            _mm_storeu_si128(s + i, _mm_add_epi32(sum[i], d32));
+        }
+    }
+#endif
+
+    for (; x < n; ++x) {
+        dst[x] = average(sums[x], recip);
+        sums[x] += in[x] - out[x];
+    }
+}
+
+/// Adds amount (8-bit fixed-point) times the difference between a row and its blur to the row
+static void sharpenRow(const uint8_t *src, uint8_t *dst, const size_t &n, const int16_t &amount,
+                       const uint8_t &threshold) {
+    size_t x = 0;
+#ifdef __SSE2__
+    // The difference and 1 are multiplied by amount and 128 in pairs, giving the rounded product in 32 bits
+    const __m128i zero = _mm_setzero_si128(), weight = _mm_set1_epi32(amount | 128 << 16);
+    const __m128i one = _mm_set1_epi16(1), t = _mm_set1_epi16(threshold);
+    for (; x + 16 <= n; x += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + x));
+
+        __m128i out[2];
+        for (uint8_t i = 0; i < 2; ++i) {
+            const __m128i s = i ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+            __m128i d = _mm_sub_epi16(s, i ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero));
+            d = _mm_andnot_si128(_mm_cmplt_epi16(_mm_max_epi16(d, _mm_sub_epi16(zero, d)), t), d);
+
+            const __m128i lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(d, one), weight), 8);
+            const __m128i hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(d, one), weight), 8);
+            out[i] = _mm_adds_epi16(s, _mm_packs_epi32(lo, hi));
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(out[0], out[1]));
+    }
+#endif
+
+    for (; x < n; ++x) {
+        const int32_t d = src[x] - dst[x];
+        const int32_t sharpened = std::abs(d) < threshold ? src[x] : src[x] + ((d * amount + 128) >> 8);
+        dst[x] = std::min(std::max(sharpened, 0), 255);
+    }
+}
+
+template<typename Image>
+Image BMP_Filter::convolve(const Image &n, const std::vector<double> &horizontal, const std::vector<double> &vertical) {
+    if (horizontal.empty() || vertical.empty()) {
+        std::cerr << "BMP_Filter: Empty kernel." << std::endl;
+        std::exit(1);
+    }
+
+    const BMP_Interleaved<Image> interleaved(n);
+    Image out(*interleaved);
+    const typename Image::ConstView src = interleaved->view();
+    const typename Image::View dst = out.view();
+
+    BMP_Separable::apply(src.bytes(0), src.stride(), dst.bytes(0), dst.stride(),
+                         sizeof(typename Image::Pixel), BMP_Separable::convolution(src.width(), horizontal),
+                         BMP_Separable::convolution(src.height(), vertical));
+    return out;
+}
+
+template<typename Image>
+Image BMP_Filter::gaussianBlur(const Image &n, const double &sigma) {
+    if (!(sigma > 0))
+        return n;
+
+    const int32_t r = std::ceil(3 * sigma);
+    std::vector<double> kernel(2 * r + 1);
+    double total = 0;
+    for (int32_t k = -r; k <= r; ++k)
+        total += kernel[k + r] = std::exp(-k * k / (2 * sigma * sigma));
+
+    for (double &weight : kernel)
+        weight /= total;
+
+    return convolve(n, kernel, kernel);
+}
+
+template<typename Image>
+Image BMP_Filter::boxBlur(const Image &n, const uint32_t &radius) {
+    const BMP_Interleaved<Image> interleaved(n);
+    Image out(*interleaved);
+    const typename Image::ConstView src = interleaved->view();
+    const typename Image::View dst = out.view();
+    const uint8_t channels = sizeof(typename Image::Pixel);
+    const size_t rowBytes = static_cast<size_t>(src.width()) * channels;
+    const int32_t r = radius;
+    const uint32_t recip = reciprocal(2 * radius + 1);
+    if (src.empty())
+        return out;
+
+    BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        // Averaged rows y - r to y + r + 1 are kept in a ring, rows outside the image are copies of the edge rows
+        const int32_t slots = 2 * r + 2;
+        std::vector<uint8_t> ring(slots * rowBytes);
+        std::vector<uint32_t> sums(rowBytes, 0);
+
+        const auto row = [&](const int32_t &y) -> uint8_t * {
+            return &ring[(y % slots + slots) % slots * rowBytes];
+        };
+        const auto filter = [&](const int32_t &y) -> void {
+            boxRow(src.bytes(std::min(std::max(y, 0), src.height() - 1)), row(y), src.width(), channels, r,
+                   recip);
+        };
+
+        for (int32_t y = begin - r; y <= begin + r; ++y) {
+            filter(y);
+            for (size_t x = 0; x < rowBytes; ++x)
+                sums[x] += row(y)[x];
+        }
+
+        for (int32_t y = begin; y < end; ++y) {
+            filter(y + r + 1);
+            boxColumns(sums, row(y + r + 1), row(y - r), dst.bytes(y), recip);
+        }
+    });
+
+    return out;
+}
+
+template<typename Image>
+Image BMP_Filter::unsharpMask(const Image &n, const double &sigma, const double &amount, const uint8_t &threshold) {
+    const BMP_Interleaved<Image> interleaved(n);
+    Image out = gaussianBlur(*interleaved, sigma);
+    const typename Image::ConstView src = interleaved->view();
+    const typename Image::View dst = out.view();
+    const int16_t a = std::lround(std::min(std::max(amount, 0.0), 127.0) * 256);
+
+    BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y)
+            sharpenRow(src.bytes(y), dst.bytes(y), src.width() * sizeof(typename Image::Pixel), a, threshold);
+    });
+
+    return out;
+}
+
+/// Instantiates every function for an image class
+#define BMP_FILTER_INSTANTIATE(Image) \
+    template Image BMP_Filter::convolve(const Image &, const std::vector<double> &, const std::vector<double> &); \
+    template Image BMP_Filter::gaussianBlur(const Image &, const double &); \
+    template Image BMP_Filter::boxBlur(const Image &, const uint32_t &); \
+    template Image BMP_Filter::unsharpMask(const Image &, const double &, const double &, const uint8_t &);
+
+BMP_FILTER_INSTANTIATE(BMP_8bit)
+BMP_FILTER_INSTANTIATE(BMP_24bit)
+BMP_FILTER_INSTANTIATE(BMP_32bit)
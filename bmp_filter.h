@@ -0,0 +1,74 @@
+#ifndef BMP_BMP_FILTER_H
+#define BMP_BMP_FILTER_H
+
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Convolution, blurring and sharpening.
+ *
+ * Should not be constructed, it only groups static functions. Each function is available for BMP_8bit, BMP_24bit and
+ * BMP_32bit, every byte of a pixel is filtered as a separate channel like in BMP_Resize (8-bit images should have a
+ * colour table ordered by brightness). Pixels outside the image are clamped to the edge. The filtered image is a copy
+ * of the source with new pixels, so it keeps the row-order and the colour table or bitmask.
+ *
+ * All arithmetic is in fixed-point, with SSE2 when compiled with SSE2 enabled, and rows are processed in parallel.
+ */
+class BMP_Filter {
+public:
+    BMP_Filter() = delete;
+
+    /**
+     * @brief Convolves an image with a separable kernel, see BMP_Separable.
+     *
+     * The result of the horizontal pass is kept in [-512, 512) and only the output is clamped to [0, 255], the absolute
+     * values of the vertical kernel must add up to less than 16.
+     *
+     * @param n[in] Source image
+     * @param horizontal[in] Kernel along the rows, centred on its middle element, each element in (-2, 2)
+     * @param vertical[in] Kernel along the columns, centred on its middle element, each element in (-2, 2)
+     * @return The filtered image
+     */
+    template<typename Image>
+    static Image convolve(const Image &n, const std::vector<double> &horizontal, const std::vector<double> &vertical);
+
+    /**
+     * @brief Gaussian blur, the kernel is cut off at 3 standard deviations.
+     *
+     * @param n[in] Source image
+     * @param sigma[in] Standard deviation in pixels, the image is copied as it is if it is not positive
+     * @return The blurred image
+     */
+    template<typename Image>
+    static Image gaussianBlur(const Image &n, const double &sigma);
+
+    /**
+     * @brief Box blur, the average of the (2 * radius + 1) by (2 * radius + 1) square around every pixel.
+     *
+     * Uses running sums, so the time taken does not depend on the radius. Rows are averaged first, then columns, each
+     * average rounded to 8 bits.
+     *
+     * @param n[in] Source image
+     * @param radius[in] Radius in pixels
+     * @return The blurred image
+     */
+    template<typename Image>
+    static Image boxBlur(const Image &n, const uint32_t &radius);
+
+    /**
+     * @brief Unsharp mask, adds the difference between the image and its Gaussian blur to the image.
+     *
+     * @param n[in] Source image
+     * @param sigma[in] Standard deviation of the blur in pixels
+     * @param amount[in] Multiplier of the difference, from 0 to 127
+     * @param threshold[in] Channels that differ from the blur by less than this are left as they are
+     * @return The sharpened image
+     */
+    template<typename Image>
+    static Image unsharpMask(const Image &n, const double &sigma, const double &amount, const uint8_t &threshold = 0);
+};
+
+#endif //BMP_BMP_FILTER_H
@@ -0,0 +1,116 @@
+#include "bmp_hash-index.h"
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <limits>
+
+typedef BMP_HashIndex::Match Match;
+
+/// Every 16-bit mask, by number of bits set
+static const std::vector<uint16_t> &masksByWeight() {
+    static const std::vector<uint16_t> masks = []() -> std::vector<uint16_t> {
+        std::vector<uint16_t> out(65536);
+        for (uint32_t i = 0; i < 65536; ++i)
+            out[i] = i;
+
+        std::stable_sort(out.begin(), out.end(), [](const uint16_t &a, const uint16_t &b) -> bool {
+            return __builtin_popcount(a) < __builtin_popcount(b);
+        });
+        return out;
+    }();
+
+    return masks;
+}
+
+/// Number of 16-bit masks with at most k bits set
+static size_t masksUpTo(const uint8_t &k) {
+    size_t total = 0, binomial = 1;
+    for (uint8_t i = 0; i <= std::min<uint8_t>(k, 16); ++i) {
+        total += binomial;
+        binomial = binomial * (16 - i) / (i + 1);
+    }
+
+    return total;
+}
+
+BMP_HashIndex::BMP_HashIndex() : buckets(static_cast<size_t>(chunks) << chunkBits) {
+}
+
+void BMP_HashIndex::reserve(const size_t &n) {
+    hashes.reserve(n);
+    for (std::vector<uint32_t> &bucket : buckets)
+        bucket.reserve(n >> chunkBits);
+}
+
+size_t BMP_HashIndex::add(const uint64_t &hash) {
+    if (hashes.size() > std::numeric_limits<uint32_t>::max()) {
+        std::cerr << "BMP_HashIndex: Too many hashes." << std::endl;
+        std::exit(1);
+    }
+
+    const uint32_t index = hashes.size();
+    hashes.push_back(hash);
+    for (uint8_t i = 0; i < chunks; ++i)
+        buckets[static_cast<size_t>(i) << chunkBits | chunk(hash, i)].push_back(index);
+
+    return index;
+}
+
+size_t BMP_HashIndex::size() const {
+    return hashes.size();
+}
+
+uint64_t BMP_HashIndex::operator[](const size_t &index) const {
+    if (index >= hashes.size()) {
+        std::cerr << "BMP_HashIndex: Index out of bounds" << std::endl;
+        std::exit(1);
+    }
+
+    return hashes[index];
+}
+
+std::vector<Match> BMP_HashIndex::query(const uint64_t &hash, const uint8_t &radius) const {
+    std::vector<Match> out;
+    const auto check = [&](const size_t &index) -> void {
+        const uint8_t distance = __builtin_popcountll(hashes[index] ^ hash);
+        if (distance <= radius)
+            out.push_back({index, distance});
+    };
+
+    // Largest distance of the closest chunk, and number of buckets to look at for each chunk
+    const uint8_t k = radius / chunks;
+    const size_t probes = masksUpTo(k);
+
+    if (probes * chunks * hashes.size() >> chunkBits >= hashes.size()) {
+        for (size_t i = 0; i < hashes.size(); ++i)
+            check(i);
+    } else {
+        const std::vector<uint16_t> &masks = masksByWeight();
+        uint16_t query[chunks];
+        for (uint8_t i = 0; i < chunks; ++i)
+            query[i] = chunk(hash, i);
+
+        for (uint8_t i = 0; i < chunks; ++i) {
+            for (size_t m = 0; m < probes; ++m) {
+                for (const uint32_t &index : buckets[static_cast<size_t>(i) << chunkBits | (query[i] ^ masks[m])]) {
+                    // A hash close enough in several chunks is only checked from the first of them
+                    bool seen = false;
+                    for (uint8_t j = 0; j < i && !seen; ++j)
+                        seen = __builtin_popcount(chunk(hashes[index], j) ^ query[j]) <= k;
+
+                    if (!seen)
+                        check(index);
+                }
+            }
+        }
+    }
+
+    std::sort(out.begin(), out.end(), [](const Match &a, const Match &b) -> bool {
+        return a.distance < b.distance || (a.distance == b.distance && a.index < b.index);
+    });
+    return out;
+}
+
+uint16_t BMP_HashIndex::chunk(const uint64_t &hash, const uint8_t &i) {
+    return hash >> (i * chunkBits);
+}
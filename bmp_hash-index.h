@@ -0,0 +1,79 @@
+#ifndef BMP_BMP_HASH_INDEX_H
+#define BMP_BMP_HASH_INDEX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Index of 64-bit hashes (e.g. perceptual hashes from BMP_Hash) for Hamming distance radius queries.
+ *
+ * Uses multi-index hashing: each hash is split into 4 chunks of 16 bits, and each chunk indexes a table of 65536
+ * buckets. If 2 hashes are at most r bits apart, one of their chunks is at most r / 4 bits apart, so a query only looks
+ * at the buckets of each chunk that are close enough to the chunk of the query, then checks the full distance of the
+ * hashes it finds there. Queries for radii where that would look at more hashes than a scan of every hash are answered
+ * with a scan.
+ *
+ * Queries can run from several threads at once, as long as no hash is being added.
+ */
+class BMP_HashIndex {
+public:
+    /// A hash found by a query
+    struct Match {
+        size_t index;     ///< Index of the hash, in the order they were added
+        uint8_t distance; ///< Number of bits that differ from the query
+    };
+
+    /// Constructs an empty index
+    BMP_HashIndex();
+
+    /**
+     * @brief Reserves memory for n hashes in total, to add them without reallocating.
+     *
+     * @param n[in] Number of hashes
+     */
+    void reserve(const size_t &n);
+
+    /**
+     * @brief Adds a hash, up to 2^32 hashes in total.
+     *
+     * @param hash[in] The hash
+     * @return Index of the hash, the number of hashes added before it
+     */
+    size_t add(const uint64_t &hash);
+
+    /// Number of hashes
+    size_t size() const;
+
+    /**
+     * @brief Hash at index.
+     *
+     * @param index[in] Index of the hash
+     * @return The hash
+     */
+    uint64_t operator[](const size_t &index) const;
+
+    /**
+     * @brief Every hash at most radius bits apart from a hash.
+     *
+     * @param hash[in] The hash
+     * @param radius[in] Largest Hamming distance
+     * @return The hashes found, by distance then by index
+     */
+    std::vector<Match> query(const uint64_t &hash, const uint8_t &radius) const;
+
+private:
+    /// Number of chunks of a hash, and of bits of a chunk
+    static const uint8_t chunks = 4, chunkBits = 16;
+
+    /// Chunk i of a hash
+    static uint16_t chunk(const uint64_t &hash, const uint8_t &i);
+
+    /// Every hash, in the order they were added
+    std::vector<uint64_t> hashes;
+
+    /// Indices of the hashes in each bucket, the 65536 buckets of chunk 0 then those of chunk 1, etc.
+    std::vector<std::vector<uint32_t>> buckets;
+};
+
+#endif //BMP_BMP_HASH_INDEX_H
@@ -0,0 +1,361 @@
+#include "bmp_hash.h"
+#include "bmp_1-bit.h"
+#include "bmp_8-bit.h"
+#include "bmp_16-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include "bmp_interleaved.h"
+#include "bmp_parallel.h"
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// Key of each of the 4 accumulators, also their initial values
+static const uint64_t keys[4] = {0x9E3779B185EBCA87ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull,
+                                 0x85EBCA77C2B2AE63ull};
+
+/// Final mix of a 64-bit value, every bit of the input affects every bit of the output
+static inline uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    return x ^ x >> 31;
+}
+
+/// Added to the keys after each 32 bytes, so that moving bytes within a row changes its hash
+static const uint64_t stripeStep = 0xD6E8FEB86659FD93ull;
+
+/// Adds 32 bytes to the accumulators, each 8 bytes are mixed with the keys of the stripe then the halves are multiplied
+static inline void accumulate(uint64_t *acc, const uint8_t *p, const uint64_t *stripeKeys) {
+    for (uint8_t i = 0; i < 4; ++i) {
+        uint64_t word;
+        std::memcpy(&word, p + 8 * i, 8);
+        const uint64_t x = word ^ stripeKeys[i];
+        acc[i] += (x & 0xFFFFFFFFu) * (x >> 32) + word;
+    }
+}
+
+/// Hash of n bytes
+static uint64_t hashBytes(const uint8_t *p, const size_t &n) {
+    uint64_t acc[4] = {keys[0], keys[1], keys[2], keys[3]};
+    uint64_t stripeKeys[4] = {keys[0], keys[1], keys[2], keys[3]};
+    size_t i = 0;
+#ifdef __SSE2__
+    // Same as accumulate(), 2 accumulators per register
+    const __m128i step = _mm_set1_epi64x(static_cast<long long>(stripeStep));
+    __m128i k0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys));
+    __m128i k1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + 2));
+    __m128i a0 = k0, a1 = k1;
+    for (; i + 32 <= n; i += 32) {
+        const __m128i d0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        const __m128i d1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i + 16));
+        const __m128i x0 = _mm_xor_si128(d0, k0), x1 = _mm_xor_si128(d1, k1);
+        a0 = _mm_add_epi64(a0, _mm_add_epi64(_mm_mul_epu32(x0, _mm_srli_epi64(x0, 32)), d0));
+        a1 = _mm_add_epi64(a1, _mm_add_epi64(_mm_mul_epu32(x1, _mm_srli_epi64(x1, 32)), d1));
+        k0 = _mm_add_epi64(k0, step);
+        k1 = _mm_add_epi64(k1, step);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(acc), a0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + 2), a1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(stripeKeys), k0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(stripeKeys + 2), k1);
+#endif
+
+    for (; i + 32 <= n; i += 32) {
+        accumulate(acc, p + i, stripeKeys);
+        for (uint64_t &key : stripeKeys)
+            key += stripeStep;
+    }
+
+    // The last bytes are padded with zeros, n is mixed in below
+    if (i < n) {
+        uint8_t last[32] = {};
+        std::memcpy(last, p + i, n - i);
+        accumulate(acc, last, stripeKeys);
+    }
+
+    return mix(acc[0] ^ mix(acc[1] ^ mix(acc[2] ^ mix(acc[3] ^ n))));
+}
+
+template<typename Image>
+uint64_t BMP_Hash::content(const Image &n) {
+    const BMP_Interleaved<Image> interleaved(n);
+    const typename Image::ConstView view = interleaved->view();
+    const size_t rowBytes = static_cast<size_t>(view.width()) * sizeof(typename Image::Pixel);
+
+    // Hashes of the rows are mixed with their row number and added, so strips can be summed in any order
+    uint64_t sum = 0;
+    std::mutex mutex;
+    BMP_Parallel::forRows(0, view.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        uint64_t local = 0;
+        for (int32_t y = begin; y < end; ++y)
+            local += mix(hashBytes(view.bytes(y), rowBytes) + y * keys[0]);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        sum += local;
+    });
+
+    const uint64_t dimensions = static_cast<uint64_t>(static_cast<uint32_t>(view.width())) << 32 |
+                                static_cast<uint32_t>(view.height());
+    return mix(sum ^ mix(dimensions ^ sizeof(typename Image::Pixel)));
+}
+
+/// BT.601 luma of a colour
+static inline float luma(const float &r, const float &g, const float &b) {
+    return 0.299f * r + 0.587f * g + 0.114f * b;
+}
+
+namespace {
+    /// Luma of colour indices, through the colour table
+    struct IndexLuma {
+        float table[256];
+
+        float operator()(const uint8_t &p) const {
+            return table[p];
+        }
+    };
+
+    /// Luma of pixels with bit masks, each channel scaled to 8 bits
+    struct MaskLuma {
+        uint32_t masks[3], shifts[3];
+        float scales[3];
+
+        float operator()(const uint32_t &p) const {
+            float c[3];
+            for (uint8_t i = 0; i < 3; ++i)
+                c[i] = ((p & masks[i]) >> shifts[i]) * scales[i];
+
+            return luma(c[0], c[1], c[2]);
+        }
+    };
+
+    /// Luma of 24-bit pixels
+    struct RGBLuma {
+        float operator()(const BMP_24bit::Pixel &p) const {
+            return luma(p.r, p.g, p.b);
+        }
+    };
+}
+
+///@{
+/// Luma of the pixels of an image
+static IndexLuma lumaOf(const BMP_1bit &n) {
+    // Every non-zero index is the second colour, like save() treats them
+    IndexLuma out;
+    for (uint16_t i = 0; i < 256; ++i) {
+        const uint32_t c = n.getPalette()[i ? 1 : 0];
+        out.table[i] = luma(c >> 16 & 0xFFu, c >> 8 & 0xFFu, c & 0xFFu);
+    }
+
+    return out;
+}
+
+static IndexLuma lumaOf(const BMP_8bit &n) {
+    IndexLuma out;
+    for (uint16_t i = 0; i < 256; ++i) {
+        const uint32_t c = n.getPalette()[i];
+        out.table[i] = luma(c >> 16 & 0xFFu, c >> 8 & 0xFFu, c & 0xFFu);
+    }
+
+    return out;
+}
+
+static MaskLuma lumaOf(const BMP_BM &n) {
+    const std::vector<uint32_t> masks = n.getPixelMasks();
+    MaskLuma out;
+    for (uint8_t i = 0; i < 3; ++i) {
+        out.masks[i] = masks[i];
+        out.shifts[i] = masks[i] ? __builtin_ctz(masks[i]) : 0;
+        out.scales[i] = masks[i] ? 255.0f / (masks[i] >> out.shifts[i]) : 0;
+    }
+
+    return out;
+}
+
+static RGBLuma lumaOf(const BMP_24bit &) {
+    return RGBLuma();
+}
+///@}
+
+/**
+ * @brief Mean luma of the cells of a grid laid over an image.
+ *
+ * Cell (i, j) covers the pixels from i * width / w to (i + 1) * width / w (at least 1 pixel) in x, and the same in y.
+ *
+ * @param n[in] Image
+ * @param w[in] Width of the grid
+ * @param h[in] Height of the grid
+ * @return Row by row cells, all 0 for an empty image
+ */
+template<typename Image>
+static std::vector<float> grid(const Image &n, const int32_t &w, const int32_t &h) {
+    const BMP_Interleaved<Image> interleaved(n);
+    const typename Image::ConstView view = interleaved->view();
+    const auto luma = lumaOf(n);
+    const int64_t width = view.width(), height = view.height();
+    std::vector<float> cells(static_cast<size_t>(w) * h, 0);
+    if (!width || !height)
+        return cells;
+
+    const auto first = [](const int64_t &i, const int64_t &size, const int32_t &count) -> int64_t {
+        return i * size / count;
+    };
+    const auto last = [&](const int64_t &i, const int64_t &size, const int32_t &count) -> int64_t {
+        return std::max(first(i, size, count) + 1, first(i + 1, size, count));
+    };
+
+    BMP_Parallel::forRows(0, h, [&](const int32_t &begin, const int32_t &end) -> void {
+        std::vector<float> row(width);
+        for (int32_t j = begin; j < end; ++j) {
+            const int64_t y0 = first(j, height, h), y1 = last(j, height, h);
+            float *cell = &cells[static_cast<size_t>(j) * w];
+
+            // Luma of each row is summed into every cell of the row of cells, then averaged
+            for (int64_t y = y0; y < y1; ++y) {
+                const typename Image::Pixel *p = view.row(y);
+                for (int64_t x = 0; x < width; ++x)
+                    row[x] = luma(p[x]);
+
+                for (int32_t i = 0; i < w; ++i)
+                    for (int64_t x = first(i, width, w); x < last(i, width, w); ++x)
+                        cell[i] += row[x];
+            }
+
+            for (int32_t i = 0; i < w; ++i)
+                cell[i] /= static_cast<float>((last(i, width, w) - first(i, width, w)) * (y1 - y0));
+        }
+    }, 1);
+
+    return cells;
+}
+
+/// Subsampled thumbnail of a file, at least size pixels in each dimension if the file is larger
+template<typename Image>
+static Image thumbnail(const std::string &filename, const int64_t &size) {
+    const Image header(filename, BMP::Decode::lazy);
+    const BMP::InfoHeader &info = header.getInfoHeader();
+    const int64_t shortest = std::min<int64_t>(info.biWidth, std::abs(static_cast<int64_t>(info.biHeight)));
+
+    return Image(filename, static_cast<uint32_t>(std::max<int64_t>(1, shortest / size)), BMP::Sampling::box);
+}
+
+/// Smallest side of the thumbnails hashed by the functions taking a filename
+static const int64_t thumbnailSize = 64;
+
+template<typename Image>
+uint64_t BMP_Hash::average(const Image &n) {
+    const std::vector<float> cells = grid(n, 8, 8);
+    float mean = 0;
+    for (const float &c : cells)
+        mean += c;
+    mean /= 64;
+
+    uint64_t out = 0;
+    for (uint8_t i = 0; i < 64; ++i)
+        out |= static_cast<uint64_t>(cells[i] > mean) << i;
+
+    return out;
+}
+
+template<typename Image>
+uint64_t BMP_Hash::average(const std::string &filename) {
+    return average(thumbnail<Image>(filename, thumbnailSize));
+}
+
+template<typename Image>
+uint64_t BMP_Hash::difference(const Image &n) {
+    const std::vector<float> cells = grid(n, 9, 8);
+
+    uint64_t out = 0;
+    for (uint8_t y = 0; y < 8; ++y)
+        for (uint8_t x = 0; x < 8; ++x)
+            out |= static_cast<uint64_t>(cells[y * 9 + x] < cells[y * 9 + x + 1]) << (y * 8 + x);
+
+    return out;
+}
+
+template<typename Image>
+uint64_t BMP_Hash::difference(const std::string &filename) {
+    return difference(thumbnail<Image>(filename, thumbnailSize));
+}
+
+template<typename Image>
+uint64_t BMP_Hash::perceptual(const Image &n) {
+    const std::vector<float> cells = grid(n, 32, 32);
+
+    // Cosines of the first 8 frequencies of the DCT-II, scale factors are left out as only the order matters
+    static const std::vector<double> cosines = []() -> std::vector<double> {
+        std::vector<double> out(8 * 32);
+        for (uint8_t u = 0; u < 8; ++u)
+            for (uint8_t x = 0; x < 32; ++x)
+                out[u * 32 + x] = std::cos((2 * x + 1) * u * 3.14159265358979323846 / 64);
+
+        return out;
+    }();
+
+    // Separable transform, rows then columns, only the lowest 8 frequencies of each
+    double rows[32][8], coefficients[64];
+    for (uint8_t y = 0; y < 32; ++y) {
+        for (uint8_t u = 0; u < 8; ++u) {
+            double sum = 0;
+            for (uint8_t x = 0; x < 32; ++x)
+                sum += cosines[u * 32 + x] * cells[y * 32 + x];
+            rows[y][u] = sum;
+        }
+    }
+
+    for (uint8_t v = 0; v < 8; ++v) {
+        for (uint8_t u = 0; u < 8; ++u) {
+            double sum = 0;
+            for (uint8_t y = 0; y < 32; ++y)
+                sum += cosines[v * 32 + y] * rows[y][u];
+            coefficients[v * 8 + u] = sum;
+        }
+    }
+
+    // Median of the 64 coefficients, the mean of the 32nd and 33rd smallest
+    double sorted[64];
+    std::copy(coefficients, coefficients + 64, sorted);
+    std::nth_element(sorted, sorted + 32, sorted + 64);
+    const double median = (*std::max_element(sorted, sorted + 32) + sorted[32]) / 2;
+
+    uint64_t out = 0;
+    for (uint8_t i = 0; i < 64; ++i)
+        out |= static_cast<uint64_t>(coefficients[i] > median) << i;
+
+    return out;
+}
+
+template<typename Image>
+uint64_t BMP_Hash::perceptual(const std::string &filename) {
+    return perceptual(thumbnail<Image>(filename, thumbnailSize));
+}
+
+uint8_t BMP_Hash::distance(const uint64_t &a, const uint64_t &b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+/// Instantiates every function for an image class
+#define BMP_HASH_INSTANTIATE(Image) \
+    template uint64_t BMP_Hash::content(const Image &); \
+    template uint64_t BMP_Hash::average(const Image &); \
+    template uint64_t BMP_Hash::average<Image>(const std::string &); \
+    template uint64_t BMP_Hash::difference(const Image &); \
+    template uint64_t BMP_Hash::difference<Image>(const std::string &); \
+    template uint64_t BMP_Hash::perceptual(const Image &); \
+    template uint64_t BMP_Hash::perceptual<Image>(const std::string &);
+
+BMP_HASH_INSTANTIATE(BMP_1bit)
+BMP_HASH_INSTANTIATE(BMP_8bit)
+BMP_HASH_INSTANTIATE(BMP_16bit)
+BMP_HASH_INSTANTIATE(BMP_24bit)
+BMP_HASH_INSTANTIATE(BMP_32bit)
@@ -0,0 +1,93 @@
+#ifndef BMP_BMP_HASH_H
+#define BMP_BMP_HASH_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Hashes of images.
+ *
+ * Should not be constructed, it only groups static functions.
+ *
+ * Perceptual hashes are 64-bit fingerprints that change little when an image is resized, recompressed or slightly
+ * edited, so near-duplicates are found by the Hamming distance between their hashes (see BMP_HashIndex). The image is
+ * first reduced to a small greyscale grid: the BT.601 luma of its pixels (colour indices through the colour table,
+ * masked channels scaled to 8 bits) averaged over equal cells. Bit i of a hash is cell (i % 8, i / 8) of the 8 by 8
+ * result, with y going down the image whatever its row-order.
+ *
+ * Every function is available for BMP_1bit, BMP_8bit, BMP_16bit, BMP_24bit and BMP_32bit. The overloads taking a
+ * filename decode a subsampled thumbnail of the file (box-averaged, at least 64 pixels in each dimension when the file
+ * is larger), so the full image is never held in memory. Their hashes are close to, but not always the same as, the
+ * hashes of the full image.
+ */
+class BMP_Hash {
+public:
+    BMP_Hash() = delete;
+
+    /**
+     * @brief 64-bit hash of the dimensions and pixels of an image, not meant to be cryptographically secure.
+     *
+     * Pixels are read through a view, so the padding at the end of the rows, the row-order and the storage of the image
+     * are ignored, as are the headers, the colour table and the bit masks. Each row is hashed 32 bytes at a time, each
+     * 32 bytes with keys of their own so that swapping them changes the hash, with SSE2 when compiled with SSE2 enabled,
+     * and strips of rows in parallel. The hash is the same either way.
+     *
+     * Available for BMP_1bit, BMP_8bit, BMP_16bit, BMP_24bit and BMP_32bit.
+     *
+     * @param n[in] Image
+     * @return The hash
+     */
+    template<typename Image>
+    static uint64_t content(const Image &n);
+
+    ///@{
+    /**
+     * @brief Average hash (aHash), each bit tells whether a cell of an 8 by 8 grid is brighter than the mean.
+     *
+     * @param n[in] Image, or filename of the image
+     * @return The hash
+     */
+    template<typename Image>
+    static uint64_t average(const Image &n);
+
+    template<typename Image>
+    static uint64_t average(const std::string &filename);
+    ///@}
+
+    ///@{
+    /**
+     * @brief Difference hash (dHash), each bit tells whether a cell of a 9 by 8 grid is darker than the cell to its
+     * right.
+     *
+     * @param n[in] Image, or filename of the image
+     * @return The hash
+     */
+    template<typename Image>
+    static uint64_t difference(const Image &n);
+
+    template<typename Image>
+    static uint64_t difference(const std::string &filename);
+    ///@}
+
+    ///@{
+    /**
+     * @brief DCT hash (pHash), each bit tells whether a coefficient of the lowest 8 by 8 frequencies of the discrete
+     * cosine transform of a 32 by 32 grid is larger than their median.
+     *
+     * The most robust of the 3 to changes of brightness, contrast and gamma.
+     *
+     * @param n[in] Image, or filename of the image
+     * @return The hash
+     */
+    template<typename Image>
+    static uint64_t perceptual(const Image &n);
+
+    template<typename Image>
+    static uint64_t perceptual(const std::string &filename);
+    ///@}
+
+    /// Number of bits that differ between two hashes
+    static uint8_t distance(const uint64_t &a, const uint64_t &b);
+};
+
+#endif //BMP_BMP_HASH_H
@@ -0,0 +1,246 @@
+#include "bmp_image.h"
+#include "bmp_8-bit.h"
+#include "bmp_16-bit.h"
+#include "bmp_32-bit.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+
+template<typename Format>
+constexpr uint16_t BMP_Image<Format>::bitCount;
+
+template<typename Format>
+const uint8_t BMP_Image<Format>::pixel_size;
+
+template<typename Format>
+BMP_Image<Format>::BMP_Image(const std::string &filename, const BMP::Decode &decode, const BMP::Layout &layout)
+        : Format::Base(filename), layout(layout), pitch(rowPitch(layout, this->infoHeader.biWidth)) {
+    assertInvalidBitCount();
+    readFormat(filename);
+
+    // Padded layouts keep the rows in file order
+    if (layout != BMP::Layout::packed)
+        this->bottomUp = this->infoHeader.biHeight > 0;
+
+    // Read image data into img, now or the first time it is accessed
+    const int32_t w = this->infoHeader.biWidth, h = this->infoHeader.biHeight;
+    const uint32_t offset = this->fileHeader.bfOffBits;
+    const size_t stride = pitch;
+    const bool fileOrder = this->bottomUp == (h > 0); // Whether the rows in memory are in the same order as in the file
+    const BMP::FileStamp stamp = BMP::getFileStamp(filename);
+    img.setLoader([filename, stamp, w, h, offset, stride, fileOrder](typename Buffer::Vector &img) -> void {
+        img.resize(stride * std::abs(h)); // Left 0 if the file changed
+        std::ifstream f;
+        if (!BMP::openUnchanged(f, filename, stamp))
+            return;
+
+        f.seekg(offset); // Seek to the start of image array
+
+        if (fileOrder && stride * sizeof(Pixel) == rowSize(w)) {
+            // The padding is kept in memory, so the pixel array is read as is
+            f.read(reinterpret_cast<char *>(img.data()), rowSize(w) * std::abs(h));
+        } else {
+            for (int32_t i = 0; i < std::abs(h); ++i) {
+                const int32_t row = fileOrder ? i : std::abs(h) - 1 - i; // Row in memory
+
+                f.read(reinterpret_cast<char *>(&img[row * stride]), sizeof(Pixel) * w);
+
+                f.seekg(padSize(w), std::ios::cur);
+            }
+        }
+
+        f.close();
+    });
+
+    if (decode == BMP::Decode::eager)
+        img.load();
+}
+
+template<typename Format>
+BMP_Image<Format>::BMP_Image(const std::string &filename, const int32_t &x, const int32_t &y, const int32_t &w,
+                             const int32_t &h) : Format::Base(filename), layout(BMP::Layout::packed), pitch(w) {
+    assertInvalidBitCount();
+    readFormat(filename);
+    this->assertInvalidRegion(x, y, w, h);
+
+    std::ifstream f(filename, std::ios::binary);
+
+    // Read image data into img, rows are read in file order and only the bytes inside the region are read
+    img.resize(static_cast<size_t>(w) * h);
+    for (int32_t i = 0; i < h; ++i) {
+        const int32_t row = this->infoHeader.biHeight < 0 ? i : h - 1 - i; // Row inside the region
+
+        f.seekg(this->getFileOffset(x, y + row));
+        f.read(reinterpret_cast<char *>(&img[static_cast<size_t>(row) * w]), sizeof(Pixel) * w);
+    }
+
+    f.close();
+
+    this->setDimensions(w, h);
+}
+
+template<typename Format>
+BMP_Image<Format>::BMP_Image(const std::string &filename, const uint32_t &factor, const BMP::Sampling &sampling)
+        : Format::Base(filename), layout(BMP::Layout::packed), pitch(0) {
+    assertInvalidBitCount();
+    readFormat(filename);
+    BMP::assertInvalidFactor(factor);
+
+    std::ifstream f(filename, std::ios::binary);
+
+    const int32_t width = this->infoHeader.biWidth;
+    const int32_t w = (width + factor - 1) / factor;
+    const int32_t h = (std::abs(this->infoHeader.biHeight) + factor - 1) / factor;
+
+    // Decode every factor-th row into img
+    const std::function<Pixel(const uint8_t *, const uint32_t &)> average = averager();
+    img.resize(static_cast<size_t>(w) * h);
+    this->readSubsampledRows(f, factor, [&](const int32_t &y, const uint8_t *src) {
+        for (int32_t x = 0; x < w; ++x) {
+            const uint32_t begin = x * factor, count = std::min<uint32_t>(factor, width - begin);
+
+            if (sampling == BMP::Sampling::box)
+                img[static_cast<size_t>(y) * w + x] = average(src + begin * sizeof(Pixel), count);
+            else
+                std::memcpy(&img[static_cast<size_t>(y) * w + x], src + begin * sizeof(Pixel), sizeof(Pixel));
+        }
+    });
+
+    f.close();
+
+    pitch = w;
+    this->setDimensions(w, h);
+}
+
+template<typename Format>
+bool BMP_Image<Format>::save(const std::string &filename) const {
+    return save(filename, view());
+}
+
+template<typename Format>
+bool BMP_Image<Format>::save(const std::string &filename, const ConstView &view) const {
+    std::ofstream f(filename, std::ios::binary);
+
+    // Pass to base class function
+    if (!Format::Base::save(f, view.width(), view.height())) {
+        f.close();
+        return false;
+    }
+
+    f.seekp(this->fileHeader.bfOffBits); // Seek to pixel array
+
+    const char padding[4] = {0};
+    const size_t pad = padSize(view.width());
+
+    // Write image data, full-width rows whose padding is in memory (with a padded layout) are written with one call. The
+    // bytes past the end of the rows of a crop are pixels, not padding.
+    int32_t i = 0;
+    const ptrdiff_t step = this->infoHeader.biHeight < 0 ? view.stride() : -view.stride(); // To the next row in file
+    if (layout != BMP::Layout::packed && view.width() == this->infoHeader.biWidth &&
+        step == static_cast<ptrdiff_t>(rowSize(view.width())) && view.height() > 1) {
+        i = view.height() - 1; // The padding of the last row may be past the end of the pixels
+        const int32_t first = this->infoHeader.biHeight < 0 ? 0 : view.height() - 1;
+        f.write(reinterpret_cast<const char *>(view.row(first)), step * i);
+    }
+
+    for (; i < view.height(); ++i) {
+        const int32_t y = this->infoHeader.biHeight < 0 ? i : view.height() - 1 - i;
+
+        f.write(reinterpret_cast<const char *>(view.row(y)), sizeof(Pixel) * view.width());
+        f.write(padding, pad);
+    }
+
+    f.close();
+    return true;
+}
+
+template<typename Format>
+void BMP_Image<Format>::setCopyOnWrite(const bool &enable) {
+    img.setShared(enable);
+}
+
+template<typename Format>
+BMP::Layout BMP_Image<Format>::getLayout() const {
+    return layout;
+}
+
+template<typename Format>
+void BMP_Image<Format>::setLayout(const BMP::Layout &layout) {
+    if (layout == this->layout)
+        return;
+
+    const ConstView src = static_cast<const BMP_Image &>(*this).view();
+    const int32_t h = src.height();
+    const size_t stride = rowPitch(layout, src.width());
+    const bool bottomUp = layout != BMP::Layout::packed && this->infoHeader.biHeight > 0; // Packed rows are top-down
+
+    // Copy the rows to a new buffer, the padding is zero
+    Buffer out(stride * h);
+    Pixel *dst = out.data();
+    for (int32_t y = 0; y < h; ++y)
+        std::memcpy(dst + (bottomUp ? h - 1 - y : y) * stride, src.row(y), sizeof(Pixel) * src.width());
+
+    out.setShared(img.isShared());
+    img.swap(out);
+    this->layout = layout;
+    this->bottomUp = bottomUp;
+    pitch = stride;
+}
+
+template<typename Format>
+typename BMP_Image<Format>::View BMP_Image<Format>::view() {
+    Pixel *top = img.data() + static_cast<size_t>(this->getRow(0)) * pitch; // Top row in memory
+    return View(top, this->infoHeader.biWidth, std::abs(this->infoHeader.biHeight),
+                this->getStride(pitch * sizeof(Pixel)));
+}
+
+template<typename Format>
+typename BMP_Image<Format>::ConstView BMP_Image<Format>::view() const {
+    const Pixel *top = img.data() + static_cast<size_t>(this->getRow(0)) * pitch; // Top row in memory
+    return ConstView(top, this->infoHeader.biWidth, std::abs(this->infoHeader.biHeight),
+                     this->getStride(pitch * sizeof(Pixel)));
+}
+
+template<typename Format>
+typename BMP_Image<Format>::ConstView BMP_Image<Format>::fileView(const uint8_t *data, const size_t &size) {
+    const uint8_t *origin = nullptr;
+    int32_t w = 0, h = 0;
+    ptrdiff_t stride = 0;
+    if (!BMP::mapPixels(data, size, bitCount, origin, w, h, stride))
+        return ConstView();
+
+    return ConstView(reinterpret_cast<const Pixel *>(origin), w, h, stride);
+}
+
+template<typename Format>
+size_t BMP_Image<Format>::rowPitch(const BMP::Layout &layout, const int32_t &w) {
+    static_assert(4 % sizeof(Pixel) == 0, "BMP_Image: Padded rows must hold a whole number of pixels");
+
+    switch (layout) {
+        case BMP::Layout::file:
+            return rowSize(w) / sizeof(Pixel);
+        case BMP::Layout::aligned:
+            return (rowSize(w) + 63) / 64 * 64 / sizeof(Pixel);
+        default:
+            return w;
+    }
+}
+
+template<typename Format>
+size_t BMP_Image<Format>::rowElement(size_t index) const {
+    const size_t w = this->infoHeader.biWidth;
+    return static_cast<size_t>(this->getRow(static_cast<int32_t>(index / w))) * pitch + index % w;
+}
+
+template<typename Format>
+void BMP_Image<Format>::assertInvalidBitCount() const {
+    if (this->infoHeader.biBitCount != bitCount) {
+        std::cerr << Format::name() << ": This is not a " << bitCount << "-bit BMP file." << std::endl;
+        std::exit(1);
+    }
+}
+
+template class BMP_Image<BMP_8bitFormat>;
+template class BMP_Image<BMP_16bitFormat>;
+template class BMP_Image<BMP_32bitFormat>;
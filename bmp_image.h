@@ -0,0 +1,291 @@
+#ifndef BMP_BMP_IMAGE_H
+#define BMP_BMP_IMAGE_H
+
+#include "bmp.h"
+#include "bmp_view.h"
+#include "bmp_buffer.h"
+#include "bmp_aligned-allocator.h"
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <functional>
+#include <utility>
+
+/**
+ * @brief Image class shared by the formats storing one element per pixel, specialised at compile time by a pixel
+ * format.
+ *
+ * A pixel format is a struct with:
+ * - Pixel: type of a pixel, stored the same way in memory and in the file
+ * - Base: BMP_CT for formats with a colour table, BMP_BM for formats with bit masks
+ * - bitCount: bits per pixel, a constant expression
+ * - name(): name of the image class, for error messages
+ *
+ * Row sizes and padding are constant expressions of the bit count and the width. The storage starts at a 64-byte
+ * boundary, and the rows can be padded like in the file, see BMP::Layout. BMP_8bit, BMP_16bit and BMP_32bit
+ * derive from it and only add what is specific to them. What differs between the pixel formats (the colour table or bit
+ * masks, the headers of a new image and box-averaging) is specialised in the source file of each of them.
+ *
+ * @tparam Format Pixel format
+ */
+template<typename Format>
+class BMP_Image : public Format::Base {
+public:
+    /// Type of each element in img
+    typedef typename Format::Pixel Pixel;
+
+    ///@{
+    /// Views of the pixels, see BMP_View
+    typedef BMP_View<Pixel> View;
+    typedef BMP_ConstView<Pixel> ConstView;
+    ///@}
+
+    /// Bits per pixel
+    static constexpr uint16_t bitCount = Format::bitCount;
+
+    /// Size in bytes for 1 pixel
+    static const uint8_t pixel_size = sizeof(Pixel);
+
+    /// Size in bytes of a row of w pixels in a file, padded to a multiple of 4 bytes
+    static constexpr size_t rowSize(const int32_t &w) {
+        return (static_cast<size_t>(w) * bitCount + 31) / 32 * 4;
+    }
+
+    /// Size in bytes of the padding at the end of a row of w pixels in a file
+    static constexpr size_t padSize(const int32_t &w) {
+        return rowSize(w) - static_cast<size_t>(w) * sizeof(Pixel);
+    }
+
+    /**
+     * @brief Constructor for reading from a file.
+     *
+     * @param filename[in] The filename
+     * @param decode[in] Decode the pixels in the constructor (default), or the first time they are accessed or saved
+     * @param layout[in] Layout of the rows in memory, the pixel array is read with one call with BMP::Layout::file
+     */
+    explicit BMP_Image(const std::string &filename, const BMP::Decode &decode = BMP::Decode::eager,
+                       const BMP::Layout &layout = BMP::Layout::packed);
+
+    /**
+     * @brief Constructor for reading a rectangular region from a file.
+     *
+     * Only the rows and bytes covered by the region are read, the rest of the pixel array is skipped.
+     *
+     * @param filename[in] The filename
+     * @param x[in] x of the top-left corner of the region
+     * @param y[in] y of the top-left corner of the region
+     * @param w[in] Width of the region
+     * @param h[in] Height of the region
+     */
+    BMP_Image(const std::string &filename, const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h);
+
+    /**
+     * @brief Constructor for decoding a subsampled thumbnail from a file.
+     *
+     * Only every factor-th row is read from the file, whole, so about 1 / factor of the pixel array is read (see
+     * BMP::Sampling). The thumbnail is ceil(width / factor) by ceil(height / factor).
+     *
+     * Box-averaging averages the colours of the pixels and picks the closest colour in the colour table with a colour
+     * table, and averages each channel given by the bitmask separately with bit masks.
+     *
+     * @param filename[in] The filename
+     * @param factor[in] Subsampling factor, 1 or larger
+     * @param sampling[in] Point-sample (default) or box-average every factor pixels in a row
+     */
+    BMP_Image(const std::string &filename, const uint32_t &factor,
+              const BMP::Sampling &sampling = BMP::Sampling::point);
+
+    /// Copy constructor
+    BMP_Image(const BMP_Image &n) = default;
+
+    /**
+     * @brief Saves the object to a BMP file.
+     *
+     * @param filename[in] Output filename
+     * @return Whether the BMP file has been saved successfully
+     */
+    bool save(const std::string &filename) const;
+
+    /**
+     * @brief Saves a view (e.g. a crop of this image) to a BMP file, using the colour table or bitmask and the
+     * row-order of this image.
+     *
+     * @param filename[in] Output filename
+     * @param view[in] The pixels to save
+     * @return Whether the BMP file has been saved successfully
+     */
+    bool save(const std::string &filename, const ConstView &view) const;
+
+    /**
+     * @brief Turns copy-on-write sharing of the pixels on or off, off by default.
+     *
+     * With sharing on, copies of this image share its pixels until one of them uses a non-const accessor. References
+     * and mutable views taken before copying still point to the shared pixels.
+     *
+     * @param enable[in] Whether copies share the pixels
+     */
+    void setCopyOnWrite(const bool &enable);
+
+    /// Layout of the rows in memory
+    BMP::Layout getLayout() const;
+
+    /**
+     * @brief Changes the layout of the rows in memory, the pixels are copied if it changes.
+     *
+     * Views, references and pointers taken before are invalidated if the layout changes.
+     *
+     * @param layout[in] The layout
+     */
+    void setLayout(const BMP::Layout &layout);
+
+    ///@{
+    /**
+     * @brief View of the whole image, no pixels are copied.
+     *
+     * The view is invalidated when the image is destroyed or assigned to.
+     */
+    View view();
+
+    ConstView view() const;
+    ///@}
+
+    /**
+     * @brief View of the pixel array of a BMP file of this format that is already in memory (e.g. a memory-mapped
+     * file).
+     *
+     * @param data[in] The whole file
+     * @param size[in] Size of data in bytes
+     * @return The view, empty if data is not a complete BMP file of this bit count
+     */
+    static ConstView fileView(const uint8_t *data, const size_t &size);
+
+    ///@{
+    /**
+     * @brief Operator[] for accessing img elements.
+     *
+     * The padding of the rows of a padded layout is skipped, index goes from 0 to width * height - 1 row by row from
+     * the top-left corner, so index y * width + x is the pixel at (x, y) whatever the order of the rows in memory.
+     *
+     * @param index[in] img[index]
+     * @return Reference to the element
+     */
+    Pixel &operator[](const size_t &index);
+
+    const Pixel &operator[](const size_t &index) const;
+    ///@}
+
+    ///@{
+    /**
+     * @brief Access pixel at (x, y), user does not need to handle row-order.
+     *
+     * @param x[in] x
+     * @param y[in] y
+     * @return Reference to the element
+     */
+    Pixel &operator()(const int32_t &x, const int32_t &y);
+
+    const Pixel &operator()(const int32_t &x, const int32_t &y) const;
+    ///@}
+
+    /**
+     * @brief Assignment operator.
+     *
+     * @param n[in] To be copied to the this
+     * @return Reference to this
+     */
+    BMP_Image &operator=(const BMP_Image &n) = default;
+
+protected:
+    /**
+     * @brief Constructor for generating a new image.
+     *
+     * @param w[in] Width, positive only
+     * @param h[in] Height, negative value means flipped row-order
+     * @param background[in] Value of every pixel
+     * @param base[in] Arguments after the dimensions of the constructor of Base
+     */
+    template<typename... Args>
+    BMP_Image(const int32_t &w, const int32_t &h, const Pixel &background, Args &&... base)
+            : Format::Base(w, h, std::forward<Args>(base)...), img(static_cast<size_t>(w) * std::abs(h), background),
+              layout(BMP::Layout::packed), pitch(w) {
+        newHeaders();
+    }
+
+private:
+    /// Storage of the pixels
+    typedef BMP_Buffer<Pixel, BMP_AlignedAllocator<Pixel, 64>> Buffer;
+
+    /// Distance in pixels between the starts of two rows of w pixels in memory with a layout
+    static size_t rowPitch(const BMP::Layout &layout, const int32_t &w);
+
+    ///@{
+    /// Position in img of the pixel at (x, y), or at an index
+    size_t element(const int32_t &x, const int32_t &y) const;
+
+    size_t element(size_t index) const;
+    ///@}
+
+    /// Position in img of the pixel at an index when the rows are padded or stored bottom-up
+    size_t rowElement(size_t index) const;
+
+    /// Assert: The file read is not of this bit count
+    void assertInvalidBitCount() const;
+
+    /// Reads what follows the headers of the file (the colour table, or checks the bitmask)
+    void readFormat(const std::string &filename);
+
+    /// Fills in the headers (and the colour table) of a new image
+    void newHeaders();
+
+    /// Function averaging count pixels stored the same way as in the file, for box-averaging
+    std::function<Pixel(const uint8_t *, const uint32_t &)> averager() const;
+
+    /// Vector for storing image data, stored in row-order.
+    Buffer img;
+
+    /// Layout of the rows in img
+    BMP::Layout layout;
+
+    /// Distance in pixels between the starts of two rows in img
+    size_t pitch;
+};
+
+// Called for every pixel access, so defined here to be inlined
+
+template<typename Format>
+inline typename BMP_Image<Format>::Pixel &BMP_Image<Format>::operator[](const size_t &index) {
+    return img[element(index)];
+}
+
+template<typename Format>
+inline const typename BMP_Image<Format>::Pixel &BMP_Image<Format>::operator[](const size_t &index) const {
+    return img[element(index)];
+}
+
+template<typename Format>
+inline typename BMP_Image<Format>::Pixel &BMP_Image<Format>::operator()(const int32_t &x, const int32_t &y) {
+    return img[element(x, y)];
+}
+
+template<typename Format>
+inline const typename BMP_Image<Format>::Pixel &BMP_Image<Format>::operator()(const int32_t &x,
+                                                                                const int32_t &y) const {
+    return img[element(x, y)];
+}
+
+template<typename Format>
+inline size_t BMP_Image<Format>::element(const int32_t &x, const int32_t &y) const {
+    this->assertInvalidIndex(x, y);
+
+    return static_cast<size_t>(this->getRow(y)) * pitch + x;
+}
+
+template<typename Format>
+inline size_t BMP_Image<Format>::element(size_t index) const {
+    this->assertInvalidIndex(index);
+
+    return pitch == static_cast<size_t>(this->infoHeader.biWidth) && !this->bottomUp ? index : rowElement(index);
+}
+
+#endif //BMP_BMP_IMAGE_H
@@ -0,0 +1,220 @@
+#include "bmp_integral.h"
+#include "bmp_parallel.h"
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+///@{
+/// Prefix sums of n bytes, dst[x] is the sum of src[0] to src[x]
+static void prefix(const uint8_t *src, uint32_t *dst, const size_t &n) {
+    size_t x = 0;
+    uint32_t sum = 0;
+#ifdef __SSE2__
+    // Each 4 sums are added to their neighbours 1 then 2 lanes to the left, then to the last sum so far
+    const __m128i zero = _mm_setzero_si128();
+    __m128i carry = zero;
+    for (; x + 16 <= n; x += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+        const __m128i quarters[4] = {_mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                                     _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)};
+
+        for (uint8_t i = 0; i < 4; ++i) {
+            __m128i s = _mm_add_epi32(quarters[i], _mm_slli_si128(quarters[i], 4));
+            s = _mm_add_epi32(_mm_add_epi32(s, _mm_slli_si128(s, 8)), carry);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + 4 * i), s);
+            carry = _mm_shuffle_epi32(s, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+    }
+
+    sum = _mm_cvtsi128_si32(carry);
+#endif
+
+    for (; x < n; ++x)
+        dst[x] = sum += src[x];
+}
+
+static void prefix(const uint8_t *src, uint64_t *dst, const size_t &n) {
+    size_t x = 0;
+    uint64_t sum = 0;
+#ifdef __SSE2__
+    // Sums of every 4 bytes in 32 bits like above, widened to 64 bits then added to the last sum so far
+    const __m128i zero = _mm_setzero_si128();
+    __m128i carry = zero;
+    for (; x + 16 <= n; x += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        const __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+        const __m128i quarters[4] = {_mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                                     _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)};
+
+        for (uint8_t i = 0; i < 4; ++i) {
+            __m128i s = _mm_add_epi32(quarters[i], _mm_slli_si128(quarters[i], 4));
+            s = _mm_add_epi32(s, _mm_slli_si128(s, 8));
+
+            const __m128i first = _mm_add_epi64(_mm_unpacklo_epi32(s, zero), carry);
+            const __m128i second = _mm_add_epi64(_mm_unpackhi_epi32(s, zero), carry);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + 4 * i), first);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + 4 * i + 2), second);
+            carry = _mm_unpackhi_epi64(second, second);
+        }
+    }
+
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(&sum), carry);
+#endif
+
+    for (; x < n; ++x)
+        dst[x] = sum += src[x];
+}
+///@}
+
+template<typename T>
+BMP_Integral<T>::BMP_Integral(const BMP_8bit &n) {
+    const BMP_8bit::ConstView view = n.view();
+    w = view.width();
+    h = view.height();
+
+    build([&](const int32_t &y) -> const uint8_t * {
+        return view.row(y);
+    }, 1);
+}
+
+template<typename T>
+BMP_Integral<T>::BMP_Integral(const BMP_24bit &n, const uint8_t &channel) {
+    if (channel > 2) {
+        std::cerr << "BMP_Integral: Invalid channel." << std::endl;
+        std::exit(1);
+    }
+
+    // A plane is read as it is, interleaved rows a byte in every pixel
+    if (n.getStorage() == BMP_24bit::Storage::planar) {
+        const BMP_24bit::ConstPlaneView plane = n.plane(static_cast<BMP_24bit::Channel>(channel));
+        w = plane.width();
+        h = plane.height();
+
+        build([&](const int32_t &y) -> const uint8_t * {
+            return plane.row(y);
+        }, 1);
+        return;
+    }
+
+    const BMP_24bit::ConstView view = n.view();
+    w = view.width();
+    h = view.height();
+
+    build([&](const int32_t &y) -> const uint8_t * {
+        return view.bytes(y) + channel;
+    }, sizeof(BMP_24bit::Pixel));
+}
+
+template<typename T>
+template<typename Row>
+void BMP_Integral<T>::build(const Row &row, const size_t &step) {
+    const size_t stride = static_cast<size_t>(w) + 1;
+    table.assign(stride * (static_cast<size_t>(h) + 1), 0);
+    if (!w || !h)
+        return;
+
+    // Prefix sums of each row
+    BMP_Parallel::forRows(0, h, [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y) {
+            const uint8_t *src = row(y);
+            T *dst = &table[(y + 1) * stride + 1];
+
+            if (step == 1) {
+                prefix(src, dst, w);
+            } else {
+                T sum = 0;
+                for (int32_t x = 0; x < w; ++x)
+                    dst[x] = sum += src[x * step];
+            }
+        }
+    });
+
+    // Add each row to the row below, in parallel strips of columns
+    const int32_t columns = 1024;
+    BMP_Parallel::forRows(0, (stride + columns - 1) / columns, [&](const int32_t &begin, const int32_t &end) -> void {
+        const size_t first = static_cast<size_t>(begin) * columns;
+        const size_t last = std::min(stride, static_cast<size_t>(end) * columns);
+        for (int32_t y = 1; y < h; ++y) {
+            const T *above = &table[y * stride];
+            T *below = &table[(y + 1) * stride];
+            for (size_t x = first; x < last; ++x)
+                below[x] += above[x];
+        }
+    }, 1);
+}
+
+template<typename T>
+int32_t BMP_Integral<T>::width() const {
+    return w;
+}
+
+template<typename T>
+int32_t BMP_Integral<T>::height() const {
+    return h;
+}
+
+template<typename T>
+T BMP_Integral<T>::at(const int32_t &x, const int32_t &y) const {
+    if (x < 0 || x > w || y < 0 || y > h) {
+        std::cerr << "BMP_Integral: Index out of bounds" << std::endl;
+        std::exit(1);
+    }
+
+    return table[static_cast<size_t>(y) * (w + 1) + x];
+}
+
+template<typename T>
+T BMP_Integral<T>::sum(const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h) const {
+    if (!validRegion(x, y, w, h)) {
+        std::cerr << "BMP_Integral: Region out of bounds" << std::endl;
+        std::exit(1);
+    }
+
+    const size_t stride = static_cast<size_t>(this->w) + 1;
+    const T *top = &table[y * stride + x], *bottom = &table[(y + h) * stride + x];
+    return bottom[w] - bottom[0] - top[w] + top[0];
+}
+
+template<typename T>
+BMP_1bit BMP_Integral<T>::adaptiveThreshold(const BMP_8bit &n, const uint32_t &radius, const double &k) {
+    const BMP_Integral<T> integral(n);
+    const size_t stride = static_cast<size_t>(integral.w) + 1;
+    const BMP_8bit::ConstView src = n.view();
+    const BMP::InfoHeader &info = n.getInfoHeader();
+    BMP_1bit out(info.biWidth, info.biHeight);
+    const BMP_1bit::View dst = out.view();
+    const int64_t r = radius;
+    const double scale = 1 - k;
+
+    BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y) {
+            const int32_t top = std::max<int64_t>(0, y - r), bottom = std::min<int64_t>(src.height(), y + r + 1);
+            const T *above = &integral.table[top * stride], *below = &integral.table[bottom * stride];
+            const uint8_t *p = src.row(y);
+            uint8_t *o = dst.row(y);
+
+            for (int32_t x = 0; x < src.width(); ++x) {
+                const int32_t left = std::max<int64_t>(0, x - r), right = std::min<int64_t>(src.width(), x + r + 1);
+                const double count = static_cast<double>(right - left) * (bottom - top);
+                const T sum = below[right] - below[left] - above[right] + above[left];
+                o[x] = p[x] * count > sum * scale;
+            }
+        }
+    });
+
+    return out;
+}
+
+template<typename T>
+bool BMP_Integral<T>::validRegion(const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h) const {
+    return x >= 0 && y >= 0 && w >= 0 && h >= 0 && static_cast<int64_t>(x) + w <= this->w &&
+           static_cast<int64_t>(y) + h <= this->h;
+}
+
+template class BMP_Integral<uint32_t>;
+template class BMP_Integral<uint64_t>;
@@ -0,0 +1,99 @@
+#ifndef BMP_BMP_INTEGRAL_H
+#define BMP_BMP_INTEGRAL_H
+
+#include "bmp_1-bit.h"
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Integral image (summed-area table), for the sum of the pixels of any rectangle in constant time.
+ *
+ * Entry (x, y) is the sum of the pixels above and to the left of (x, y), so the table is one entry wider and taller
+ * than the image. Rows are summed with SSE2 prefix sums when compiled with SSE2 enabled, then added down the columns,
+ * both passes in parallel.
+ *
+ * Available for uint32_t and uint64_t sums. Sums are computed modulo 2^32 with uint32_t, which still gives the exact sum
+ * of any rectangle of up to 2^32 / 255 (about 16.8 million) pixels, whatever the size of the image.
+ *
+ * @tparam T Type of the sums
+ */
+template<typename T = uint32_t>
+class BMP_Integral {
+public:
+    /**
+     * @brief Constructor for the integral image of an 8-bit image.
+     *
+     * The colour indices are summed, so the colour table should be ordered by brightness.
+     *
+     * @param n[in] Image
+     */
+    explicit BMP_Integral(const BMP_8bit &n);
+
+    /**
+     * @brief Constructor for the integral image of a channel of a 24-bit image.
+     *
+     * @param n[in] Image
+     * @param channel[in] Byte of the pixels, 0 for blue, 1 for green and 2 for red
+     */
+    BMP_Integral(const BMP_24bit &n, const uint8_t &channel);
+
+    ///@{
+    /// Dimensions of the image
+    int32_t width() const;
+
+    int32_t height() const;
+    ///@}
+
+    /**
+     * @brief Entry of the table, the sum of the pixels (x', y') with x' < x and y' < y.
+     *
+     * @param x[in] x, from 0 to width()
+     * @param y[in] y, from 0 to height()
+     */
+    T at(const int32_t &x, const int32_t &y) const;
+
+    /**
+     * @brief Sum of the pixels in a rectangle, from 4 entries of the table.
+     *
+     * The rectangle must lie inside the image.
+     *
+     * @param x[in] x of the top-left corner
+     * @param y[in] y of the top-left corner
+     * @param w[in] Width of the rectangle
+     * @param h[in] Height of the rectangle
+     * @return The sum, 0 for an empty rectangle
+     */
+    T sum(const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h) const;
+
+    /**
+     * @brief Adaptive thresholding (Bradley-Roth), each pixel is compared to the mean of the square around it.
+     *
+     * A pixel is white if it is larger than the mean of the (2 * radius + 1) by (2 * radius + 1) square around it,
+     * clipped to the image, scaled by 1 - k, and black otherwise. Rows are thresholded in parallel.
+     *
+     * @param n[in] Source image, with a colour table ordered by brightness
+     * @param radius[in] Radius of the square
+     * @param k[in] How far below the mean a pixel must be to be black, from 0 to 1
+     * @return 1-bit image with the default colour table (0 is black, 1 is white), with the dimensions and row-order of
+     * the source
+     */
+    static BMP_1bit adaptiveThreshold(const BMP_8bit &n, const uint32_t &radius, const double &k = 0.15);
+
+private:
+    /// Builds the table from rows of w bytes, step bytes apart, the first byte of row y being at row(y)
+    template<typename Row>
+    void build(const Row &row, const size_t &step);
+
+    /// Check if a rectangle lies inside the image
+    bool validRegion(const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h) const;
+
+    /// Width and height of the image
+    int32_t w, h;
+
+    /// (w + 1) by (h + 1) table, row by row
+    std::vector<T> table;
+};
+
+#endif //BMP_BMP_INTEGRAL_H
@@ -0,0 +1,57 @@
+#ifndef BMP_BMP_INTERLEAVED_H
+#define BMP_BMP_INTERLEAVED_H
+
+#include "bmp_24-bit.h"
+#include <memory>
+
+/**
+ * @brief Read access through view() to an image in either storage.
+ *
+ * Refers to the image itself, except for a BMP_24bit with the planar storage: it then holds an interleaved copy of it,
+ * see BMP_24bit::interleaved(). Functions reading rows of pixels through view() take the image through it first.
+ *
+ * @tparam Image Type of the image
+ */
+template<typename Image>
+class BMP_Interleaved {
+public:
+    explicit BMP_Interleaved(const Image &n) : image(n) {
+    }
+
+    /// The image, with its pixels interleaved
+    const Image &operator*() const {
+        return image;
+    }
+
+    const Image *operator->() const {
+        return &image;
+    }
+
+private:
+    const Image &image;
+};
+
+template<>
+class BMP_Interleaved<BMP_24bit> {
+public:
+    explicit BMP_Interleaved(const BMP_24bit &n) :
+            copy(n.getStorage() == BMP_24bit::Storage::planar ? new BMP_24bit(n.interleaved()) : nullptr),
+            image(copy ? *copy : n) {
+    }
+
+    const BMP_24bit &operator*() const {
+        return image;
+    }
+
+    const BMP_24bit *operator->() const {
+        return &image;
+    }
+
+private:
+    /// Interleaved copy of a planar image
+    const std::unique_ptr<const BMP_24bit> copy;
+
+    const BMP_24bit &image;
+};
+
+#endif //BMP_BMP_INTERLEAVED_H
@@ -0,0 +1,320 @@
+#include "bmp_morphology.h"
+#include "bmp_parallel.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    /// Run of set pixels from x0 to x1 - 1 in row y
+    struct Run {
+        int32_t y, x0, x1;
+    };
+
+    /// Runs of a band of rows, joined with each other
+    struct Band {
+        std::vector<Run> runs;
+
+        /// Index of the first run of each row in runs, and one past the last run
+        std::vector<size_t> rows;
+
+        /// Union-find parent of each run, in the indices of runs
+        std::vector<uint32_t> parent;
+    };
+}
+
+typedef BMP_Morphology::Connectivity Connectivity;
+typedef BMP_Morphology::Component Component;
+
+/// Bits of a row that are inside the width in its last word
+static inline uint64_t lastMask(const int32_t &w) {
+    return w % 64 ? (1ull << (w % 64)) - 1 : ~0ull;
+}
+
+/// Bits 64 * i + k to 64 * i + k + 63 of n words, the bits outside the words being fill
+static inline uint64_t shifted(const uint64_t *a, const size_t &n, const int64_t &i, const int64_t &k,
+                               const uint64_t &fill) {
+    const int64_t bit = 64 * i + k, q = bit >> 6;
+    const uint32_t s = bit & 63;
+    const auto word = [&](const int64_t &j) -> uint64_t {
+        return j >= 0 && j < static_cast<int64_t>(n) ? a[j] : fill;
+    };
+
+    return s ? word(q) >> s | word(q + 1) << (64 - s) : word(q);
+}
+
+/**
+ * @brief Combines every pixel with the pixels in a (2 * rx + 1) by (2 * ry + 1) rectangle around it.
+ *
+ * Windows of len pixels are combined with the windows len pixels further to give windows of 2 * len pixels, up to the
+ * size of the rectangle, first along the rows and then along the columns. Pixels outside the bitmap are identity.
+ *
+ * @param n[in] Source bitmap
+ * @param rx[in] Horizontal radius
+ * @param ry[in] Vertical radius
+ * @param identity[in] Word that op leaves the other word unchanged with, all set for AND and 0 for OR
+ * @param op[in] Combines 2 words
+ * @return The combined bitmap
+ */
+template<typename Op>
+static BMP_Bitmap window(const BMP_Bitmap &n, uint32_t rx, uint32_t ry, const uint64_t &identity, const Op &op) {
+    const int32_t w = n.width(), h = n.height();
+    const size_t words = n.words();
+    BMP_Bitmap out(w, h);
+    if (!w || !h)
+        return out;
+
+    // Pixels further than the size of the bitmap are outside of it for every pixel
+    rx = std::min<uint32_t>(rx, w - 1);
+    ry = std::min<uint32_t>(ry, h - 1);
+
+    // Row e of a is the window of rows e - ry to e - ry + len - 1, so that the rows above the bitmap are kept too
+    const size_t rows = static_cast<size_t>(h) + ry;
+    std::vector<uint64_t> a(rows * words, identity), b(rows * words);
+
+    // Bit e of a row is the window of pixels e - rx to e - rx + len - 1, up to the last pixel that is not identity
+    const size_t extended = (static_cast<size_t>(w) + rx + 63) / 64;
+    BMP_Parallel::forRows(0, h, [&](const int32_t &begin, const int32_t &end) -> void {
+        std::vector<uint64_t> src(words), c(extended), d(extended);
+        for (int32_t y = begin; y < end; ++y) {
+            std::copy(n.row(y), n.row(y) + words, src.begin());
+            src[words - 1] |= identity & ~lastMask(w);
+
+            for (size_t i = 0; i < extended; ++i)
+                c[i] = shifted(src.data(), words, i, -static_cast<int64_t>(rx), identity);
+
+            for (uint32_t len = 1; len < 2 * rx + 1;) {
+                const uint32_t step = std::min(len, 2 * rx + 1 - len);
+                for (size_t i = 0; i < extended; ++i)
+                    d[i] = op(c[i], shifted(c.data(), extended, i, step, identity));
+
+                c.swap(d);
+                len += step;
+            }
+
+            std::copy(c.begin(), c.begin() + words, a.begin() + (static_cast<size_t>(y) + ry) * words);
+        }
+    });
+
+    for (uint32_t len = 1; len < 2 * ry + 1;) {
+        const uint32_t step = std::min(len, 2 * ry + 1 - len);
+        BMP_Parallel::forRows(0, rows, [&](const int32_t &begin, const int32_t &end) -> void {
+            for (size_t e = begin; e < static_cast<size_t>(end); ++e) {
+                const uint64_t *src = &a[e * words], *next = &a[(e + step) * words];
+                uint64_t *dst = &b[e * words];
+                for (size_t i = 0; i < words; ++i)
+                    dst[i] = e + step < rows ? op(src[i], next[i]) : src[i];
+            }
+        });
+
+        a.swap(b);
+        len += step;
+    }
+
+    // Row y of the result is the window of rows y - ry to y + ry
+    const uint64_t mask = lastMask(w);
+    BMP_Parallel::forRows(0, h, [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y) {
+            uint64_t *dst = out.row(y);
+            std::copy(a.begin() + static_cast<size_t>(y) * words, a.begin() + (static_cast<size_t>(y) + 1) * words, dst);
+            dst[words - 1] &= mask;
+        }
+    });
+
+    return out;
+}
+
+/// Appends the runs of set pixels of row y to runs
+static void findRuns(const uint64_t *row, const size_t &words, const int32_t &w, const int32_t &y,
+                     std::vector<Run> &runs) {
+    for (int32_t x = 0; x < w;) {
+        // Next set pixel
+        size_t q = x / 64;
+        uint64_t m = row[q] & ~0ull << (x % 64);
+        while (!m && ++q < words)
+            m = row[q];
+        if (!m)
+            return;
+
+        const int32_t x0 = q * 64 + __builtin_ctzll(m);
+
+        // Next cleared pixel, the bits past the width are cleared
+        q = x0 / 64;
+        m = ~row[q] & ~0ull << (x0 % 64);
+        while (!m && ++q < words)
+            m = ~row[q];
+
+        const int32_t x1 = m ? std::min<int64_t>(w, q * 64 + __builtin_ctzll(m)) : w;
+        runs.push_back({y, x0, x1});
+        x = x1;
+    }
+}
+
+/// Root of the set of run i, the smallest run in it
+static uint32_t find(std::vector<uint32_t> &parent, uint32_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+
+    return i;
+}
+
+/// Joins the sets of runs i and j
+static void join(std::vector<uint32_t> &parent, const uint32_t &i, const uint32_t &j) {
+    const uint32_t a = find(parent, i), b = find(parent, j);
+    if (a < b)
+        parent[b] = a;
+    else if (b < a)
+        parent[a] = b;
+}
+
+/**
+ * @brief Joins the runs of a row with the runs they touch in the row above.
+ *
+ * @param above[in] Runs of the row above, at index first in parent
+ * @param below[in] Runs of the row, at index second in parent
+ * @param reach[in] 1 if runs touching at a corner are joined, 0 otherwise
+ * @param parent[in, out] Union-find parents
+ */
+static void joinRows(const Run *above, const size_t &na, const uint32_t &first, const Run *below, const size_t &nb,
+                     const uint32_t &second, const int32_t &reach, std::vector<uint32_t> &parent) {
+    for (size_t i = 0, j = 0; i < na && j < nb;) {
+        if (above[i].x0 < below[j].x1 + reach && below[j].x0 < above[i].x1 + reach)
+            join(parent, first + i, second + j);
+
+        // The run ending first cannot touch any further run of the other row
+        if (above[i].x1 < below[j].x1)
+            ++i;
+        else
+            ++j;
+    }
+}
+
+/**
+ * @brief Runs of set pixels and their connected components.
+ *
+ * @param n[in] Bitmap
+ * @param connectivity[in] Pixels that are neighbours
+ * @param runs[out] Runs, top to bottom then left to right
+ * @param labels[out] Component of each run, numbered from 0 in the order of their first run
+ * @return Number of components
+ */
+static uint32_t labelRuns(const BMP_Bitmap &n, const Connectivity &connectivity, std::vector<Run> &runs,
+                          std::vector<uint32_t> &labels) {
+    const int32_t h = n.height(), reach = connectivity == Connectivity::eight;
+    const int32_t count = std::max(1, std::min<int32_t>(BMP_Parallel::getThreads(), h));
+    std::vector<Band> bands(count);
+
+    // Join the runs of each band on its own
+    BMP_Parallel::forRows(0, count, [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t k = begin; k < end; ++k) {
+            Band &band = bands[k];
+            const int32_t first = static_cast<int64_t>(h) * k / count, last = static_cast<int64_t>(h) * (k + 1) / count;
+
+            for (int32_t y = first; y < last; ++y) {
+                band.rows.push_back(band.runs.size());
+                findRuns(n.row(y), n.words(), n.width(), y, band.runs);
+            }
+            band.rows.push_back(band.runs.size());
+
+            band.parent.resize(band.runs.size());
+            std::iota(band.parent.begin(), band.parent.end(), 0);
+            for (size_t r = 1; r + 1 < band.rows.size(); ++r)
+                joinRows(&band.runs[band.rows[r - 1]], band.rows[r] - band.rows[r - 1], band.rows[r - 1],
+                         &band.runs[band.rows[r]], band.rows[r + 1] - band.rows[r], band.rows[r], reach, band.parent);
+        }
+    }, 1);
+
+    // Merge the bands, then join the last row of each band with the first row of the next band
+    std::vector<uint32_t> parent;
+    std::vector<size_t> offsets;
+    runs.clear();
+    for (const Band &band : bands) {
+        offsets.push_back(runs.size());
+        for (const uint32_t &p : band.parent)
+            parent.push_back(p + offsets.back());
+
+        runs.insert(runs.end(), band.runs.begin(), band.runs.end());
+    }
+
+    for (int32_t k = 1; k < count; ++k) {
+        const Band &above = bands[k - 1], &below = bands[k];
+        if (above.rows.size() < 2 || below.rows.size() < 2)
+            continue;
+
+        const size_t a = above.rows[above.rows.size() - 2], na = above.runs.size() - a, nb = below.rows[1];
+        joinRows(above.runs.data() + a, na, offsets[k - 1] + a, below.runs.data(), nb, offsets[k], reach, parent);
+    }
+
+    // Roots are the first run of their component, so components are numbered in order of their first run
+    labels.resize(runs.size());
+    uint32_t components = 0;
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const uint32_t root = find(parent, i);
+        labels[i] = root == i ? components++ : labels[root];
+    }
+
+    return components;
+}
+
+BMP_Bitmap BMP_Morphology::erode(const BMP_Bitmap &n, const uint32_t &rx, const uint32_t &ry) {
+    return window(n, rx, ry, ~0ull, [](const uint64_t &a, const uint64_t &b) -> uint64_t {
+        return a & b;
+    });
+}
+
+BMP_Bitmap BMP_Morphology::dilate(const BMP_Bitmap &n, const uint32_t &rx, const uint32_t &ry) {
+    return window(n, rx, ry, 0, [](const uint64_t &a, const uint64_t &b) -> uint64_t {
+        return a | b;
+    });
+}
+
+BMP_Bitmap BMP_Morphology::open(const BMP_Bitmap &n, const uint32_t &rx, const uint32_t &ry) {
+    return dilate(erode(n, rx, ry), rx, ry);
+}
+
+BMP_Bitmap BMP_Morphology::close(const BMP_Bitmap &n, const uint32_t &rx, const uint32_t &ry) {
+    return erode(dilate(n, rx, ry), rx, ry);
+}
+
+std::vector<Component> BMP_Morphology::components(const BMP_Bitmap &n, const Connectivity &connectivity) {
+    std::vector<Run> runs;
+    std::vector<uint32_t> labels;
+    std::vector<Component> out(labelRuns(n, connectivity, runs, labels));
+
+    // Bounding boxes are kept as corners until every run has been added
+    std::vector<bool> seen(out.size(), false);
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const Run &run = runs[i];
+        Component &c = out[labels[i]];
+        if (!seen[labels[i]]) {
+            c = {run.x0, run.y, run.x1, run.y + 1, 0};
+            seen[labels[i]] = true;
+        }
+
+        c.x = std::min(c.x, run.x0);
+        c.w = std::max(c.w, run.x1);
+        c.h = run.y + 1;
+        c.pixels += run.x1 - run.x0;
+    }
+
+    for (Component &c : out) {
+        c.w -= c.x;
+        c.h -= c.y;
+    }
+
+    return out;
+}
+
+std::vector<uint32_t> BMP_Morphology::label(const BMP_Bitmap &n, const Connectivity &connectivity) {
+    std::vector<Run> runs;
+    std::vector<uint32_t> labels;
+    labelRuns(n, connectivity, runs, labels);
+
+    std::vector<uint32_t> out(static_cast<size_t>(n.width()) * n.height(), 0);
+    for (size_t i = 0; i < runs.size(); ++i) {
+        const Run &run = runs[i];
+        std::fill_n(out.begin() + static_cast<size_t>(run.y) * n.width() + run.x0, run.x1 - run.x0, labels[i] + 1);
+    }
+
+    return out;
+}
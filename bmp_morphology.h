@@ -0,0 +1,98 @@
+#ifndef BMP_BMP_MORPHOLOGY_H
+#define BMP_BMP_MORPHOLOGY_H
+
+#include "bmp_bitmap.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Morphology and connected components of black and white images.
+ *
+ * Should not be constructed, it only groups static functions. Images are packed into a BMP_Bitmap first, set pixels
+ * being the foreground, and processed 64 pixels at a time with word shifts, AND and OR. Rows are processed in parallel.
+ */
+class BMP_Morphology {
+public:
+    BMP_Morphology() = delete;
+
+    /// Pixels that are neighbours in a connected component
+    enum class Connectivity {
+        four, ///< Pixels sharing an edge
+        eight ///< Pixels sharing an edge or a corner
+    };
+
+    /// Connected component of set pixels
+    struct Component {
+        int32_t x, y, w, h; ///< Bounding box, top-left corner and dimensions
+        uint64_t pixels;    ///< Number of pixels
+    };
+
+    /**
+     * @brief Erosion by a (2 * rx + 1) by (2 * ry + 1) rectangle, pixels stay set if the whole rectangle around them is.
+     *
+     * Pixels outside the bitmap count as set, so the edges are not eroded. The rectangle is applied separably, each
+     * direction in log2(2 * r + 1) passes of shifted ANDs.
+     *
+     * @param n[in] Source bitmap
+     * @param rx[in] Horizontal radius
+     * @param ry[in] Vertical radius
+     * @return The eroded bitmap
+     */
+    static BMP_Bitmap erode(const BMP_Bitmap &n, const uint32_t &rx, const uint32_t &ry);
+
+    /**
+     * @brief Dilation by a (2 * rx + 1) by (2 * ry + 1) rectangle, pixels are set if any pixel in the rectangle around
+     * them is, see erode().
+     *
+     * @param n[in] Source bitmap
+     * @param rx[in] Horizontal radius
+     * @param ry[in] Vertical radius
+     * @return The dilated bitmap
+     */
+    static BMP_Bitmap dilate(const BMP_Bitmap &n, const uint32_t &rx, const uint32_t &ry);
+
+    /**
+     * @brief Opening, erosion followed by dilation, removes foreground specks smaller than the rectangle.
+     *
+     * @param n[in] Source bitmap
+     * @param rx[in] Horizontal radius
+     * @param ry[in] Vertical radius
+     * @return The opened bitmap
+     */
+    static BMP_Bitmap open(const BMP_Bitmap &n, const uint32_t &rx, const uint32_t &ry);
+
+    /**
+     * @brief Closing, dilation followed by erosion, fills background holes smaller than the rectangle.
+     *
+     * @param n[in] Source bitmap
+     * @param rx[in] Horizontal radius
+     * @param ry[in] Vertical radius
+     * @return The closed bitmap
+     */
+    static BMP_Bitmap close(const BMP_Bitmap &n, const uint32_t &rx, const uint32_t &ry);
+
+    /**
+     * @brief Connected components of the set pixels.
+     *
+     * Rows are split into runs of set pixels, runs touching the runs in the row above are joined with a union-find,
+     * each band of rows on its own thread, then the bands are joined. Components are in the order of their first pixel,
+     * top to bottom then left to right.
+     *
+     * @param n[in] Bitmap
+     * @param connectivity[in] Pixels that are neighbours
+     * @return The components
+     */
+    static std::vector<Component> components(const BMP_Bitmap &n, const Connectivity &connectivity = Connectivity::eight);
+
+    /**
+     * @brief Labels every pixel with its connected component, see components().
+     *
+     * @param n[in] Bitmap
+     * @param connectivity[in] Pixels that are neighbours
+     * @return Label of each pixel, top-down rows of width() labels, 0 for cleared pixels and i + 1 for the pixels of
+     * components()[i]
+     */
+    static std::vector<uint32_t> label(const BMP_Bitmap &n, const Connectivity &connectivity = Connectivity::eight);
+};
+
+#endif //BMP_BMP_MORPHOLOGY_H
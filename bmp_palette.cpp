@@ -0,0 +1,58 @@
+#include "bmp_palette.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+BMP_Palette::BMP_Palette() : entries() {
+}
+
+BMP_Palette::BMP_Palette(const std::vector<uint8_t> &colourTable) : entries() {
+    for (size_t i = 0; i < 256 && 4 * i + 2 < colourTable.size(); ++i)
+        entries[i] = colourTable[4 * i] | colourTable[4 * i + 1] << 8u | colourTable[4 * i + 2] << 16u;
+}
+
+void BMP_Palette::expand(const uint8_t *indices, const size_t &n, uint32_t *dst, const uint8_t &alpha) const {
+    const uint32_t a = static_cast<uint32_t>(alpha) << 24u;
+
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256i va = _mm256_set1_epi32(a);
+    for (; i + 8 <= n; i += 8) {
+        const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(indices + i)));
+        const __m256i colour = _mm256_i32gather_epi32(reinterpret_cast<const int *>(entries), index, 4);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_or_si256(colour, va));
+    }
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = entries[indices[i]] | a;
+}
+
+void BMP_Palette::expand(const uint8_t *indices, const size_t &n, uint8_t *dst) const {
+    size_t i = 0;
+#ifdef __AVX2__
+    // Drops the 4th byte of every pixel, leaving 12 bytes of B, G, R at the bottom of each 128-bit lane
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    // Every iteration fills 24 bytes but writes 28, stop while there is still room for the extra 4 bytes
+    for (; i + 10 <= n; i += 8) {
+        const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(indices + i)));
+        const __m256i colour = _mm256_i32gather_epi32(reinterpret_cast<const int *>(entries), index, 4);
+        const __m256i packed = _mm256_shuffle_epi8(colour, pack);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * i), _mm256_castsi256_si128(packed));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * i + 12), _mm256_extracti128_si256(packed, 1));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        const uint32_t colour = entries[indices[i]];
+
+        dst[3 * i] = colour;
+        dst[3 * i + 1] = colour >> 8u;
+        dst[3 * i + 2] = colour >> 16u;
+    }
+}
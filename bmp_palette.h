@@ -0,0 +1,62 @@
+#ifndef BMP_BMP_PALETTE_H
+#define BMP_BMP_PALETTE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief A colour table cached as packed entries, for expanding colour indices to colours quickly.
+ *
+ * Always holds 256 entries, entries not in the colour table are black. Each entry is an RGB888 value (hex format:
+ * 00 RR GG BB), which is also the byte order B, G, R, 0 of a colour table entry and of a BMP_32bit pixel.
+ *
+ * Rows are expanded with AVX2 gathers when compiled with AVX2 enabled, and with a scalar loop otherwise.
+ */
+class BMP_Palette {
+public:
+    /// Constructs a palette where every entry is black
+    BMP_Palette();
+
+    /**
+     * @brief Constructs a palette from a colour table.
+     *
+     * @param colourTable[in] Colour table, 4 bytes (B, G, R, reserved) per entry
+     */
+    explicit BMP_Palette(const std::vector<uint8_t> &colourTable);
+
+    /**
+     * @brief Entry at index.
+     *
+     * @param index[in] Colour index
+     * @return RGB888 value, hex format: 00 RR GG BB
+     */
+    uint32_t operator[](const uint8_t &index) const {
+        return entries[index];
+    }
+
+    /**
+     * @brief Expands a row of colour indices to 32-bit pixels.
+     *
+     * @param indices[in] Colour indices
+     * @param n[in] Number of pixels
+     * @param dst[out] n pixels, hex format: AA RR GG BB
+     * @param alpha[in] Value of the AA byte
+     */
+    void expand(const uint8_t *indices, const size_t &n, uint32_t *dst, const uint8_t &alpha = 0) const;
+
+    /**
+     * @brief Expands a row of colour indices to 24-bit pixels.
+     *
+     * @param indices[in] Colour indices
+     * @param n[in] Number of pixels
+     * @param dst[out] 3 * n bytes, in the byte order B, G, R of a BMP_24bit pixel
+     */
+    void expand(const uint8_t *indices, const size_t &n, uint8_t *dst) const;
+
+private:
+    /// Packed entries, RGB888
+    uint32_t entries[256];
+};
+
+#endif //BMP_BMP_PALETTE_H
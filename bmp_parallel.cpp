@@ -0,0 +1,48 @@
+#include "bmp_parallel.h"
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+/// Number of threads to use, 0 for the number of hardware threads
+static std::atomic<unsigned> threads(0);
+
+unsigned BMP_Parallel::getThreads() {
+    const unsigned n = threads.load(std::memory_order_relaxed);
+    if (n)
+        return n;
+
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void BMP_Parallel::setThreads(const unsigned &n) {
+    threads.store(n, std::memory_order_relaxed);
+}
+
+void BMP_Parallel::forRows(const int32_t &begin, const int32_t &end,
+                           const std::function<void(const int32_t &, const int32_t &)> &f, const int32_t &grain) {
+    if (begin >= end)
+        return;
+
+    // Use fewer threads if there are not enough rows to give each of them at least grain rows
+    const int64_t rows = static_cast<int64_t>(end) - begin;
+    const int64_t n = std::max<int64_t>(1, std::min<int64_t>(getThreads(), rows / std::max(1, grain)));
+    if (n == 1) {
+        f(begin, end);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(n - 1);
+    for (int64_t i = 1; i < n; ++i) {
+        const int32_t first = begin + rows * i / n, last = begin + rows * (i + 1) / n;
+        workers.emplace_back([&f, first, last]() -> void {
+            f(first, last);
+        });
+    }
+
+    f(begin, begin + rows / n);
+
+    for (std::thread &worker : workers)
+        worker.join();
+}
@@ -0,0 +1,40 @@
+#ifndef BMP_BMP_PARALLEL_H
+#define BMP_BMP_PARALLEL_H
+
+#include <cstdint>
+#include <functional>
+
+/**
+ * @brief Splits loops over rows between several threads.
+ *
+ * Should not be constructed, it only groups static functions.
+ */
+class BMP_Parallel {
+public:
+    BMP_Parallel() = delete;
+
+    /// Number of threads forRows() uses, defaults to the number of hardware threads
+    static unsigned getThreads();
+
+    /**
+     * @brief Sets the number of threads forRows() uses.
+     *
+     * @param n[in] Number of threads, 1 to run everything on the calling thread, 0 to use the number of hardware threads
+     */
+    static void setThreads(const unsigned &n);
+
+    /**
+     * @brief Splits [begin, end) into contiguous ranges and runs each of them on a different thread.
+     *
+     * The calling thread runs the first range itself, and the function returns when every range is done.
+     *
+     * @param begin[in] First row
+     * @param end[in] One past the last row
+     * @param f[in] Called with the first row and one past the last row of each range
+     * @param grain[in] Minimum number of rows in each range
+     */
+    static void forRows(const int32_t &begin, const int32_t &end,
+                        const std::function<void(const int32_t &, const int32_t &)> &f, const int32_t &grain = 16);
+};
+
+#endif //BMP_BMP_PARALLEL_H
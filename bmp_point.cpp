@@ -0,0 +1,342 @@
+#include "bmp_point.h"
+#include "bmp_parallel.h"
+#include "bmp_interleaved.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+typedef BMP_Point::Table Table;
+typedef BMP_Point::Histogram Histogram;
+
+/// Rounds and saturates a value to 8 bits
+static inline uint8_t saturate(const double &v) {
+    return static_cast<uint8_t>(std::lround(std::min(std::max(v, 0.0), 255.0)));
+}
+
+#ifdef __AVX2__
+/**
+ * @brief A table as 16 segments of 16 entries, for looking bytes up with AVX2 shuffles.
+ *
+ * Each half of the table is looked up with a signed index i - 16 * k, saturated so that it stays negative (and reads 0)
+ * once it goes below 0. It reads entry i % 16 of segments 0 to i / 16 of its half, so segments are xor-ed with the one
+ * before them and the xor of those reads is table[i].
+ */
+struct Segments {
+    explicit Segments(const Table &table) {
+        Table xored;
+        for (uint32_t i = 0; i < 256; ++i)
+            xored[i] = table[i] ^ (i % 128 >= 16 ? table[i - 16] : 0);
+
+        for (uint8_t k = 0; k < 16; ++k) {
+            const __m128i entries = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&xored[16 * k]));
+            segment[k] = _mm256_broadcastsi128_si256(entries);
+        }
+    }
+
+    __m256i segment[16];
+};
+
+/// Looks up 32 bytes at a time, returns the number of bytes looked up
+static size_t lookup(const uint8_t *src, uint8_t *dst, const size_t &n, const Segments &table) {
+    const __m256i sixteen = _mm256_set1_epi8(16), high = _mm256_set1_epi8(static_cast<char>(0x80));
+    size_t x = 0;
+    for (; x + 32 <= n; x += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+        __m256i out = _mm256_setzero_si256();
+        for (uint8_t half = 0; half < 2; ++half) {
+            // Values of the other half are negative from the start
+            __m256i i = half ? _mm256_xor_si256(v, high) : v;
+            for (uint8_t k = 0; k < 8; ++k, i = _mm256_subs_epi8(i, sixteen))
+                out = _mm256_xor_si256(out, _mm256_shuffle_epi8(table.segment[8 * half + k], i));
+        }
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), out);
+    }
+
+    return x;
+}
+
+///@{
+/// Splits n pixels of 3 or 4 channels into a row of each channel, and joins them again
+static void split(const uint8_t *src, uint8_t *const *planes, const size_t &n, const size_t &channels) {
+    if (channels == 3) {
+        BMP_24bit::deinterleave(src, planes[0], planes[1], planes[2], n);
+        return;
+    }
+
+    // Groups the bytes of each channel of 4 pixels into a 32-bit lane, then transposes the lanes of 16 pixels
+    const __m128i group = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    size_t x = 0;
+    for (; x + 16 <= n; x += 16) {
+        __m128i v[4];
+        for (uint8_t i = 0; i < 4; ++i)
+            v[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 4 * x + 16 * i)), group);
+
+        const __m128i t0 = _mm_unpacklo_epi32(v[0], v[1]), t1 = _mm_unpackhi_epi32(v[0], v[1]);
+        const __m128i t2 = _mm_unpacklo_epi32(v[2], v[3]), t3 = _mm_unpackhi_epi32(v[2], v[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(planes[0] + x), _mm_unpacklo_epi64(t0, t2));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(planes[1] + x), _mm_unpackhi_epi64(t0, t2));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(planes[2] + x), _mm_unpacklo_epi64(t1, t3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(planes[3] + x), _mm_unpackhi_epi64(t1, t3));
+    }
+
+    for (; x < n; ++x)
+        for (size_t c = 0; c < 4; ++c)
+            planes[c][x] = src[4 * x + c];
+}
+
+static void join(const uint8_t *const *planes, uint8_t *dst, const size_t &n, const size_t &channels) {
+    if (channels == 3) {
+        BMP_24bit::interleave(planes[0], planes[1], planes[2], dst, n);
+        return;
+    }
+
+    // The inverse of split(): transposes the lanes, then spreads the bytes of each lane over 4 pixels
+    const __m128i spread = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    size_t x = 0;
+    for (; x + 16 <= n; x += 16) {
+        __m128i v[4];
+        for (uint8_t c = 0; c < 4; ++c)
+            v[c] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(planes[c] + x));
+
+        const __m128i t0 = _mm_unpacklo_epi32(v[0], v[1]), t1 = _mm_unpackhi_epi32(v[0], v[1]);
+        const __m128i t2 = _mm_unpacklo_epi32(v[2], v[3]), t3 = _mm_unpackhi_epi32(v[2], v[3]);
+        const __m128i p[4] = {_mm_unpacklo_epi64(t0, t2), _mm_unpackhi_epi64(t0, t2), _mm_unpacklo_epi64(t1, t3),
+                              _mm_unpackhi_epi64(t1, t3)};
+        for (uint8_t i = 0; i < 4; ++i)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 4 * x + 16 * i), _mm_shuffle_epi8(p[i], spread));
+    }
+
+    for (; x < n; ++x)
+        for (size_t c = 0; c < 4; ++c)
+            dst[4 * x + c] = planes[c][x];
+}
+///@}
+#endif
+
+/// Looks up n bytes in a table
+static void lookup(const uint8_t *src, uint8_t *dst, const size_t &n, const Table &table) {
+    size_t x = 0;
+#ifdef __AVX2__
+    x = lookup(src, dst, n, Segments(table));
+#endif
+
+    for (; x < n; ++x)
+        dst[x] = table[src[x]];
+}
+
+/// Looks up the channels of n pixels, each in its own table
+static void lookup(const uint8_t *src, uint8_t *dst, const size_t &n, const std::vector<Table> &tables) {
+    const size_t channels = tables.size();
+    size_t x = 0;
+#ifdef __AVX2__
+    // Blocks of pixels are split into a row of each channel, which is looked up 32 bytes at a time in its own table
+    if (channels == 3 || channels == 4) {
+        const size_t block = 512;
+        uint8_t planes[4][block];
+        uint8_t *const rows[4] = {planes[0], planes[1], planes[2], planes[3]};
+        const Segments segments[4] = {Segments(tables[0]), Segments(tables[1]), Segments(tables[2]),
+                                      Segments(tables[channels - 1])};
+
+        for (size_t count; x + 32 <= n; x += count) {
+            count = std::min(block, n - x);
+            split(src + x * channels, rows, count, channels);
+            for (size_t c = 0; c < channels; ++c) {
+                for (size_t i = lookup(rows[c], rows[c], count, segments[c]); i < count; ++i)
+                    rows[c][i] = tables[c][rows[c][i]];
+            }
+            join(rows, dst + x * channels, count, channels);
+        }
+    }
+#endif
+
+    for (; x < n; ++x)
+        for (size_t c = 0; c < channels; ++c)
+            dst[x * channels + c] = tables[c][src[x * channels + c]];
+}
+
+Table BMP_Point::identity() {
+    Table table;
+    for (uint32_t v = 0; v < 256; ++v)
+        table[v] = v;
+
+    return table;
+}
+
+Table BMP_Point::brightness(const int16_t &offset) {
+    Table table;
+    for (int32_t v = 0; v < 256; ++v)
+        table[v] = std::min(std::max(v + offset, 0), 255);
+
+    return table;
+}
+
+Table BMP_Point::contrast(const double &factor) {
+    Table table;
+    for (int32_t v = 0; v < 256; ++v)
+        table[v] = saturate((v - 128) * factor + 128);
+
+    return table;
+}
+
+Table BMP_Point::gamma(const double &g) {
+    return levels(0, 255, g);
+}
+
+Table BMP_Point::levels(const uint8_t &inLow, const uint8_t &inHigh, const double &g, const uint8_t &outLow,
+                        const uint8_t &outHigh) {
+    if (!(g > 0)) {
+        std::cerr << "BMP_Point: Invalid gamma." << std::endl;
+        std::exit(1);
+    }
+
+    Table table;
+    for (int32_t v = 0; v < 256; ++v) {
+        double t;
+        if (inHigh <= inLow)
+            t = v < inHigh ? 0 : 1;
+        else
+            t = std::pow(std::min(std::max(static_cast<double>(v - inLow) / (inHigh - inLow), 0.0), 1.0), 1 / g);
+
+        table[v] = saturate(outLow + t * (outHigh - outLow));
+    }
+
+    return table;
+}
+
+Table BMP_Point::threshold(const uint8_t &t) {
+    Table table;
+    for (uint32_t v = 0; v < 256; ++v)
+        table[v] = v >= t ? 255 : 0;
+
+    return table;
+}
+
+template<typename Image>
+Image BMP_Point::apply(const Image &n, const Table &table) {
+    const BMP_Interleaved<Image> interleaved(n);
+    Image out(*interleaved);
+    const typename Image::ConstView src = interleaved->view();
+    const typename Image::View dst = out.view();
+    const size_t rowBytes = static_cast<size_t>(src.width()) * sizeof(typename Image::Pixel);
+
+    BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y)
+            lookup(src.bytes(y), dst.bytes(y), rowBytes, table);
+    });
+
+    return out;
+}
+
+template<typename Image>
+Image BMP_Point::apply(const Image &n, const std::vector<Table> &tables) {
+    if (tables.size() != sizeof(typename Image::Pixel)) {
+        std::cerr << "BMP_Point: Wrong number of tables." << std::endl;
+        std::exit(1);
+    }
+
+    if (std::all_of(tables.begin(), tables.end(), [&](const Table &table) -> bool {
+        return table == tables[0];
+    }))
+        return apply(n, tables[0]);
+
+    const BMP_Interleaved<Image> interleaved(n);
+    Image out(*interleaved);
+    const typename Image::ConstView src = interleaved->view();
+    const typename Image::View dst = out.view();
+
+    BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y)
+            lookup(src.bytes(y), dst.bytes(y), src.width(), tables);
+    });
+
+    return out;
+}
+
+template<typename Image>
+std::vector<Histogram> BMP_Point::histogram(const Image &n) {
+    const BMP_Interleaved<Image> interleaved(n);
+    const typename Image::ConstView src = interleaved->view();
+    const size_t channels = sizeof(typename Image::Pixel);
+    const size_t w = src.width();
+    std::vector<Histogram> total(channels, Histogram());
+    std::mutex mutex;
+
+    BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        // 32-bit counts of sub-histogram s at [(s * channels + c) * 256 + v], added to the totals before they overflow
+        std::vector<uint32_t> counts(4 * channels * 256, 0);
+        std::vector<Histogram> local(channels, Histogram());
+        size_t pending = 0;
+
+        const auto flush = [&]() -> void {
+            for (size_t i = 0; i < counts.size(); ++i)
+                local[i / 256 % channels][i % 256] += counts[i];
+
+            std::fill(counts.begin(), counts.end(), 0);
+            pending = 0;
+        };
+
+        for (int32_t y = begin; y < end; ++y) {
+            if (pending + w > std::numeric_limits<uint32_t>::max())
+                flush();
+            pending += w;
+
+            const uint8_t *p = src.bytes(y);
+            size_t x = 0;
+            for (; x + 4 <= w; x += 4, p += 4 * channels)
+                for (size_t s = 0; s < 4; ++s)
+                    for (size_t c = 0; c < channels; ++c)
+                        ++counts[(s * channels + c) * 256 + p[s * channels + c]];
+
+            for (; x < w; ++x, p += channels)
+                for (size_t c = 0; c < channels; ++c)
+                    ++counts[c * 256 + p[c]];
+        }
+
+        flush();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t c = 0; c < channels; ++c)
+            for (size_t v = 0; v < 256; ++v)
+                total[c][v] += local[c][v];
+    });
+
+    return total;
+}
+
+template<typename Image>
+Image BMP_Point::autoLevels(const Image &n, const double &clip) {
+    const std::vector<Histogram> histograms = histogram(n);
+    const double pixels = static_cast<double>(n.getInfoHeader().biWidth) * std::abs(n.getInfoHeader().biHeight);
+    const uint64_t cut = std::floor(std::min(std::max(clip, 0.0), 0.5) * pixels);
+
+    std::vector<Table> tables;
+    for (const Histogram &counts : histograms) {
+        // Lowest and highest values once cut pixels have been skipped at each end
+        int32_t low = 0, high = 255;
+        for (uint64_t sum = counts[low]; sum <= cut && low < 255; sum += counts[++low]);
+        for (uint64_t sum = counts[high]; sum <= cut && high > 0; sum += counts[--high]);
+
+        tables.push_back(low < high ? levels(low, high) : identity());
+    }
+
+    return apply(n, tables);
+}
+
+/// Instantiates every function for an image class
+#define BMP_POINT_INSTANTIATE(Image) \
+    template Image BMP_Point::apply(const Image &, const Table &); \
+    template Image BMP_Point::apply(const Image &, const std::vector<Table> &); \
+    template std::vector<Histogram> BMP_Point::histogram(const Image &); \
+    template Image BMP_Point::autoLevels(const Image &, const double &);
+
+BMP_POINT_INSTANTIATE(BMP_8bit)
+BMP_POINT_INSTANTIATE(BMP_24bit)
+BMP_POINT_INSTANTIATE(BMP_32bit)
@@ -0,0 +1,128 @@
+#ifndef BMP_BMP_POINT_H
+#define BMP_BMP_POINT_H
+
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include <cstdint>
+#include <array>
+#include <vector>
+
+/**
+ * @brief Point operations: per-channel lookup tables and histograms.
+ *
+ * Should not be constructed, it only groups static functions. Each image function is available for BMP_8bit,
+ * BMP_24bit and BMP_32bit, every byte of a pixel being a separate channel like in BMP_Filter: B, G, R for 24-bit
+ * images, B, G, R, A for 32-bit images and the colour index for 8-bit images (which should have a colour table ordered
+ * by brightness). Rows are processed in parallel.
+ */
+class BMP_Point {
+public:
+    BMP_Point() = delete;
+
+    /// Lookup table, the new value of every 8-bit value
+    typedef std::array<uint8_t, 256> Table;
+
+    /// Number of occurrences of every 8-bit value
+    typedef std::array<uint64_t, 256> Histogram;
+
+    /// Table that keeps every value
+    static Table identity();
+
+    /**
+     * @brief Table that adds an offset to every value, saturated to [0, 255].
+     *
+     * @param offset[in] Offset
+     */
+    static Table brightness(const int16_t &offset);
+
+    /**
+     * @brief Table that scales the distance of every value from the middle grey (128), saturated to [0, 255].
+     *
+     * @param factor[in] Scale, above 1 to increase the contrast and below 1 to decrease it
+     */
+    static Table contrast(const double &factor);
+
+    /**
+     * @brief Gamma correction table, 255 * (v / 255) ^ (1 / g).
+     *
+     * @param g[in] Gamma, above 1 to brighten and below 1 to darken, positive only
+     */
+    static Table gamma(const double &g);
+
+    /**
+     * @brief Levels adjustment table.
+     *
+     * Values are mapped linearly from [inLow, inHigh] to [0, 1] (clamped), gamma corrected, then mapped linearly to
+     * [outLow, outHigh]. If inHigh <= inLow, values below inHigh become outLow and the others outHigh.
+     *
+     * @param inLow[in] Value that becomes outLow
+     * @param inHigh[in] Value that becomes outHigh
+     * @param g[in] Gamma, see gamma()
+     * @param outLow[in] Lowest output value
+     * @param outHigh[in] Highest output value
+     */
+    static Table levels(const uint8_t &inLow, const uint8_t &inHigh, const double &g = 1, const uint8_t &outLow = 0,
+                        const uint8_t &outHigh = 255);
+
+    /**
+     * @brief Threshold table, 255 for values above or equal to t and 0 for the others.
+     *
+     * @param t[in] Threshold
+     */
+    static Table threshold(const uint8_t &t);
+
+    /**
+     * @brief Applies the same table to every channel of an image.
+     *
+     * Looks up 32 bytes at a time with AVX2 shuffles, one per 16-entry segment of the table, when compiled with AVX2
+     * enabled.
+     *
+     * @param n[in] Source image
+     * @param table[in] Table
+     * @return Copy of the image with new pixels, it keeps the row-order and the colour table or bitmask
+     */
+    template<typename Image>
+    static Image apply(const Image &n, const Table &table);
+
+    /**
+     * @brief Applies a table to each channel of an image.
+     *
+     * Falls back on the single table version if all the tables are the same. Otherwise, when compiled with AVX2
+     * enabled, blocks of pixels are split into a row of each channel with shuffles, each row is looked up in its own
+     * table like the single table version, and the rows are joined again.
+     *
+     * @param n[in] Source image
+     * @param tables[in] Table of each channel, as many as bytes in a pixel
+     * @return Copy of the image with new pixels, it keeps the row-order and the colour table or bitmask
+     */
+    template<typename Image>
+    static Image apply(const Image &n, const std::vector<Table> &tables);
+
+    /**
+     * @brief Histograms of the channels of an image, in a single pass.
+     *
+     * Consecutive pixels are counted in 4 separate sub-histograms, so that repeated values do not stall on the same
+     * counter, and each thread counts its own rows before the counts are merged.
+     *
+     * @param n[in] Image
+     * @return Histogram of each channel, as many as bytes in a pixel
+     */
+    template<typename Image>
+    static std::vector<Histogram> histogram(const Image &n);
+
+    /**
+     * @brief Stretches each channel of an image to the full [0, 255] range, see levels().
+     *
+     * The lowest and highest values of each channel are taken from its histogram, ignoring a fraction of the pixels at
+     * each end. Channels with a single value (e.g. an unused alpha byte) are kept as they are.
+     *
+     * @param n[in] Source image
+     * @param clip[in] Fraction of the pixels ignored at each end of the histogram, from 0 to 0.5
+     * @return Copy of the image with new pixels, it keeps the row-order and the colour table or bitmask
+     */
+    template<typename Image>
+    static Image autoLevels(const Image &n, const double &clip = 0.005);
+};
+
+#endif //BMP_BMP_POINT_H
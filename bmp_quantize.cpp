@@ -0,0 +1,221 @@
+#include "bmp_quantize.h"
+#include "bmp_parallel.h"
+#include "bmp_interleaved.h"
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+
+/// Number of bits kept per channel in the histogram and the lookup cube
+static const uint32_t bits = 5;
+
+/// Number of cells per side of the histogram and the lookup cube
+static const uint32_t side = 1u << bits;
+
+/// Cell of a colour in the histogram and the lookup cube
+static inline uint32_t cell(const uint8_t &r, const uint8_t &g, const uint8_t &b) {
+    return (r >> (8 - bits)) << (2 * bits) | (g >> (8 - bits)) << bits | b >> (8 - bits);
+}
+
+namespace {
+    /// Number of pixels and the sum of their colours in a histogram cell
+    struct Bin {
+        uint64_t count, r, g, b;
+    };
+
+    /// Box of cells in the histogram, in the order red, green, blue
+    struct Box {
+        uint32_t lo[3], hi[3];
+        uint64_t count;
+    };
+}
+
+/// Index of the cell at red, green, blue coordinates c
+static inline uint32_t cell(const uint32_t *c) {
+    return c[0] << (2 * bits) | c[1] << bits | c[2];
+}
+
+/// Shrinks a box to the cells that are not empty, and counts its pixels
+static void shrink(Box &box, const std::vector<Bin> &histogram) {
+    uint32_t lo[3] = {side, side, side}, hi[3] = {0, 0, 0}, c[3];
+    box.count = 0;
+
+    for (c[0] = box.lo[0]; c[0] <= box.hi[0]; ++c[0]) {
+        for (c[1] = box.lo[1]; c[1] <= box.hi[1]; ++c[1]) {
+            for (c[2] = box.lo[2]; c[2] <= box.hi[2]; ++c[2]) {
+                const uint64_t count = histogram[cell(c)].count;
+                if (!count)
+                    continue;
+
+                box.count += count;
+                for (uint8_t i = 0; i < 3; ++i) {
+                    lo[i] = std::min(lo[i], c[i]);
+                    hi[i] = std::max(hi[i], c[i]);
+                }
+            }
+        }
+    }
+
+    if (box.count) {
+        std::copy(lo, lo + 3, box.lo);
+        std::copy(hi, hi + 3, box.hi);
+    }
+}
+
+BMP_8bit BMP_Quantize::quantize(const BMP_24bit &n, const uint16_t &colours) {
+    const BMP_Interleaved<BMP_24bit> interleaved(n);
+    return remap(*interleaved, palette(*interleaved, colours));
+}
+
+std::vector<uint8_t> BMP_Quantize::palette(const BMP_24bit &n, const uint16_t &colours) {
+    const BMP_Interleaved<BMP_24bit> interleaved(n);
+    const BMP_24bit::ConstView src = interleaved->view();
+
+    // Count the colours, every thread fills its own histogram which are then added together
+    std::vector<Bin> histogram(side * side * side, Bin());
+    std::mutex mutex;
+    BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        std::vector<Bin> local(histogram.size(), Bin());
+        for (int32_t y = begin; y < end; ++y) {
+            const BMP_24bit::Pixel *row = src.row(y);
+            for (int32_t x = 0; x < src.width(); ++x) {
+                Bin &bin = local[cell(row[x].r, row[x].g, row[x].b)];
+                ++bin.count;
+                bin.r += row[x].r;
+                bin.g += row[x].g;
+                bin.b += row[x].b;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < histogram.size(); ++i) {
+            histogram[i].count += local[i].count;
+            histogram[i].r += local[i].r;
+            histogram[i].g += local[i].g;
+            histogram[i].b += local[i].b;
+        }
+    }, 64);
+
+    // Median cut
+    std::vector<Box> boxes(1, {{0, 0, 0}, {side - 1, side - 1, side - 1}, 0});
+    shrink(boxes[0], histogram);
+    while (boxes.size() < std::min<uint16_t>(std::max<uint16_t>(colours, 1), 256)) {
+        // Split the most populated box that spans more than one cell
+        Box *box = nullptr;
+        for (Box &b : boxes) {
+            const bool splittable = b.hi[0] > b.lo[0] || b.hi[1] > b.lo[1] || b.hi[2] > b.lo[2];
+            if (splittable && (!box || b.count > box->count))
+                box = &b;
+        }
+
+        if (!box)
+            break;
+
+        // Along its longest side
+        uint8_t axis = 0;
+        for (uint8_t i = 1; i < 3; ++i) {
+            if (box->hi[i] - box->lo[i] > box->hi[axis] - box->lo[axis])
+                axis = i;
+        }
+
+        // Count the pixels in every slice of the box along the axis
+        std::vector<uint64_t> slices(side, 0);
+        uint32_t c[3];
+        for (c[0] = box->lo[0]; c[0] <= box->hi[0]; ++c[0]) {
+            for (c[1] = box->lo[1]; c[1] <= box->hi[1]; ++c[1]) {
+                for (c[2] = box->lo[2]; c[2] <= box->hi[2]; ++c[2])
+                    slices[c[axis]] += histogram[cell(c)].count;
+            }
+        }
+
+        // Split after the slice where half of the pixels have been passed, leaving at least one slice on each side
+        uint32_t split = box->lo[axis];
+        uint64_t passed = slices[split];
+        while (split + 1 < box->hi[axis] && passed * 2 < box->count)
+            passed += slices[++split];
+
+        Box upper = *box;
+        box->hi[axis] = split;
+        upper.lo[axis] = split + 1;
+        shrink(*box, histogram);
+        shrink(upper, histogram);
+        boxes.push_back(upper);
+    }
+
+    // Each entry is the average colour of the pixels in a box
+    std::vector<uint8_t> table;
+    for (const Box &box : boxes) {
+        uint64_t r = 0, g = 0, b = 0;
+        uint32_t c[3];
+        for (c[0] = box.lo[0]; c[0] <= box.hi[0]; ++c[0]) {
+            for (c[1] = box.lo[1]; c[1] <= box.hi[1]; ++c[1]) {
+                for (c[2] = box.lo[2]; c[2] <= box.hi[2]; ++c[2]) {
+                    const Bin &bin = histogram[cell(c)];
+                    r += bin.r;
+                    g += bin.g;
+                    b += bin.b;
+                }
+            }
+        }
+
+        const uint64_t count = std::max<uint64_t>(box.count, 1);
+        table.push_back((b + count / 2) / count);
+        table.push_back((g + count / 2) / count);
+        table.push_back((r + count / 2) / count);
+        table.push_back(0);
+    }
+
+    return table;
+}
+
+BMP_8bit BMP_Quantize::remap(const BMP_24bit &n, const std::vector<uint8_t> &colourTable) {
+    const size_t entries = std::min<size_t>(colourTable.size() / 4, 256);
+
+    // Closest entry to the centre of every cell, computed in parallel over the red slices
+    std::vector<uint8_t> cube(side * side * side, 0);
+    BMP_Parallel::forRows(0, side, [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t r = begin; r < end; ++r) {
+            for (uint32_t g = 0; g < side; ++g) {
+                for (uint32_t b = 0; b < side; ++b) {
+                    const int32_t centre[3] = {
+                            static_cast<int32_t>(b << (8 - bits) | 1u << (7 - bits)),
+                            static_cast<int32_t>(g << (8 - bits) | 1u << (7 - bits)),
+                            static_cast<int32_t>(r << (8 - bits) | 1u << (7 - bits))
+                    };
+
+                    uint32_t minDistance = UINT32_MAX;
+                    uint8_t &nearest = cube[r << (2 * bits) | g << bits | b];
+                    for (size_t i = 0; i < entries; ++i) {
+                        uint32_t distance = 0;
+                        for (uint8_t c = 0; c < 3; ++c) {
+                            const int32_t d = colourTable[4 * i + c] - centre[c];
+                            distance += d * d;
+                        }
+
+                        if (distance < minDistance) {
+                            minDistance = distance;
+                            nearest = i;
+                        }
+                    }
+                }
+            }
+        }
+    }, 1);
+
+    BMP_8bit out(n.getInfoHeader().biWidth, n.getInfoHeader().biHeight);
+    out.setColourTable(std::vector<uint8_t>(colourTable.begin(), colourTable.begin() + 4 * entries));
+
+    // Map every pixel with a lookup in the cube
+    const BMP_Interleaved<BMP_24bit> interleaved(n);
+    const BMP_24bit::ConstView src = interleaved->view();
+    const BMP_8bit::View dst = out.view();
+    BMP_Parallel::forRows(0, src.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y) {
+            const BMP_24bit::Pixel *in = src.row(y);
+            uint8_t *o = dst.row(y);
+            for (int32_t x = 0; x < src.width(); ++x)
+                o[x] = cube[cell(in[x].r, in[x].g, in[x].b)];
+        }
+    });
+
+    return out;
+}
@@ -0,0 +1,54 @@
+#ifndef BMP_BMP_QUANTIZE_H
+#define BMP_BMP_QUANTIZE_H
+
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Colour quantization from 24-bit images to 8-bit images with a colour table built from the image.
+ *
+ * Should not be constructed, it only groups static functions.
+ */
+class BMP_Quantize {
+public:
+    BMP_Quantize() = delete;
+
+    /**
+     * @brief Converts a 24-bit image to an 8-bit image with a colour table built from its colours.
+     *
+     * The colour table is built with palette(), then every pixel is mapped with remap().
+     *
+     * @param n[in] Source image
+     * @param colours[in] Maximum number of colours, clamped to 1 - 256
+     * @return The 8-bit image, with the dimensions and row-order of the source
+     */
+    static BMP_8bit quantize(const BMP_24bit &n, const uint16_t &colours = 256);
+
+    /**
+     * @brief Builds a colour table for an image with median cut.
+     *
+     * Colours are counted in a histogram with 5 bits per channel. The box with the most pixels is split at the median
+     * of its longest side until there are enough boxes, and each entry is the average colour of the pixels in a box.
+     *
+     * @param n[in] Source image
+     * @param colours[in] Maximum number of colours, clamped to 1 - 256
+     * @return Colour table, 4 bytes (B, G, R, 0) per entry
+     */
+    static std::vector<uint8_t> palette(const BMP_24bit &n, const uint16_t &colours = 256);
+
+    /**
+     * @brief Maps every pixel of a 24-bit image to the closest entry of a colour table.
+     *
+     * The closest entry to the centre of every cell of a 32x32x32 colour cube is computed first, so that every pixel is
+     * mapped with a single lookup. Rows are mapped in parallel.
+     *
+     * @param n[in] Source image
+     * @param colourTable[in] Colour table, 4 bytes (B, G, R, reserved) per entry, at most 256 entries
+     * @return The 8-bit image, with the dimensions and row-order of the source
+     */
+    static BMP_8bit remap(const BMP_24bit &n, const std::vector<uint8_t> &colourTable);
+};
+
+#endif //BMP_BMP_QUANTIZE_H
@@ -0,0 +1,134 @@
+#include "bmp_resize.h"
+#include "bmp_interleaved.h"
+#include "bmp_convert.h"
+#include "bmp_quantize.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+/// Normalised sinc
+static double sinc(const double &x) {
+    if (x == 0)
+        return 1;
+
+    const double a = 3.14159265358979323846 * x;
+    return std::sin(a) / a;
+}
+
+/// Resamples every channel of src into dst
+template<typename Pixel>
+static void resample(const BMP_ConstView<Pixel> &src, const BMP_View<Pixel> &dst, const uint8_t &channels,
+                     const BMP_Resize::Filter &filter) {
+    BMP_Separable::apply(src.bytes(0), src.stride(), dst.bytes(0), dst.stride(), channels,
+                         BMP_Resize::weights(src.width(), dst.width(), filter),
+                         BMP_Resize::weights(src.height(), dst.height(), filter));
+}
+
+/// Exits if the image or the new dimensions are empty
+static void assertInvalidDimensions(const BMP &n, const int32_t &w, const int32_t &h) {
+    if (w <= 0 || h <= 0 || n.getInfoHeader().biWidth <= 0 || n.getInfoHeader().biHeight == 0) {
+        std::cerr << "BMP_Resize: Invalid dimensions." << std::endl;
+        std::exit(1);
+    }
+}
+
+/// Height of the resized image, with the row-order of n
+static int32_t signedHeight(const BMP &n, const int32_t &h) {
+    return n.getInfoHeader().biHeight < 0 ? -h : h;
+}
+
+BMP_8bit BMP_Resize::resize(const BMP_8bit &n, const int32_t &w, const int32_t &h, const Filter &filter) {
+    assertInvalidDimensions(n, w, h);
+
+    // Indices of the default grey colour table are their brightness, other indices are resampled as colours
+    const std::vector<uint8_t> colourTable = n.getColourTable();
+    bool grey = colourTable.size() == 4 * 256;
+    for (size_t i = 0; grey && i < 256; ++i)
+        grey = colourTable[4 * i] == i && colourTable[4 * i + 1] == i && colourTable[4 * i + 2] == i;
+
+    if (!grey)
+        return BMP_Quantize::remap(resize(BMP_Convert::toBMP_24bit(n), w, h, filter), colourTable);
+
+    BMP_8bit out(w, signedHeight(n, h));
+    out.setColourTable(colourTable);
+    resample(n.view(), out.view(), 1, filter);
+
+    return out;
+}
+
+BMP_24bit BMP_Resize::resize(const BMP_24bit &n, const int32_t &w, const int32_t &h, const Filter &filter) {
+    assertInvalidDimensions(n, w, h);
+
+    BMP_24bit out(w, signedHeight(n, h));
+    resample(BMP_Interleaved<BMP_24bit>(n)->view(), out.view(), 3, filter);
+
+    return out;
+}
+
+BMP_32bit BMP_Resize::resize(const BMP_32bit &n, const int32_t &w, const int32_t &h, const Filter &filter) {
+    assertInvalidDimensions(n, w, h);
+
+    BMP_32bit out(w, signedHeight(n, h), 0, n.getBitmask());
+    const std::vector<uint32_t> masks = n.getPixelMasks();
+    if (std::all_of(masks.begin(), masks.end(), [](const uint32_t &mask) -> bool {
+        return !mask || mask == 0xFFu || mask == 0xFF00u || mask == 0xFF0000u || mask == 0xFF000000u;
+    })) {
+        resample(n.view(), out.view(), 4, filter);
+        return out;
+    }
+
+    // Channels that are not whole bytes are scaled to bytes, resampled, then scaled back
+    const BMP_32bit::ConstView src = n.view();
+    const BMP_32bit::View dst = out.view();
+    std::vector<uint32_t> expanded(static_cast<size_t>(src.width()) * src.height());
+    std::vector<uint32_t> resized(static_cast<size_t>(w) * h);
+    for (int32_t y = 0; y < src.height(); ++y) {
+        for (int32_t x = 0; x < src.width(); ++x) {
+            uint32_t &p = expanded[static_cast<size_t>(y) * src.width() + x];
+            for (uint8_t c = 0; c < 4; ++c)
+                p |= static_cast<uint32_t>(BMP_BM::toByte(src.row(y)[x], masks[c])) << 8u * c;
+        }
+    }
+
+    resample(BMP_ConstView<uint32_t>(expanded.data(), src.width(), src.height(), src.width() * sizeof(uint32_t)),
+             BMP_View<uint32_t>(resized.data(), w, h, w * sizeof(uint32_t)), 4, filter);
+
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x) {
+            const uint32_t p = resized[static_cast<size_t>(y) * w + x];
+            dst.row(y)[x] = 0;
+            for (uint8_t c = 0; c < 4; ++c)
+                dst.row(y)[x] |= BMP_BM::fromByte(p >> 8u * c & 0xFFu, masks[c]);
+        }
+    }
+
+    return out;
+}
+
+BMP_Separable::Axis BMP_Resize::weights(const int32_t &srcSize, const int32_t &dstSize, const Filter &filter) {
+    switch (filter) {
+        case Filter::box:
+            return BMP_Separable::resampling(srcSize, dstSize, [](double x) -> double {
+                return x >= -0.5 && x < 0.5;
+            }, 0.5);
+        case Filter::bicubic:
+            return BMP_Separable::resampling(srcSize, dstSize, [](double x) -> double {
+                const double a = -0.5;
+                x = std::fabs(x);
+                if (x < 1)
+                    return ((a + 2) * x - (a + 3)) * x * x + 1;
+                if (x < 2)
+                    return ((a * x - 5 * a) * x + 8 * a) * x - 4 * a;
+                return 0;
+            }, 2);
+        case Filter::lanczos3:
+            return BMP_Separable::resampling(srcSize, dstSize, [](double x) -> double {
+                return std::fabs(x) < 3 ? sinc(x) * sinc(x / 3) : 0;
+            }, 3);
+        default:
+            return BMP_Separable::resampling(srcSize, dstSize, [](double x) -> double {
+                return std::max(1 - std::fabs(x), 0.0);
+            }, 1);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef BMP_BMP_RESIZE_H
+#define BMP_BMP_RESIZE_H
+
+#include "bmp_8-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include "bmp_separable.h"
+#include <cstdint>
+
+/**
+ * @brief Resampling of images to new dimensions.
+ *
+ * Should not be constructed, it only groups static functions. Images are resampled with BMP_Separable, one horizontal
+ * and one vertical pass. The resized image keeps the row-order of the source.
+ *
+ * Every byte of a pixel is resampled as a separate channel: B, G, R for 24-bit images (without converting them to
+ * 32-bit first) and B, G, R, A for 32-bit images. 8-bit images keep their colour table. The colour index is resampled
+ * directly with the default grey colour table, otherwise the image is expanded to 24-bit, resized, then mapped back to
+ * the colour table with BMP_Quantize::remap() (the nearest entry, within a 32x32x32 colour cube). 32-bit images keep
+ * their bitmask, channels that are not whole bytes (e.g. RGB101010) are scaled to 8 bits to be resampled.
+ */
+class BMP_Resize {
+public:
+    BMP_Resize() = delete;
+
+    /// Resampling filter
+    enum class Filter {
+        box,      ///< Average of the source pixels covered by an output pixel, nearest neighbour when enlarging
+        bilinear, ///< Triangle filter, radius 1
+        bicubic,  ///< Cubic convolution (a = -0.5), radius 2
+        lanczos3  ///< Lanczos windowed sinc, radius 3
+    };
+
+    ///@{
+    /**
+     * @brief Resizes an image.
+     *
+     * When shrinking, the filter is stretched to cover every source pixel (no aliasing).
+     *
+     * @param n[in] Source image
+     * @param w[in] New width, positive only
+     * @param h[in] New height, positive only
+     * @param filter[in] Resampling filter
+     * @return The resized image
+     */
+    static BMP_8bit resize(const BMP_8bit &n, const int32_t &w, const int32_t &h, const Filter &filter = Filter::bilinear);
+
+    static BMP_24bit resize(const BMP_24bit &n, const int32_t &w, const int32_t &h,
+                            const Filter &filter = Filter::bilinear);
+
+    static BMP_32bit resize(const BMP_32bit &n, const int32_t &w, const int32_t &h,
+                            const Filter &filter = Filter::bilinear);
+    ///@}
+
+    /**
+     * @brief Weights of a filter for resampling an axis, see BMP_Separable::resampling().
+     *
+     * @param srcSize[in] Number of source pixels, 1 or more
+     * @param dstSize[in] Number of output pixels, 1 or more
+     * @param filter[in] Resampling filter
+     * @return The weights
+     */
+    static BMP_Separable::Axis weights(const int32_t &srcSize, const int32_t &dstSize, const Filter &filter);
+};
+
+#endif //BMP_BMP_RESIZE_H
@@ -0,0 +1,480 @@
+#include "bmp_separable.h"
+#include "bmp_parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+const uint8_t BMP_Separable::precision;
+
+/// Fractional bits of the horizontally filtered values, so that their 16 bits cover [-512, 512)
+static const uint8_t fraction = 6;
+
+/// Fractional bits of the vertical weights, fewer than precision so that 16-bit values times weights add up in 32 bits
+static const uint8_t verticalPrecision = 12;
+
+/// Shift from a horizontal sum to a filtered value, and from a vertical sum to an output value
+static const uint8_t horizontalShift = BMP_Separable::precision - fraction;
+static const uint8_t verticalShift = verticalPrecision + fraction;
+
+/// Added to a weighted sum before shifting it, to round to the nearest value
+static const int32_t horizontalHalf = 1 << (horizontalShift - 1), verticalHalf = 1 << (verticalShift - 1);
+
+/// Bytes of horizontally filtered rows kept per strip, to stay in the cache
+static const size_t stripBytes = 256 * 1024;
+
+/// Shifts a horizontal sum to a filtered value, saturating to 16 bits
+static inline int16_t filtered(const int32_t &sum) {
+    return static_cast<int16_t>(std::min(std::max(sum >> horizontalShift, -32768), 32767));
+}
+
+/// Shifts a vertical sum back to 8 bits, clamping to [0, 255]
+static inline uint8_t clamp(const int32_t &sum) {
+    return std::min(std::max(sum >> verticalShift, 0), 255);
+}
+
+#ifdef __SSE2__
+/// Packs a pair of weights into a 32-bit lane, the first one in the lower half
+static inline __m128i pair(const int16_t &first, const int16_t &second) {
+    const uint32_t packed = static_cast<uint16_t>(first) | static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16u;
+    return _mm_set1_epi32(static_cast<int32_t>(packed));
+}
+#endif
+
+#ifdef __SSSE3__
+/// Position in a vector of channel c of a pixel, -1 (a zero byte in a shuffle) if the pixel has no such channel
+static constexpr int8_t tapByte(const uint8_t channels, const uint8_t pixel, const uint8_t c) {
+    return static_cast<int8_t>(c < channels ? pixel * channels + c : -1);
+}
+
+/**
+ * @brief Shuffle taking two consecutive pixels of up to 4 channels to 16-bit lanes, each channel of the first pixel
+ * followed by the same channel of the second.
+ *
+ * @tparam first Position of the first pixel in the vector
+ */
+template<uint8_t channels, uint8_t first>
+static inline __m128i tapPair() {
+    return _mm_setr_epi8(tapByte(channels, first, 0), -1, tapByte(channels, first + 1, 0), -1,
+                         tapByte(channels, first, 1), -1, tapByte(channels, first + 1, 1), -1,
+                         tapByte(channels, first, 2), -1, tapByte(channels, first + 1, 2), -1,
+                         tapByte(channels, first, 3), -1, tapByte(channels, first + 1, 3), -1);
+}
+#endif
+
+/// Weights of the horizontal pass, laid out for filtering one output pixel with whole vectors
+struct Horizontal {
+    /**
+     * @param axis[in] Weights along the rows
+     * @param channels[in] Number of channels of a pixel
+     */
+    Horizontal(const BMP_Separable::Axis &axis, const uint8_t &channels);
+
+    const BMP_Separable::Axis &axis;
+
+    /// axis.taps rounded up to the number of taps read at a time, 8 for one channel and 4 otherwise
+    int32_t taps;
+
+    /// taps weights of each output position, those after the first axis.taps are 0
+    std::vector<int16_t> weights;
+
+    /// Output positions [begin, end) are filtered across pixels, see run(), the range is never empty
+    int32_t begin, end;
+
+    /// Number of source pixels that may be read, one past the last tap of every output position
+    int32_t limit;
+};
+
+/**
+ * @brief Finds the run of output positions around the middle whose taps start one source position after those of the
+ * position before and have the same weights, as in the interior of a convolution.
+ *
+ * @param axis[in] Weights
+ * @param begin[out] First position of the run
+ * @param end[out] One past the last position of the run
+ */
+static void run(const BMP_Separable::Axis &axis, int32_t &begin, int32_t &end) {
+    const int32_t middle = axis.start.size() / 2;
+    const auto same = [&axis, &middle](const int32_t &i) -> bool {
+        return axis.start[i] - axis.start[middle] == i - middle &&
+               std::equal(&axis.weights[static_cast<size_t>(i) * axis.taps],
+                          &axis.weights[static_cast<size_t>(i + 1) * axis.taps],
+                          &axis.weights[static_cast<size_t>(middle) * axis.taps]);
+    };
+
+    for (begin = middle; begin > 0 && same(begin - 1); --begin);
+    for (end = middle; end < static_cast<int32_t>(axis.start.size()) && same(end); ++end);
+}
+
+Horizontal::Horizontal(const BMP_Separable::Axis &axis, const uint8_t &channels)
+        : axis(axis), taps((axis.taps + (channels == 1 ? 7 : 3)) / (channels == 1 ? 8 : 4) * (channels == 1 ? 8 : 4)),
+          weights(axis.start.size() * taps), limit(0) {
+    for (size_t i = 0; i < axis.start.size(); ++i) {
+        std::copy(&axis.weights[i * axis.taps], &axis.weights[(i + 1) * axis.taps], &weights[i * taps]);
+        limit = std::max(limit, axis.start[i] + axis.taps);
+    }
+
+    run(axis, begin, end);
+}
+
+/**
+ * @brief Filters one output pixel along the row.
+ *
+ * @param p[in] First tap, taps * channels + 16 bytes can be read
+ * @param w[in] taps weights
+ * @param taps[in] Number of taps, a multiple of 8 for one channel and of 4 otherwise
+ * @param o[out] channels filtered values
+ */
+template<uint8_t channels>
+static inline void horizontalPixel(const uint8_t *p, const int16_t *w, const int32_t &taps, int16_t *o) {
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    if (channels == 1) {
+        // 8 taps at a time against 8 weights, then the 4 partial sums are added
+        __m128i sum = _mm_setzero_si128();
+        for (int32_t k = 0; k < taps; k += 8) {
+            const __m128i v = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p + k)), zero);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(v, _mm_loadu_si128(reinterpret_cast<const __m128i *>(w + k))));
+        }
+
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        *o = filtered(_mm_cvtsi128_si32(sum) + horizontalHalf);
+        return;
+    }
+
+    __m128i sum = _mm_set1_epi32(horizontalHalf);
+#ifdef __SSSE3__
+    // 4 taps at a time from one load, each pair of taps shuffled into the 16-bit lanes of a channel
+    const __m128i first = tapPair<channels, 0>(), second = tapPair<channels, 2>();
+    for (int32_t k = 0; k < taps; k += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + k * channels));
+        const __m128i weight = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(w + k));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_shuffle_epi8(v, first), _mm_shuffle_epi32(weight, 0x00)));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_shuffle_epi8(v, second), _mm_shuffle_epi32(weight, 0x55)));
+    }
+#else
+    // Two taps at a time, the channels of both pixels interleaved into 16-bit lanes
+    for (int32_t k = 0; k < taps; k += 2) {
+        uint32_t a = 0, b = 0;
+        std::memcpy(&a, p + k * channels, channels);
+        std::memcpy(&b, p + (k + 1) * channels, channels);
+
+        const __m128i v = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(a), _mm_cvtsi32_si128(b)), zero);
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(v, pair(w[k], w[k + 1])));
+    }
+#endif
+
+    int16_t values[4];
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(values), _mm_packs_epi32(_mm_srai_epi32(sum, horizontalShift), zero));
+    std::memcpy(o, values, channels * sizeof(int16_t));
+#else
+    for (uint8_t c = 0; c < channels; ++c) {
+        int32_t sum = horizontalHalf;
+        for (int32_t k = 0; k < taps; ++k)
+            sum += p[k * channels + c] * w[k];
+
+        o[c] = filtered(sum);
+    }
+#endif
+}
+
+/**
+ * @brief Filters the output positions of the run of a row, across pixels: every value of the run reads the same taps
+ * relative to its own position, so each byte of the output is the same sum of bytes channels apart.
+ */
+template<uint8_t channels>
+static void horizontalRun(const uint8_t *src, int16_t *dst, const Horizontal &h) {
+    const int32_t taps = h.axis.taps;
+    const int16_t *w = &h.weights[static_cast<size_t>(h.begin) * h.taps];
+
+    // Value j of the run reads src[j + offset + k * channels] for tap k
+    const ptrdiff_t offset = static_cast<ptrdiff_t>(h.axis.start[h.begin] - h.begin) * channels;
+    size_t j = static_cast<size_t>(h.begin) * channels;
+    const size_t last = static_cast<size_t>(h.end) * channels;
+
+#ifdef __SSE2__
+    // 16 values at a time, two taps at a time with their bytes interleaved into 16-bit lanes
+    const __m128i zero = _mm_setzero_si128();
+    for (; j + 16 <= last; j += 16) {
+        const uint8_t *p = src + (static_cast<ptrdiff_t>(j) + offset);
+        __m128i sum[4] = {_mm_set1_epi32(horizontalHalf), _mm_set1_epi32(horizontalHalf),
+                          _mm_set1_epi32(horizontalHalf), _mm_set1_epi32(horizontalHalf)};
+        for (int32_t k = 0; k < taps; k += 2) {
+            const bool second = k + 1 < taps;
+            const uint8_t *q = p + (second ? k + 1 : k) * channels;
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + k * channels));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(q));
+            const __m128i weight = pair(w[k], second ? w[k + 1] : 0);
+
+            const __m128i lo = _mm_unpacklo_epi8(a, b), hi = _mm_unpackhi_epi8(a, b);
+            sum[0] = _mm_add_epi32(sum[0], _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), weight));
+            sum[1] = _mm_add_epi32(sum[1], _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), weight));
+            sum[2] = _mm_add_epi32(sum[2], _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), weight));
+            sum[3] = _mm_add_epi32(sum[3], _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), weight));
+        }
+
+        for (__m128i &s : sum)
+            s = _mm_srai_epi32(s, horizontalShift);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + j), _mm_packs_epi32(sum[0], sum[1]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + j + 8), _mm_packs_epi32(sum[2], sum[3]));
+    }
+#endif
+
+    for (; j < last; ++j) {
+        const uint8_t *p = src + (static_cast<ptrdiff_t>(j) + offset);
+        int32_t sum = horizontalHalf;
+        for (int32_t k = 0; k < taps; ++k)
+            sum += p[k * channels] * w[k];
+
+        dst[j] = filtered(sum);
+    }
+}
+
+/// Filters a source row along the row
+template<uint8_t channels>
+static void horizontalRow(const uint8_t *src, int16_t *dst, const Horizontal &h, std::vector<uint8_t> &scratch) {
+    const size_t bytes = static_cast<size_t>(h.taps) * channels + 16;
+    const auto pixel = [&](const int32_t &i) -> void {
+        const uint8_t *p = src + static_cast<size_t>(h.axis.start[i]) * channels;
+
+        // Near the end of the row, the taps are copied before zeros so that whole vectors can be read
+        const size_t available = static_cast<size_t>(h.limit - h.axis.start[i]) * channels;
+        if (available < bytes) {
+            scratch.assign(bytes, 0);
+            std::memcpy(&scratch[0], p, available);
+            p = &scratch[0];
+        }
+
+        horizontalPixel<channels>(p, &h.weights[static_cast<size_t>(i) * h.taps], h.taps,
+                                  dst + static_cast<size_t>(i) * channels);
+    };
+
+    for (int32_t i = 0; i < h.begin; ++i)
+        pixel(i);
+
+    horizontalRun<channels>(src, dst, h);
+
+    for (int32_t i = h.end; i < static_cast<int32_t>(h.axis.start.size()); ++i)
+        pixel(i);
+}
+
+/// Combines taps filtered rows into an output row
+static void verticalRow(const std::vector<const int16_t *> &rows, const int16_t *w, uint8_t *dst, const size_t &n) {
+    // Rows with a weight of 0 at either end are skipped, as when enlarging
+    int32_t first = 0, taps = rows.size();
+    for (; taps > 1 && !w[taps - 1]; --taps);
+    for (; first + 1 < taps && !w[first]; ++first);
+
+    size_t x = 0;
+#ifdef __SSE2__
+    // 16 values at a time, two rows at a time with their values interleaved into pairs of 16-bit lanes
+    for (; x + 16 <= n; x += 16) {
+        __m128i sum[4] = {_mm_set1_epi32(verticalHalf), _mm_set1_epi32(verticalHalf), _mm_set1_epi32(verticalHalf),
+                          _mm_set1_epi32(verticalHalf)};
+        for (int32_t k = first; k < taps; k += 2) {
+            const bool second = k + 1 < taps;
+            const int16_t *a = rows[k] + x, *b = rows[second ? k + 1 : k] + x;
+            const __m128i weight = pair(w[k], second ? w[k + 1] : 0);
+
+            for (uint8_t half = 0; half < 2; ++half) {
+                const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + 8 * half));
+                const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + 8 * half));
+                __m128i &lo = sum[2 * half], &hi = sum[2 * half + 1];
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(va, vb), weight));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(va, vb), weight));
+            }
+        }
+
+        for (__m128i &s : sum)
+            s = _mm_srai_epi32(s, verticalShift);
+
+        const __m128i out = _mm_packus_epi16(_mm_packs_epi32(sum[0], sum[1]), _mm_packs_epi32(sum[2], sum[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), out);
+    }
+#endif
+
+    for (; x < n; ++x) {
+        int32_t sum = verticalHalf;
+        for (int32_t k = first; k < taps; ++k)
+            sum += rows[k][x] * w[k];
+
+        dst[x] = clamp(sum);
+    }
+}
+
+/// Rounds weights to fixed-point, the rounding error goes to the largest weight so that the sum is rounded only once
+static void toFixedPoint(const std::vector<double> &w, int16_t *out) {
+    const double one = 1 << BMP_Separable::precision;
+
+    double total = 0;
+    int32_t sum = 0, largest = 0;
+    for (size_t k = 0; k < w.size(); ++k) {
+        out[k] = static_cast<int16_t>(std::lround(w[k] * one));
+        total += w[k];
+        sum += out[k];
+        if (std::abs(out[k]) > std::abs(out[largest]))
+            largest = k;
+    }
+
+    out[largest] += std::lround(total * one) - sum;
+}
+
+BMP_Separable::Axis BMP_Separable::resampling(const int32_t &srcSize, const int32_t &dstSize,
+                                              const std::function<double(double)> &kernel, const double &radius) {
+    const double scale = static_cast<double>(srcSize) / dstSize;
+    const double stretch = std::max(scale, 1.0), support = radius * stretch;
+
+    Axis axis;
+    axis.taps = std::min<int32_t>(srcSize, static_cast<int32_t>(std::ceil(2 * support)) + 2);
+    axis.start.resize(dstSize);
+    axis.weights.resize(static_cast<size_t>(dstSize) * axis.taps);
+
+    std::vector<double> w(axis.taps);
+    for (int32_t i = 0; i < dstSize; ++i) {
+        const double centre = (i + 0.5) * scale - 0.5;
+        const int32_t lo = static_cast<int32_t>(std::floor(centre - support));
+        const int32_t hi = static_cast<int32_t>(std::ceil(centre + support));
+        const int32_t start = std::min(std::max(lo, 0), srcSize - axis.taps);
+
+        // Weights of positions outside the image go to the pixel at the edge
+        std::fill(w.begin(), w.end(), 0);
+        double total = 0;
+        for (int32_t j = lo; j <= hi; ++j) {
+            const double weight = kernel((j - centre) / stretch);
+            w[std::min(std::max(j, 0), srcSize - 1) - start] += weight;
+            total += weight;
+        }
+
+        if (total == 0) {
+            std::fill(w.begin(), w.end(), 0);
+            w[std::min(std::max(static_cast<int32_t>(std::lround(centre)), 0), srcSize - 1) - start] = total = 1;
+        }
+
+        for (double &weight : w)
+            weight /= total;
+
+        toFixedPoint(w, &axis.weights[static_cast<size_t>(i) * axis.taps]);
+        axis.start[i] = start;
+    }
+
+    return axis;
+}
+
+BMP_Separable::Axis BMP_Separable::convolution(const int32_t &size, const std::vector<double> &kernel) {
+    const int32_t centre = kernel.size() / 2;
+
+    Axis axis;
+    axis.taps = std::min<int32_t>(size, kernel.size());
+    axis.start.resize(size);
+    axis.weights.resize(static_cast<size_t>(size) * axis.taps);
+
+    std::vector<double> w(axis.taps);
+    for (int32_t i = 0; i < size; ++i) {
+        const int32_t lo = i - centre;
+        const int32_t start = std::min(std::max(lo, 0), size - axis.taps);
+
+        // Weights of positions outside the image go to the pixel at the edge
+        std::fill(w.begin(), w.end(), 0);
+        for (size_t k = 0; k < kernel.size(); ++k)
+            w[std::min(std::max<int32_t>(lo + k, 0), size - 1) - start] += kernel[k];
+
+        toFixedPoint(w, &axis.weights[static_cast<size_t>(i) * axis.taps]);
+        axis.start[i] = start;
+    }
+
+    return axis;
+}
+
+/// Rounds the weights of every output position of an axis to fewer fractional bits, keeping their sum rounded once
+static std::vector<int16_t> reduced(const BMP_Separable::Axis &axis, const uint8_t &bits) {
+    const uint8_t shift = BMP_Separable::precision - bits;
+    const int32_t round = 1 << (shift - 1);
+
+    std::vector<int16_t> out(axis.weights.size());
+    for (size_t i = 0; i < axis.start.size(); ++i) {
+        const int16_t *w = &axis.weights[i * axis.taps];
+        int16_t *o = &out[i * axis.taps];
+
+        int32_t total = 0, sum = 0, largest = 0;
+        for (int32_t k = 0; k < axis.taps; ++k) {
+            o[k] = static_cast<int16_t>((w[k] + round) >> shift);
+            total += w[k];
+            sum += o[k];
+            if (std::abs(o[k]) > std::abs(o[largest]))
+                largest = k;
+        }
+
+        o[largest] += ((total + round) >> shift) - sum;
+    }
+
+    return out;
+}
+
+void BMP_Separable::apply(const uint8_t *src, const ptrdiff_t &srcStride, uint8_t *dst, const ptrdiff_t &dstStride,
+                          const uint8_t &channels, const Axis &horizontal, const Axis &vertical) {
+    const int32_t dstH = vertical.start.size();
+    const size_t rowSize = horizontal.start.size() * channels; // Values of a filtered row
+    if (!dstH || !rowSize)
+        return;
+
+    const Horizontal h(horizontal, channels);
+    const std::vector<int16_t> verticalWeights = reduced(vertical, verticalPrecision);
+    void (*const filterRow)(const uint8_t *, int16_t *, const Horizontal &, std::vector<uint8_t> &) =
+            channels == 1 ? horizontalRow<1> : channels == 2 ? horizontalRow<2> :
+            channels == 3 ? horizontalRow<3> : horizontalRow<4>;
+
+    // Output rows per strip, so that the filtered source rows of a strip fit in stripBytes
+    const double srcRows = static_cast<double>(vertical.start.back() + vertical.taps - vertical.start.front()) / dstH;
+    const double fit = (static_cast<double>(stripBytes) / (rowSize * sizeof(int16_t)) - vertical.taps) /
+                       std::max(srcRows, 1.0);
+    const int32_t strip = std::max<int32_t>(1, static_cast<int32_t>(std::min<double>(fit, dstH)));
+
+    BMP_Parallel::forRows(0, dstH, [&](const int32_t &begin, const int32_t &end) -> void {
+        // Filtered source rows [first, last) of the current strip, rows shared with the previous strip are kept
+        std::vector<int16_t> buffer;
+        std::vector<const int16_t *> rows(vertical.taps);
+        std::vector<uint8_t> scratch;
+        int32_t first = 0, last = 0;
+
+        for (int32_t s = begin; s < end; s += strip) {
+            const int32_t e = std::min(end, s + strip);
+
+            int32_t lo = vertical.start[s], hi = vertical.start[s] + vertical.taps;
+            for (int32_t y = s + 1; y < e; ++y) {
+                lo = std::min(lo, vertical.start[y]);
+                hi = std::max(hi, vertical.start[y] + vertical.taps);
+            }
+
+            // Move the rows shared with the previous strip to the front, then filter the others
+            int32_t kept = 0;
+            if (lo >= first && lo < last) {
+                kept = std::min(last, hi) - lo;
+                std::memmove(&buffer[0], &buffer[(lo - first) * rowSize], kept * rowSize * sizeof(int16_t));
+            }
+
+            buffer.resize((hi - lo) * rowSize);
+            for (int32_t y = lo + kept; y < hi; ++y)
+                filterRow(src + y * srcStride, &buffer[(y - lo) * rowSize], h, scratch);
+
+            first = lo;
+            last = hi;
+
+            for (int32_t y = s; y < e; ++y) {
+                for (int32_t k = 0; k < vertical.taps; ++k)
+                    rows[k] = &buffer[(vertical.start[y] + k - first) * rowSize];
+
+                verticalRow(rows, &verticalWeights[static_cast<size_t>(y) * vertical.taps], dst + y * dstStride,
+                            rowSize);
+            }
+        }
+    }, 8);
+}
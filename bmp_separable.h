@@ -0,0 +1,89 @@
+#ifndef BMP_BMP_SEPARABLE_H
+#define BMP_BMP_SEPARABLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <functional>
+
+/**
+ * @brief Applies a separable filter (one set of weights per axis) to interleaved 8-bit channels.
+ *
+ * Should not be constructed, it only groups static functions. Each output pixel is a weighted sum of taps consecutive
+ * source pixels along an axis, the weights of every output position are computed once in fixed-point. Source pixels
+ * outside the image are clamped to the edge.
+ *
+ * The horizontal pass runs first and keeps its results as 16-bit rows with 6 fractional bits, so values from -512 to
+ * 512 survive and the overshoot of sharp kernels is only clamped once, when the vertical pass combines those rows into
+ * the output. Where every output pixel of a row uses the same weights (the interior of a convolution), the horizontal
+ * pass works across output pixels like the vertical pass; elsewhere it filters a pixel at a time, 4 taps of up to 4
+ * channels per load with SSSE3. Both passes use SSE2 when compiled with SSE2 enabled. Output rows are split into
+ * strips processed in parallel.
+ */
+class BMP_Separable {
+public:
+    BMP_Separable() = delete;
+
+    /// Number of fractional bits of the weights
+    static const uint8_t precision = 14;
+
+    /// Weights of one axis
+    struct Axis {
+        /// Number of weights of each output position
+        int32_t taps;
+
+        /// First source position of each output position, the taps source positions all lie inside the image
+        std::vector<int32_t> start;
+
+        /// taps weights of each output position, 1 is 1 << precision
+        std::vector<int16_t> weights;
+    };
+
+    /**
+     * @brief Weights for resampling an axis.
+     *
+     * Output position i is centred on source position (i + 0.5) * srcSize / dstSize - 0.5. When shrinking, the kernel
+     * is stretched by srcSize / dstSize so that every source pixel contributes.
+     *
+     * @param srcSize[in] Number of source pixels, 1 or more
+     * @param dstSize[in] Number of output pixels, 1 or more
+     * @param kernel[in] Weight of a source pixel at a distance from the centre, in source pixels before stretching
+     * @param radius[in] Distance from the centre beyond which the kernel is 0
+     * @return The weights
+     */
+    static Axis resampling(const int32_t &srcSize, const int32_t &dstSize, const std::function<double(double)> &kernel,
+                           const double &radius);
+
+    /**
+     * @brief Weights for convolving an axis with a kernel, the output has the same size as the source.
+     *
+     * The kernel is centred on its middle element (the one after the middle for an even number of elements). Its
+     * elements are rounded to fixed-point as they are, so kernels that should not change the brightness must add up
+     * to 1, and every element must be in (-2, 2).
+     *
+     * @param size[in] Number of pixels, 1 or more
+     * @param kernel[in] Weights, 1 or more
+     * @return The weights
+     */
+    static Axis convolution(const int32_t &size, const std::vector<double> &kernel);
+
+    /**
+     * @brief Filters an image.
+     *
+     * The output is horizontal.start.size() by vertical.start.size() pixels. The result of the horizontal pass is
+     * clamped to [-512, 512) and the output to [0, 255]. The vertical weights are rounded to 12 fractional bits, the
+     * absolute values of the weights of each output position must add up to less than 16.
+     *
+     * @param src[in] First row of the source
+     * @param srcStride[in] Distance in bytes between the starts of two source rows, may be negative
+     * @param dst[out] First row of the output
+     * @param dstStride[in] Distance in bytes between the starts of two output rows, may be negative
+     * @param channels[in] Number of interleaved 8-bit channels of a pixel, from 1 to 4
+     * @param horizontal[in] Weights along the rows
+     * @param vertical[in] Weights along the columns
+     */
+    static void apply(const uint8_t *src, const ptrdiff_t &srcStride, uint8_t *dst, const ptrdiff_t &dstStride,
+                      const uint8_t &channels, const Axis &horizontal, const Axis &vertical);
+};
+
+#endif //BMP_BMP_SEPARABLE_H
@@ -0,0 +1,319 @@
+#include "bmp_tensor.h"
+#include "bmp_parallel.h"
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <functional>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const BMP_Tensor::Normalisation BMP_Tensor::unit = {{0, 0, 0}, {1, 1, 1}};
+
+const BMP_Tensor::Normalisation BMP_Tensor::imagenet = {{0.485f, 0.456f, 0.406f}, {0.229f, 0.224f, 0.225f}};
+
+namespace {
+    /// Rows of colour indices, looked up in the palette
+    struct IndexRows {
+        BMP_8bit::ConstView view;
+        uint8_t table[256][3]; // B, G, R bytes of each index
+
+        /// Row y as B, G, R bytes, in buf or in the image
+        const uint8_t *operator()(const int32_t &y, uint8_t *buf) const {
+            const uint8_t *src = view.row(y);
+            for (int32_t x = 0; x < view.width(); ++x)
+                std::memcpy(buf + 3 * x, table[src[x]], 3);
+
+            return buf;
+        }
+    };
+
+    /// Rows of pixels with bit masks, each channel scaled to 8 bits
+    template<typename Pixel>
+    struct MaskRows {
+        BMP_ConstView<Pixel> view;
+        uint32_t masks[3], shifts[3]; // Blue, green, red
+
+        /// 8-bit value of each value of a channel, empty if the channel is wider than 16 bits
+        std::vector<uint8_t> tables[3];
+
+        const uint8_t *operator()(const int32_t &y, uint8_t *buf) const {
+            const Pixel *src = view.row(y);
+            for (int32_t x = 0; x < view.width(); ++x) {
+                for (uint8_t c = 0; c < 3; ++c) {
+                    buf[3 * x + c] = tables[c].empty() ? BMP_BM::toByte(src[x], masks[c])
+                                                       : tables[c][(src[x] & masks[c]) >> shifts[c]];
+                }
+            }
+
+            return buf;
+        }
+    };
+
+    /// Rows of 24-bit pixels, interleaved from the planes with the planar storage
+    struct RGBRows {
+        BMP_24bit::ConstView view;
+        BMP_24bit::ConstPlaneView planes[3];
+        bool planar;
+
+        const uint8_t *operator()(const int32_t &y, uint8_t *buf) const {
+            if (!planar)
+                return view.bytes(y);
+
+            BMP_24bit::interleave(planes[0].row(y), planes[1].row(y), planes[2].row(y), buf, planes[0].width());
+            return buf;
+        }
+    };
+}
+
+///@{
+/// Rows of an image as B, G, R bytes
+static IndexRows rowsOf(const BMP_8bit &n) {
+    IndexRows out;
+    out.view = n.view();
+    for (uint16_t i = 0; i < 256; ++i) {
+        const uint32_t c = n.getPalette()[i];
+        out.table[i][0] = c & 0xFFu;
+        out.table[i][1] = c >> 8u & 0xFFu;
+        out.table[i][2] = c >> 16u & 0xFFu;
+    }
+
+    return out;
+}
+
+template<typename Image>
+static MaskRows<typename Image::Pixel> maskRows(const Image &n) {
+    const std::vector<uint32_t> masks = n.getPixelMasks(); // Red, green, blue
+
+    MaskRows<typename Image::Pixel> out;
+    out.view = n.view();
+    for (uint8_t c = 0; c < 3; ++c) {
+        out.masks[c] = masks[2 - c];
+        out.shifts[c] = out.masks[c] ? __builtin_ctz(out.masks[c]) : 0;
+
+        // An empty channel is always 0
+        const uint32_t max = out.masks[c] >> out.shifts[c];
+        if (max <= 0xFFFFu) {
+            out.tables[c].resize(max + 1);
+            for (uint32_t v = 1; v <= max; ++v)
+                out.tables[c][v] = BMP_BM::toByte(v << out.shifts[c], out.masks[c]);
+        }
+    }
+
+    return out;
+}
+
+static MaskRows<uint16_t> rowsOf(const BMP_16bit &n) {
+    return maskRows(n);
+}
+
+static MaskRows<uint32_t> rowsOf(const BMP_32bit &n) {
+    return maskRows(n);
+}
+
+static RGBRows rowsOf(const BMP_24bit &n) {
+    RGBRows out;
+    out.planar = n.getStorage() == BMP_24bit::Storage::planar;
+    if (out.planar) {
+        out.planes[0] = n.plane(BMP_24bit::Channel::blue);
+        out.planes[1] = n.plane(BMP_24bit::Channel::green);
+        out.planes[2] = n.plane(BMP_24bit::Channel::red);
+    } else {
+        out.view = n.view();
+    }
+
+    return out;
+}
+///@}
+
+/// Exits if the image or the dimensions of the tensor are empty
+static void assertInvalidDimensions(const BMP &n, const int32_t &w, const int32_t &h) {
+    if (w <= 0 || h <= 0 || n.getInfoHeader().biWidth <= 0 || n.getInfoHeader().biHeight == 0) {
+        std::cerr << "BMP_Tensor: Invalid dimensions." << std::endl;
+        std::exit(1);
+    }
+}
+
+/**
+ * @brief Calls out with every row of the tensor as B, G, R bytes, in parallel.
+ *
+ * Without resizing, each row is expanded when it is written. Otherwise the whole image is expanded first, then
+ * resampled.
+ *
+ * @param n[in] Image
+ * @param w[in] Width of the tensor
+ * @param h[in] Height of the tensor
+ * @param filter[in] Resampling filter
+ * @param out[in] Called with the row number, the row and a buffer of 6 * w bytes for the calling thread
+ */
+template<typename Image>
+static void forEachRow(const Image &n, const int32_t &w, const int32_t &h, const BMP_Resize::Filter &filter,
+                       const std::function<void(const int32_t &, const uint8_t *, uint8_t *)> &out) {
+    const auto rows = rowsOf(n);
+    const int32_t srcW = n.getInfoHeader().biWidth, srcH = std::abs(n.getInfoHeader().biHeight);
+
+    if (w == srcW && h == srcH) {
+        BMP_Parallel::forRows(0, h, [&](const int32_t &begin, const int32_t &end) {
+            std::vector<uint8_t> buf(6 * static_cast<size_t>(w)), row(3 * static_cast<size_t>(w));
+            for (int32_t y = begin; y < end; ++y)
+                out(y, rows(y, row.data()), buf.data());
+        });
+        return;
+    }
+
+    std::vector<uint8_t> src(3 * static_cast<size_t>(srcW) * srcH), resized(3 * static_cast<size_t>(w) * h);
+    BMP_Parallel::forRows(0, srcH, [&](const int32_t &begin, const int32_t &end) {
+        for (int32_t y = begin; y < end; ++y) {
+            uint8_t *dst = &src[3 * static_cast<size_t>(y) * srcW];
+            const uint8_t *row = rows(y, dst);
+            if (row != dst)
+                std::memcpy(dst, row, 3 * static_cast<size_t>(srcW));
+        }
+    });
+
+    BMP_Separable::apply(src.data(), 3 * srcW, resized.data(), 3 * w, 3, BMP_Resize::weights(srcW, w, filter),
+                         BMP_Resize::weights(srcH, h, filter));
+
+    BMP_Parallel::forRows(0, h, [&](const int32_t &begin, const int32_t &end) {
+        std::vector<uint8_t> buf(6 * static_cast<size_t>(w));
+        for (int32_t y = begin; y < end; ++y)
+            out(y, &resized[3 * static_cast<size_t>(y) * w], buf.data());
+    });
+}
+
+/**
+ * @brief Splits a row of B, G, R bytes into a plane of each channel, in the order of the tensor.
+ *
+ * @param src[in] w pixels
+ * @param planes[out] The 3 planes of w bytes
+ * @param w[in] Number of pixels
+ * @param order[in] Order of the channels
+ */
+static void split(const uint8_t *src, uint8_t *const planes[3], const int32_t &w, const BMP_Tensor::Order &order) {
+    if (order == BMP_Tensor::Order::rgb)
+        BMP_24bit::deinterleave(src, planes[2], planes[1], planes[0], w);
+    else
+        BMP_24bit::deinterleave(src, planes[0], planes[1], planes[2], w);
+}
+
+/**
+ * @brief Converts bytes to floats, byte i becomes src[i] * scale[i % 3] + offset[i % 3].
+ *
+ * @param src[in] n bytes
+ * @param dst[out] n floats
+ * @param n[in] Number of bytes
+ * @param scale[in] Factors
+ * @param offset[in] Offsets
+ */
+static void convert(const uint8_t *src, float *dst, const size_t &n, const float scale[3], const float offset[3]) {
+    size_t i = 0;
+#ifdef __SSE2__
+    // Floats 4j to 4j + 3 start from channel j % 3, as 4 = 1 (mod 3)
+    __m128 s[3], o[3];
+    for (uint8_t j = 0; j < 3; ++j) {
+        s[j] = _mm_setr_ps(scale[j], scale[(j + 1) % 3], scale[(j + 2) % 3], scale[j]);
+        o[j] = _mm_setr_ps(offset[j], offset[(j + 1) % 3], offset[(j + 2) % 3], offset[j]);
+    }
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 48 <= n; i += 48) {
+        for (uint8_t k = 0; k < 3; ++k) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 16 * k));
+            const __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+            const __m128i q[4] = {_mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                                  _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)};
+
+            for (uint8_t j = 0; j < 4; ++j) {
+                const uint8_t p = (4 * k + j) % 3;
+                const __m128 f = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(q[j]), s[p]), o[p]);
+                _mm_storeu_ps(dst + i + 16 * k + 4 * j, f);
+            }
+        }
+    }
+#endif
+
+    for (; i < n; ++i)
+        dst[i] = src[i] * scale[i % 3] + offset[i % 3];
+}
+
+template<typename Image>
+void BMP_Tensor::toFloat(const Image &n, float *dst, const Normalisation &normalisation, const Layout &layout,
+                         const Order &order) {
+    toFloat(n, n.getInfoHeader().biWidth, std::abs(n.getInfoHeader().biHeight), dst, normalisation, layout, order);
+}
+
+template<typename Image>
+void BMP_Tensor::toFloat(const Image &n, const int32_t &w, const int32_t &h, float *dst,
+                         const Normalisation &normalisation, const Layout &layout, const Order &order,
+                         const BMP_Resize::Filter &filter) {
+    assertInvalidDimensions(n, w, h);
+
+    // (byte / 255 - mean) / deviation as one multiply-add
+    float scale[3], offset[3];
+    for (uint8_t c = 0; c < 3; ++c) {
+        scale[c] = 1 / (255 * normalisation.deviation[c]);
+        offset[c] = -normalisation.mean[c] / normalisation.deviation[c];
+    }
+
+    const size_t plane = static_cast<size_t>(w) * h;
+    forEachRow(n, w, h, filter, [&](const int32_t &y, const uint8_t *row, uint8_t *buf) {
+        if (layout == Layout::nhwc && order == Order::bgr) {
+            convert(row, dst + 3 * y * static_cast<size_t>(w), 3 * static_cast<size_t>(w), scale, offset);
+            return;
+        }
+
+        uint8_t *const planes[3] = {buf + 3 * w, buf + 4 * w, buf + 5 * w};
+        split(row, planes, w, order);
+
+        if (layout == Layout::nchw) {
+            for (uint8_t c = 0; c < 3; ++c) {
+                const float s[3] = {scale[c], scale[c], scale[c]}, o[3] = {offset[c], offset[c], offset[c]};
+                convert(planes[c], dst + c * plane + y * static_cast<size_t>(w), w, s, o);
+            }
+        } else {
+            BMP_24bit::interleave(planes[0], planes[1], planes[2], buf, w);
+            convert(buf, dst + 3 * y * static_cast<size_t>(w), 3 * static_cast<size_t>(w), scale, offset);
+        }
+    });
+}
+
+template<typename Image>
+void BMP_Tensor::toBytes(const Image &n, uint8_t *dst, const Layout &layout, const Order &order) {
+    toBytes(n, n.getInfoHeader().biWidth, std::abs(n.getInfoHeader().biHeight), dst, layout, order);
+}
+
+template<typename Image>
+void BMP_Tensor::toBytes(const Image &n, const int32_t &w, const int32_t &h, uint8_t *dst, const Layout &layout,
+                         const Order &order, const BMP_Resize::Filter &filter) {
+    assertInvalidDimensions(n, w, h);
+
+    const size_t plane = static_cast<size_t>(w) * h;
+    forEachRow(n, w, h, filter, [&](const int32_t &y, const uint8_t *row, uint8_t *buf) {
+        if (layout == Layout::nchw) {
+            uint8_t *const planes[3] = {dst + y * static_cast<size_t>(w), dst + plane + y * static_cast<size_t>(w),
+                                        dst + 2 * plane + y * static_cast<size_t>(w)};
+            split(row, planes, w, order);
+        } else if (order == Order::bgr) {
+            std::memcpy(dst + 3 * y * static_cast<size_t>(w), row, 3 * static_cast<size_t>(w));
+        } else {
+            uint8_t *const planes[3] = {buf, buf + w, buf + 2 * w};
+            split(row, planes, w, order);
+            BMP_24bit::interleave(planes[0], planes[1], planes[2], dst + 3 * y * static_cast<size_t>(w), w);
+        }
+    });
+}
+
+#define BMP_TENSOR_INSTANTIATE(Image) \
+    template void BMP_Tensor::toFloat(const Image &, float *, const Normalisation &, const Layout &, const Order &); \
+    template void BMP_Tensor::toFloat(const Image &, const int32_t &, const int32_t &, float *, const Normalisation &, \
+                                      const Layout &, const Order &, const BMP_Resize::Filter &); \
+    template void BMP_Tensor::toBytes(const Image &, uint8_t *, const Layout &, const Order &); \
+    template void BMP_Tensor::toBytes(const Image &, const int32_t &, const int32_t &, uint8_t *, const Layout &, \
+                                      const Order &, const BMP_Resize::Filter &);
+
+BMP_TENSOR_INSTANTIATE(BMP_8bit)
+BMP_TENSOR_INSTANTIATE(BMP_16bit)
+BMP_TENSOR_INSTANTIATE(BMP_24bit)
+BMP_TENSOR_INSTANTIATE(BMP_32bit)
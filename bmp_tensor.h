@@ -0,0 +1,96 @@
+#ifndef BMP_BMP_TENSOR_H
+#define BMP_BMP_TENSOR_H
+
+#include "bmp_16-bit.h"
+#include "bmp_resize.h"
+#include <cstdint>
+
+/**
+ * @brief Export of images to tensors (e.g. the input of a neural network).
+ *
+ * Should not be constructed, it only groups static functions. Every image becomes 3 channels of 8-bit colour first:
+ * colour indices through the palette, masked channels scaled to 8 bits, 24-bit pixels as they are. The image can be
+ * resized at the same time with BMP_Resize's filters, its 8-bit colours are then resampled before being written.
+ *
+ * Channels are split and reordered with SSSE3 shuffles and converted to float with SSE2 when compiled with those
+ * enabled, and rows are written in parallel. Row y of a tensor is row y of the image from the top, whatever its
+ * row-order.
+ *
+ * Every function is available for BMP_8bit, BMP_16bit, BMP_24bit (either storage) and BMP_32bit.
+ */
+class BMP_Tensor {
+public:
+    BMP_Tensor() = delete;
+
+    /// Order of the dimensions of a tensor
+    enum class Layout {
+        nchw, ///< Every channel is a plane of height rows of width values
+        nhwc  ///< Rows of width pixels of 3 values each
+    };
+
+    /// Order of the channels
+    enum class Order {
+        rgb, ///< Red, green, blue
+        bgr  ///< Blue, green, red, as in the file
+    };
+
+    /// Normalisation of float values, value = (byte / 255 - mean) / deviation
+    struct Normalisation {
+        float mean[3];      ///< Mean of each channel in [0, 1], in the order the channels are written
+        float deviation[3]; ///< Standard deviation of each channel in [0, 1], in the order the channels are written
+    };
+
+    /// Values in [0, 1]
+    static const Normalisation unit;
+
+    /// Mean and standard deviation of the ImageNet training set, for RGB order
+    static const Normalisation imagenet;
+
+    ///@{
+    /**
+     * @brief Writes an image as 3 normalised float channels.
+     *
+     * @param n[in] Image
+     * @param dst[out] 3 * w * h floats, w and h being the dimensions of the image unless given
+     * @param w[in] Width of the tensor, the image is resized if it is not the width of the image
+     * @param h[in] Height of the tensor, the image is resized if it is not the height of the image
+     * @param normalisation[in] Mean and standard deviation of each channel
+     * @param layout[in] Order of the dimensions
+     * @param order[in] Order of the channels
+     * @param filter[in] Resampling filter, when resizing
+     */
+    template<typename Image>
+    static void toFloat(const Image &n, float *dst, const Normalisation &normalisation = unit,
+                        const Layout &layout = Layout::nchw, const Order &order = Order::rgb);
+
+    template<typename Image>
+    static void toFloat(const Image &n, const int32_t &w, const int32_t &h, float *dst,
+                        const Normalisation &normalisation = unit, const Layout &layout = Layout::nchw,
+                        const Order &order = Order::rgb,
+                        const BMP_Resize::Filter &filter = BMP_Resize::Filter::bilinear);
+    ///@}
+
+    ///@{
+    /**
+     * @brief Writes an image as 3 channels of bytes.
+     *
+     * @param n[in] Image
+     * @param dst[out] 3 * w * h bytes, w and h being the dimensions of the image unless given
+     * @param w[in] Width of the tensor, the image is resized if it is not the width of the image
+     * @param h[in] Height of the tensor, the image is resized if it is not the height of the image
+     * @param layout[in] Order of the dimensions
+     * @param order[in] Order of the channels
+     * @param filter[in] Resampling filter, when resizing
+     */
+    template<typename Image>
+    static void toBytes(const Image &n, uint8_t *dst, const Layout &layout = Layout::nchw,
+                        const Order &order = Order::rgb);
+
+    template<typename Image>
+    static void toBytes(const Image &n, const int32_t &w, const int32_t &h, uint8_t *dst,
+                        const Layout &layout = Layout::nchw, const Order &order = Order::rgb,
+                        const BMP_Resize::Filter &filter = BMP_Resize::Filter::bilinear);
+    ///@}
+};
+
+#endif //BMP_BMP_TENSOR_H
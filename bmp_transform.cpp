@@ -0,0 +1,293 @@
+#include "bmp_transform.h"
+#include "bmp_parallel.h"
+#include "bmp_interleaved.h"
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// Side of the square tiles transposed at once, in pixels
+static const int32_t tile = 64;
+
+///@{
+/// An image with the colour table or bitmask of n, w by h with the row-order of n
+static BMP_1bit blank(const BMP_1bit &n, const int32_t &w, const int32_t &h) {
+    BMP_1bit out(w, n.getInfoHeader().biHeight < 0 ? -h : h);
+    out.setColourTable(n.getColourTable());
+    return out;
+}
+
+static BMP_8bit blank(const BMP_8bit &n, const int32_t &w, const int32_t &h) {
+    BMP_8bit out(w, n.getInfoHeader().biHeight < 0 ? -h : h);
+    out.setColourTable(n.getColourTable());
+    return out;
+}
+
+static BMP_16bit blank(const BMP_16bit &n, const int32_t &w, const int32_t &h) {
+    return BMP_16bit(w, n.getInfoHeader().biHeight < 0 ? -h : h, 0, n.getBitmask());
+}
+
+static BMP_24bit blank(const BMP_24bit &n, const int32_t &w, const int32_t &h) {
+    return BMP_24bit(w, n.getInfoHeader().biHeight < 0 ? -h : h);
+}
+
+static BMP_32bit blank(const BMP_32bit &n, const int32_t &w, const int32_t &h) {
+    return BMP_32bit(w, n.getInfoHeader().biHeight < 0 ? -h : h, 0, n.getBitmask());
+}
+///@}
+
+/// Pointer to the pixel y rows below p, where rows are stride bytes apart
+template<typename Pixel>
+static inline Pixel *at(Pixel *p, const ptrdiff_t &stride, const int32_t &y) {
+    typedef typename std::conditional<std::is_const<Pixel>::value, const uint8_t, uint8_t>::type Byte;
+
+    return reinterpret_cast<Pixel *>(reinterpret_cast<Byte *>(p) + y * stride);
+}
+
+/**
+ * @brief Transposes a block of size by size pixels, dst(x, y) = src(y, x).
+ *
+ * The generic version does a single pixel, the SSE2 versions do larger blocks.
+ */
+template<typename Pixel>
+struct Block {
+    static const int32_t size = 1;
+
+    static void transpose(const Pixel *src, const ptrdiff_t &, Pixel *dst, const ptrdiff_t &) {
+        *dst = *src;
+    }
+};
+
+#ifdef __SSE2__
+template<>
+struct Block<uint8_t> {
+    static const int32_t size = 8;
+
+    static void transpose(const uint8_t *src, const ptrdiff_t &srcStride, uint8_t *dst, const ptrdiff_t &dstStride) {
+        __m128i r[8];
+        for (int32_t i = 0; i < 8; ++i)
+            r[i] = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(at(src, srcStride, i)));
+
+        // Interleave pairs of rows, then pairs of pairs, until every 64 bits hold a column
+        const __m128i t0 = _mm_unpacklo_epi8(r[0], r[1]), t1 = _mm_unpacklo_epi8(r[2], r[3]);
+        const __m128i t2 = _mm_unpacklo_epi8(r[4], r[5]), t3 = _mm_unpacklo_epi8(r[6], r[7]);
+        const __m128i u0 = _mm_unpacklo_epi16(t0, t1), u1 = _mm_unpackhi_epi16(t0, t1);
+        const __m128i u2 = _mm_unpacklo_epi16(t2, t3), u3 = _mm_unpackhi_epi16(t2, t3);
+        const __m128i c[4] = {_mm_unpacklo_epi32(u0, u2), _mm_unpackhi_epi32(u0, u2),
+                              _mm_unpacklo_epi32(u1, u3), _mm_unpackhi_epi32(u1, u3)};
+
+        for (int32_t i = 0; i < 4; ++i) {
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(at(dst, dstStride, 2 * i)), c[i]);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(at(dst, dstStride, 2 * i + 1)), _mm_unpackhi_epi64(c[i], c[i]));
+        }
+    }
+};
+
+template<>
+struct Block<uint16_t> {
+    static const int32_t size = 8;
+
+    static void transpose(const uint16_t *src, const ptrdiff_t &srcStride, uint16_t *dst, const ptrdiff_t &dstStride) {
+        __m128i r[8], t[8], u[8];
+        for (int32_t i = 0; i < 8; ++i)
+            r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(at(src, srcStride, i)));
+
+        for (int32_t i = 0; i < 4; ++i) {
+            t[2 * i] = _mm_unpacklo_epi16(r[2 * i], r[2 * i + 1]);
+            t[2 * i + 1] = _mm_unpackhi_epi16(r[2 * i], r[2 * i + 1]);
+        }
+
+        for (int32_t i = 0; i < 2; ++i) {
+            u[4 * i] = _mm_unpacklo_epi32(t[4 * i], t[4 * i + 2]);
+            u[4 * i + 1] = _mm_unpackhi_epi32(t[4 * i], t[4 * i + 2]);
+            u[4 * i + 2] = _mm_unpacklo_epi32(t[4 * i + 1], t[4 * i + 3]);
+            u[4 * i + 3] = _mm_unpackhi_epi32(t[4 * i + 1], t[4 * i + 3]);
+        }
+
+        for (int32_t i = 0; i < 4; ++i) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(at(dst, dstStride, 2 * i)), _mm_unpacklo_epi64(u[i], u[i + 4]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(at(dst, dstStride, 2 * i + 1)),
+                             _mm_unpackhi_epi64(u[i], u[i + 4]));
+        }
+    }
+};
+
+template<>
+struct Block<uint32_t> {
+    static const int32_t size = 4;
+
+    static void transpose(const uint32_t *src, const ptrdiff_t &srcStride, uint32_t *dst, const ptrdiff_t &dstStride) {
+        __m128i r[4];
+        for (int32_t i = 0; i < 4; ++i)
+            r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(at(src, srcStride, i)));
+
+        const __m128i t0 = _mm_unpacklo_epi32(r[0], r[1]), t1 = _mm_unpacklo_epi32(r[2], r[3]);
+        const __m128i t2 = _mm_unpackhi_epi32(r[0], r[1]), t3 = _mm_unpackhi_epi32(r[2], r[3]);
+        const __m128i c[4] = {_mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1),
+                              _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3)};
+
+        for (int32_t i = 0; i < 4; ++i)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(at(dst, dstStride, i)), c[i]);
+    }
+};
+#endif
+
+/// dst(x, y) = src(y, x), tile by tile, the height of dst is the width of src
+template<typename Pixel>
+static void transpose(const BMP_ConstView<Pixel> &src, const BMP_View<Pixel> &dst) {
+    const int32_t b = Block<Pixel>::size;
+
+    BMP_Parallel::forRows(0, (dst.height() + tile - 1) / tile, [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y0 = begin * tile; y0 < std::min(dst.height(), end * tile); y0 += tile) {
+            const int32_t y1 = std::min(dst.height(), y0 + tile);
+
+            for (int32_t x0 = 0; x0 < dst.width(); x0 += tile) {
+                const int32_t x1 = std::min(dst.width(), x0 + tile);
+
+                // Whole blocks, then the pixels left on the right and bottom edges of the tile
+                int32_t y = y0;
+                for (; y + b <= y1; y += b) {
+                    int32_t x = x0;
+                    for (; x + b <= x1; x += b)
+                        Block<Pixel>::transpose(src.row(x) + y, src.stride(), dst.row(y) + x, dst.stride());
+
+                    for (; x < x1; ++x) {
+                        for (int32_t i = y; i < y + b; ++i)
+                            dst.row(i)[x] = src.row(x)[i];
+                    }
+                }
+
+                for (; y < y1; ++y) {
+                    for (int32_t x = x0; x < x1; ++x)
+                        dst.row(y)[x] = src.row(x)[y];
+                }
+            }
+        }
+    }, 1);
+}
+
+///@{
+/// dst[i] = src[n - 1 - i], SSE2 versions reverse a register at a time
+template<typename Pixel>
+static void reverse(const Pixel *src, Pixel *dst, const int32_t &n) {
+    for (int32_t i = 0; i < n; ++i)
+        dst[i] = src[n - 1 - i];
+}
+
+#ifdef __SSE2__
+template<>
+void reverse(const uint8_t *src, uint8_t *dst, const int32_t &n) {
+    int32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + n - i - 16));
+        v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+    }
+
+    for (; i < n; ++i)
+        dst[i] = src[n - 1 - i];
+}
+
+template<>
+void reverse(const uint16_t *src, uint16_t *dst, const int32_t &n) {
+    int32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + n - i - 8));
+        v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+    }
+
+    for (; i < n; ++i)
+        dst[i] = src[n - 1 - i];
+}
+
+template<>
+void reverse(const uint32_t *src, uint32_t *dst, const int32_t &n) {
+    int32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + n - i - 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+
+    for (; i < n; ++i)
+        dst[i] = src[n - 1 - i];
+}
+#endif
+///@}
+
+/// Mirrors every row of src into dst
+template<typename Pixel>
+static void mirror(const BMP_ConstView<Pixel> &src, const BMP_View<Pixel> &dst) {
+    BMP_Parallel::forRows(0, dst.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y)
+            reverse(src.row(y), dst.row(y), dst.width());
+    });
+}
+
+template<typename Image>
+Image BMP_Transform::rotate90(const Image &n) {
+    const BMP_Interleaved<Image> interleaved(n);
+    Image out = blank(n, std::abs(n.getInfoHeader().biHeight), n.getInfoHeader().biWidth);
+    transpose(interleaved->view().flipped(), out.view());
+    return out;
+}
+
+template<typename Image>
+Image BMP_Transform::rotate180(const Image &n) {
+    const BMP_Interleaved<Image> interleaved(n);
+    Image out = blank(n, n.getInfoHeader().biWidth, std::abs(n.getInfoHeader().biHeight));
+    mirror(interleaved->view().flipped(), out.view());
+    return out;
+}
+
+template<typename Image>
+Image BMP_Transform::rotate270(const Image &n) {
+    const BMP_Interleaved<Image> interleaved(n);
+    Image out = blank(n, std::abs(n.getInfoHeader().biHeight), n.getInfoHeader().biWidth);
+    transpose(interleaved->view(), out.view().flipped());
+    return out;
+}
+
+template<typename Image>
+Image BMP_Transform::mirrorHorizontal(const Image &n) {
+    const BMP_Interleaved<Image> interleaved(n);
+    Image out = blank(n, n.getInfoHeader().biWidth, std::abs(n.getInfoHeader().biHeight));
+    mirror(interleaved->view(), out.view());
+    return out;
+}
+
+template<typename Image>
+Image BMP_Transform::mirrorVertical(const Image &n) {
+    Image out = blank(n, n.getInfoHeader().biWidth, std::abs(n.getInfoHeader().biHeight));
+    const BMP_Interleaved<Image> interleaved(n);
+    const typename Image::ConstView src = interleaved->view().flipped();
+    const typename Image::View dst = out.view();
+
+    BMP_Parallel::forRows(0, dst.height(), [&](const int32_t &begin, const int32_t &end) -> void {
+        for (int32_t y = begin; y < end; ++y)
+            std::memcpy(dst.row(y), src.row(y), dst.width() * sizeof(typename Image::Pixel));
+    });
+
+    return out;
+}
+
+/// Instantiates every function for an image class
+#define BMP_TRANSFORM_INSTANTIATE(Image) \
+    template Image BMP_Transform::rotate90(const Image &); \
+    template Image BMP_Transform::rotate180(const Image &); \
+    template Image BMP_Transform::rotate270(const Image &); \
+    template Image BMP_Transform::mirrorHorizontal(const Image &); \
+    template Image BMP_Transform::mirrorVertical(const Image &);
+
+BMP_TRANSFORM_INSTANTIATE(BMP_1bit)
+BMP_TRANSFORM_INSTANTIATE(BMP_8bit)
+BMP_TRANSFORM_INSTANTIATE(BMP_16bit)
+BMP_TRANSFORM_INSTANTIATE(BMP_24bit)
+BMP_TRANSFORM_INSTANTIATE(BMP_32bit)
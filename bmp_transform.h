@@ -0,0 +1,73 @@
+#ifndef BMP_BMP_TRANSFORM_H
+#define BMP_BMP_TRANSFORM_H
+
+#include "bmp_1-bit.h"
+#include "bmp_8-bit.h"
+#include "bmp_16-bit.h"
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+
+/**
+ * @brief Rotations by multiples of 90 degrees and mirroring.
+ *
+ * Should not be constructed, it only groups static functions. Each function is available for BMP_1bit, BMP_8bit,
+ * BMP_16bit, BMP_24bit and BMP_32bit. The transformed image keeps the row-order and the colour table or bitmask of the
+ * source.
+ *
+ * Rotations by 90 and 270 degrees transpose the pixels in square tiles that fit in the cache, with SSE2 block
+ * transposes for 8-bit, 16-bit and 32-bit pixels when compiled with SSE2 enabled. Rows are mirrored with SSE2 shuffles.
+ * Every function processes rows in parallel.
+ *
+ * To flip an image vertically in place without moving any pixel, see BMP::flipVertical().
+ */
+class BMP_Transform {
+public:
+    BMP_Transform() = delete;
+
+    /**
+     * @brief Rotates an image clockwise by 90 degrees.
+     *
+     * @param n[in] Source image
+     * @return The rotated image, with the width and height of the source swapped
+     */
+    template<typename Image>
+    static Image rotate90(const Image &n);
+
+    /**
+     * @brief Rotates an image by 180 degrees.
+     *
+     * @param n[in] Source image
+     * @return The rotated image
+     */
+    template<typename Image>
+    static Image rotate180(const Image &n);
+
+    /**
+     * @brief Rotates an image clockwise by 270 degrees (counterclockwise by 90 degrees).
+     *
+     * @param n[in] Source image
+     * @return The rotated image, with the width and height of the source swapped
+     */
+    template<typename Image>
+    static Image rotate270(const Image &n);
+
+    /**
+     * @brief Mirrors an image left to right.
+     *
+     * @param n[in] Source image
+     * @return The mirrored image
+     */
+    template<typename Image>
+    static Image mirrorHorizontal(const Image &n);
+
+    /**
+     * @brief Mirrors an image top to bottom, into a new image with the row-order of the source.
+     *
+     * @param n[in] Source image
+     * @return The mirrored image
+     */
+    template<typename Image>
+    static Image mirrorVertical(const Image &n);
+};
+
+#endif //BMP_BMP_TRANSFORM_H
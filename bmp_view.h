@@ -0,0 +1,145 @@
+#ifndef BMP_BMP_VIEW_H
+#define BMP_BMP_VIEW_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <type_traits>
+
+/**
+ * @brief Non-owning view of a rectangle of pixels.
+ *
+ * Rows are stride bytes apart, the stride may be larger than the width or negative (e.g. bottom-up rows of a BMP file in
+ * memory). Taking a sub-view or copying a view never copies pixels, the pixels must outlive the view.
+ *
+ * Use a const Pixel type for a read-only view, see BMP_ConstView.
+ */
+template<typename Pixel>
+class BMP_View {
+public:
+    /// A byte of the pixels, const for a read-only view
+    typedef typename std::conditional<std::is_const<Pixel>::value, const uint8_t, uint8_t>::type Byte;
+
+    /// Constructs an empty view
+    BMP_View() : origin(nullptr), w(0), h(0), s(0) {
+    }
+
+    /**
+     * @brief Constructs a view over existing pixels.
+     *
+     * @param origin[in] Pointer to the top-left pixel
+     * @param w[in] Width
+     * @param h[in] Height
+     * @param stride[in] Distance in bytes from the start of a row to the start of the row below
+     */
+    BMP_View(Pixel *origin, const int32_t &w, const int32_t &h, const ptrdiff_t &stride) : origin(origin), w(w), h(h),
+                                                                                           s(stride) {
+    }
+
+    /// Converts a mutable view to a read-only view
+    template<typename P, typename = typename std::enable_if<std::is_convertible<P *, Pixel *>::value>::type>
+    BMP_View(const BMP_View<P> &n) : origin(n.row(0)), w(n.width()), h(n.height()), s(n.stride()) {
+    }
+
+    ///@{
+    /// Dimensions of the view
+    int32_t width() const {
+        return w;
+    }
+
+    int32_t height() const {
+        return h;
+    }
+    ///@}
+
+    /// Distance in bytes from the start of a row to the start of the row below
+    ptrdiff_t stride() const {
+        return s;
+    }
+
+    /// Whether the view has no pixels
+    bool empty() const {
+        return !w || !h;
+    }
+
+    /**
+     * @brief Pointer to the first pixel of row y, the pixels in a row are contiguous.
+     *
+     * y is not checked.
+     */
+    Pixel *row(const int32_t &y) const {
+        return reinterpret_cast<Pixel *>(reinterpret_cast<Byte *>(origin) + y * s);
+    }
+
+    /// Pointer to the first byte of row y, to work on the channels of the pixels as separate bytes, y is not checked
+    Byte *bytes(const int32_t &y) const {
+        return reinterpret_cast<Byte *>(row(y));
+    }
+
+    /**
+     * @brief Access pixel at (x, y).
+     *
+     * @param x[in] x
+     * @param y[in] y
+     * @return Reference to the pixel
+     */
+    Pixel &operator()(const int32_t &x, const int32_t &y) const {
+        if (!validIndex(x, y)) {
+            std::cerr << "BMP_View: Index out of bounds" << std::endl;
+            std::exit(1);
+        }
+
+        return row(y)[x];
+    }
+
+    /**
+     * @brief View of a rectangle inside this view, no pixels are copied.
+     *
+     * @param x[in] x of the top-left corner of the rectangle
+     * @param y[in] y of the top-left corner of the rectangle
+     * @param w[in] Width of the rectangle
+     * @param h[in] Height of the rectangle
+     * @return The sub-view
+     */
+    BMP_View sub(const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h) const {
+        if (!validRegion(x, y, w, h)) {
+            std::cerr << "BMP_View: Region out of bounds" << std::endl;
+            std::exit(1);
+        }
+
+        return BMP_View(row(y) + x, w, h, s);
+    }
+
+    /// View of the same pixels upside down, no pixels are copied
+    BMP_View flipped() const {
+        return h ? BMP_View(row(h - 1), w, h, -s) : *this;
+    }
+
+    /// Check for valid pixel index
+    bool validIndex(const int32_t &x, const int32_t &y) const {
+        return x >= 0 && x < w && y >= 0 && y < h;
+    }
+
+    /// Check if a non-empty region with top-left corner (x, y) lies inside the view
+    bool validRegion(const int32_t &x, const int32_t &y, const int32_t &w, const int32_t &h) const {
+        return x >= 0 && y >= 0 && w > 0 && h > 0 && static_cast<int64_t>(x) + w <= this->w &&
+               static_cast<int64_t>(y) + h <= this->h;
+    }
+
+private:
+    /// Top-left pixel
+    Pixel *origin;
+
+    /// Width and height
+    int32_t w, h;
+
+    /// Row stride in bytes
+    ptrdiff_t s;
+};
+
+/// Read-only view of a rectangle of pixels
+template<typename Pixel>
+using BMP_ConstView = BMP_View<const Pixel>;
+
+#endif //BMP_BMP_VIEW_H
@@ -3,6 +3,7 @@
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 
 BMP_BM::BMP_BM(const std::string &filename) : BMP(filename) {
     std::ifstream f(filename, std::ios::binary);
@@ -36,10 +37,13 @@ BMP_BM::BMP_BM(const std::string &filename) : BMP(filename) {
 }
 
 BMP_BM::BMP_BM(const int32_t &w, const int32_t &h, std::vector<uint32_t> bm) : BMP(w, h), bitmask(std::move(bm)) {
+    // The bitmask is only used, and saved, with the bit fields compression
+    if (!bitmask.empty())
+        infoHeader.biCompression = 3;
 }
 
-bool BMP_BM::save(std::ofstream &f) const {
-    if (!BMP::save(f))
+bool BMP_BM::save(std::ofstream &f, const int32_t &w, const int32_t &h) const {
+    if (!BMP::save(f, w, h))
         return false;
 
     // Write bitmask
@@ -64,7 +68,7 @@ bool BMP_BM::convertBitmask(std::vector<uint32_t> &bm) {
 
     // Check for overlapping
     for (uint8_t i = 0; i < 3; ++i) {
-        for (uint8_t j = i; j < 3; ++j) { // Check every possible combination for overlapping
+        for (uint8_t j = i + 1; j < 3; ++j) { // Check every possible combination for overlapping
             if (bm[i] & bm[j])
                 return false;
         }
@@ -81,3 +85,46 @@ bool BMP_BM::convertBitmask(std::vector<uint32_t> &bm) {
 
     return true;
 }
+
+std::vector<uint32_t> BMP_BM::getPixelMasks() const {
+    std::vector<uint32_t> masks;
+    if (infoHeader.biCompression == 3 && bitmask.size() == 3) {
+        for (uint8_t i = 0; i < 3; ++i)
+            masks.push_back(bitmask[i] >> (32u - infoHeader.biBitCount)); // Library format is aligned to the MSB
+    } else if (infoHeader.biBitCount == 16) {
+        masks = {0x7C00, 0x3E0, 0x1F};
+    } else {
+        masks = {0xFF0000, 0xFF00, 0xFF};
+    }
+
+    const uint32_t all = infoHeader.biBitCount == 32 ? UINT32_MAX : (1u << infoHeader.biBitCount) - 1;
+    masks.push_back(all & ~(masks[0] | masks[1] | masks[2]));
+
+    return masks;
+}
+
+const std::vector<uint32_t> &BMP_BM::getBitmask() const {
+    return bitmask;
+}
+
+uint32_t BMP_BM::averagePixels(const uint8_t *src, const uint32_t &count, const uint8_t &pixelSize,
+                               const std::vector<uint32_t> &masks) {
+    uint64_t sums[4] = {0};
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t pixel = 0;
+        std::memcpy(&pixel, src + i * pixelSize, pixelSize); // Little-endian
+
+        for (uint8_t c = 0; c < 4; ++c) {
+            if (masks[c])
+                sums[c] += (pixel & masks[c]) >> __builtin_ctz(masks[c]);
+        }
+    }
+
+    uint32_t average = 0;
+    for (uint8_t c = 0; c < 4; ++c) {
+        if (masks[c])
+            average |= static_cast<uint32_t>((sums[c] + count / 2) / count) << __builtin_ctz(masks[c]) & masks[c];
+    }
+
+    return average;
+}
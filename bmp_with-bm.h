@@ -11,6 +11,36 @@
  * Should not be constructed by itself, as it is an incomplete object.
  */
 class BMP_BM : public BMP {
+public:
+    /**
+     * @brief Bitmask of each channel within a pixel, in the order of red, green, blue, then the unused bits.
+     *
+     * Without a bitmask, 16-bit pixels are RGB555 and 32-bit pixels are RGB888.
+     */
+    std::vector<uint32_t> getPixelMasks() const;
+
+    /**
+     * @brief Accessor function to get the bitmask, in the library's format (see the bitmask member).
+     *
+     * @return Constant reference to the bitmask, empty if no bitmask is used
+     */
+    const std::vector<uint32_t> &getBitmask() const;
+
+    /**
+     * @{
+     * @brief Scales the value of the channel under a mask to 8 bits, and an 8-bit value back to the channel.
+     *
+     * Both round to the nearest value and return 0 if the mask is empty.
+     *
+     * @param pixel[in] Pixel holding the channel
+     * @param value[in] 8-bit value
+     * @param mask[in] Contiguous mask of the channel, e.g. from getPixelMasks()
+     */
+    static uint8_t toByte(const uint32_t &pixel, const uint32_t &mask);
+
+    static uint32_t fromByte(const uint8_t &value, const uint32_t &mask);
+    ///@}
+
 protected:
     /// Constructor to delegate to BMP class
     explicit BMP_BM(const std::string &filename);
@@ -18,11 +48,11 @@ protected:
     /// Copy constructor to delegate to BMP class
     BMP_BM(const BMP_BM &n) = default;
 
-    /// Constructor to delegate to BMP class
+    /// Constructor to delegate to BMP class, the compression is set to bit fields if a bitmask is given
     BMP_BM(const int32_t &w, const int32_t &h, std::vector<uint32_t> bm = std::vector<uint32_t>());
 
     /// Intermediate function to perform some colour table specific operations
-    bool save(std::ofstream &f) const;
+    bool save(std::ofstream &f, const int32_t &w, const int32_t &h) const;
 
     /**
      * Validate a bitmask and convert it to the the library's format if it is valid
@@ -31,6 +61,19 @@ protected:
      */
     static bool convertBitmask(std::vector<uint32_t> &bm);
 
+
+    /**
+     * @brief Averages each channel of a run of pixels separately.
+     *
+     * @param src[in] Pixels, stored the same way as in the file
+     * @param count[in] Number of pixels
+     * @param pixelSize[in] Size in bytes for 1 pixel
+     * @param masks[in] Return value of getPixelMasks()
+     * @return The averaged pixel
+     */
+    static uint32_t averagePixels(const uint8_t *src, const uint32_t &count, const uint8_t &pixelSize,
+                                  const std::vector<uint32_t> &masks);
+
     /**
      * @brief Bitmask vector, ignored if empty (i.e. empty() returns true)
      *
@@ -45,4 +88,24 @@ protected:
     std::vector<uint32_t> bitmask;
 };
 
+// Called for every pixel by the conversions, so defined here to be inlined
+
+inline uint8_t BMP_BM::toByte(const uint32_t &pixel, const uint32_t &mask) {
+    if (!mask)
+        return 0;
+
+    const uint32_t shift = __builtin_ctz(mask);
+    const uint64_t max = mask >> shift;
+    return static_cast<uint8_t>((((pixel & mask) >> shift) * 255 + max / 2) / max);
+}
+
+inline uint32_t BMP_BM::fromByte(const uint8_t &value, const uint32_t &mask) {
+    if (!mask)
+        return 0;
+
+    const uint32_t shift = __builtin_ctz(mask);
+    const uint64_t max = mask >> shift;
+    return static_cast<uint32_t>((value * max + 127) / 255) << shift;
+}
+
 #endif //BMP_BMP_WITH_BM_H
@@ -13,10 +13,20 @@ void BMP_CT::readClrTable(std::ifstream &f) {
     const uint32_t colourTableSize = 1u << infoHeader.biBitCount << 2u;
     colourTable.resize(colourTableSize);
     f.read(reinterpret_cast<char *>(&colourTable[0]), colourTableSize);
+
+    updatePalette();
+}
+
+void BMP_CT::updatePalette() {
+    palette = BMP_Palette(colourTable);
+}
+
+const BMP_Palette &BMP_CT::getPalette() const {
+    return palette;
 }
 
-bool BMP_CT::save(std::ofstream &f) const {
-    if (!BMP::save(f))
+bool BMP_CT::save(std::ofstream &f, const int32_t &w, const int32_t &h) const {
+    if (!BMP::save(f, w, h))
         return false;
 
     if (infoHeader.biCompression == 3) {
@@ -53,8 +63,8 @@ void BMP_CT::assertClrTableIndexOutOfRange() {
 }
 
 void BMP_CT::setColourTable(const uint32_t &index, const uint8_t &r, const uint8_t &g, const uint8_t &b) {
-    const uint16_t offset = 4 * index;
-    if (index >= colourTable.size()) {
+    const uint32_t offset = 4 * index;
+    if (offset + 3 >= colourTable.size()) {
         assertClrTableIndexOutOfRange();
         return;
     }
@@ -62,6 +72,8 @@ void BMP_CT::setColourTable(const uint32_t &index, const uint8_t &r, const uint8
     colourTable[offset] = b;
     colourTable[offset + 1] = g;
     colourTable[offset + 2] = r;
+
+    updatePalette();
 }
 
 bool BMP_CT::setColourTable(const std::vector<uint8_t> &table) {
@@ -71,7 +83,11 @@ bool BMP_CT::setColourTable(const std::vector<uint8_t> &table) {
     }
 
     colourTable = table;
-    infoHeader.biClrUsed = colourTable.size();
+    infoHeader.biClrUsed = colourTable.size() / 4;
+    fileHeader.bfOffBits = fileHeaderSize + infoHeader.biSize + colourTable.size();
+    fileHeader.bfSize = fileHeader.bfOffBits + infoHeader.biSizeImage;
+
+    updatePalette();
 
     return true;
 }
@@ -81,7 +97,7 @@ std::vector<uint8_t> BMP_CT::getColourTable() const {
 }
 
 void BMP_CT::getColourTable(const uint32_t &index, uint8_t &r, uint8_t &g, uint8_t &b) const {
-    const uint8_t offset = 4 * index;
+    const uint32_t offset = 4 * index;
     if (offset + 3 >= colourTable.size()) {
         assertClrTableIndexOutOfRange();
         return;
@@ -91,3 +107,42 @@ void BMP_CT::getColourTable(const uint32_t &index, uint8_t &r, uint8_t &g, uint8
     g = colourTable[offset + 1];
     r = colourTable[offset + 2];
 }
+
+uint8_t BMP_CT::nearestColour(const uint8_t &r, const uint8_t &g, const uint8_t &b) const {
+    uint8_t nearest = 0;
+    uint32_t minDistance = UINT32_MAX;
+
+    for (size_t i = 0; i + 3 < colourTable.size(); i += 4) {
+        const int32_t db = colourTable[i] - b, dg = colourTable[i + 1] - g, dr = colourTable[i + 2] - r;
+        const uint32_t distance = dr * dr + dg * dg + db * db;
+
+        if (distance < minDistance) {
+            minDistance = distance;
+            nearest = i / 4;
+        }
+    }
+
+    return nearest;
+}
+
+uint8_t BMP_CT::averageColour(const uint8_t *indices, const uint32_t &count) const {
+    // Nothing to average if all indices are the same
+    uint32_t i = 1;
+    while (i < count && indices[i] == indices[0])
+        ++i;
+    if (i == count)
+        return indices[0];
+
+    uint32_t sums[3] = {0};
+    for (i = 0; i < count; ++i) {
+        const size_t offset = 4 * indices[i];
+        if (offset + 3 >= colourTable.size())
+            continue;
+
+        sums[0] += colourTable[offset];
+        sums[1] += colourTable[offset + 1];
+        sums[2] += colourTable[offset + 2];
+    }
+
+    return nearestColour((sums[2] + count / 2) / count, (sums[1] + count / 2) / count, (sums[0] + count / 2) / count);
+}
@@ -2,6 +2,7 @@
 #define BMP_BMP_WITH_CT_H
 
 #include "bmp.h"
+#include "bmp_palette.h"
 #include <string>
 #include <cstdint>
 #include <vector>
@@ -11,6 +12,14 @@
  * \brief Intermediate base class to contain all common functions of BMP formats with a colour table
  */
 class BMP_CT: public BMP {
+	public:
+		/**
+		 * \brief Accessor function to get the colour table as packed entries.
+		 *
+		 * @return Constant reference to the palette, kept up to date with the colour table
+		 */
+		const BMP_Palette& getPalette() const;
+
 	protected:
 		/// Constructor to delegate to BMP class
 		explicit BMP_CT(const std::string& filename);
@@ -24,8 +33,11 @@ class BMP_CT: public BMP {
 		/// Read colour table
 		void readClrTable(std::ifstream& f);
 
+		/// Rebuilds palette from colourTable, must be called whenever colourTable is modified directly
+		void updatePalette();
+
 		/// Intermediate function to perform some colour table specific operations
-		bool save(std::ofstream& f) const;
+		bool save(std::ofstream& f, const int32_t& w, const int32_t& h) const;
 
 		/// Given the current conditions, is this colour table size valid?
 		bool validClrTableSize(const uint32_t& size) const;
@@ -53,7 +65,7 @@ class BMP_CT: public BMP {
 		void setColourTable(const uint32_t& index, const uint8_t& r, const uint8_t& g, const uint8_t& b);
 
 		/**
-		 * \brief Replace the colour table with the one provided, modifies infoHeader.biClrUsed to match the new size too.
+		 * \brief Replace the colour table with the one provided, modifies infoHeader.biClrUsed and the offset of the pixel array to match the new size too.
 		 *
 		 * Will return false and do nothing if size > 2 ^ colour-depth * 4 or size is not divisible by 4.
 		 *
@@ -79,11 +91,30 @@ class BMP_CT: public BMP {
 		 */
 		void getColourTable(const uint32_t& index, uint8_t& r, uint8_t& g, uint8_t& b) const;
 
+		/**
+		 * \brief Finds the colour table entry closest to a colour.
+		 *
+		 * @return Index of the entry with the smallest squared distance to the colour
+		 */
+		uint8_t nearestColour(const uint8_t& r, const uint8_t& g, const uint8_t& b) const;
+
+		/**
+		 * \brief Averages the colours of a run of colour table indices.
+		 *
+		 * @param indices[in] Colour table indices
+		 * @param count[in] Number of indices
+		 * @return Index of the entry closest to the average colour
+		 */
+		uint8_t averageColour(const uint8_t* indices, const uint32_t& count) const;
+
 		/// Assignment operator
 		BMP_CT& operator=(const BMP_CT& n) = default;
 
 		/// Colour table, stored as dynamic array.
 		std::vector<uint8_t> colourTable;
+
+		/// Colour table as packed entries
+		BMP_Palette palette;
 };
 
 #endif //BMP_BMP_WITH_CT_H
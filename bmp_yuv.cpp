@@ -0,0 +1,593 @@
+#include "bmp_yuv.h"
+#include "bmp_parallel.h"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/// Matrix from R, G and B to Y, Cb and Cr in 14-bit fixed-point, coefficients in R, G, B order
+struct Forward {
+    int16_t y[3], u[3], v[3];
+    int32_t offset; // Y of black
+};
+
+/// Matrix from Y, Cb and Cr to R, G and B in 13-bit fixed-point
+struct Inverse {
+    int16_t y, rv, gu, gv, bu;
+    int16_t offset; // Y of black
+};
+
+/// Luma weights of red and blue
+static void weights(const BMP_Convert::Luma &matrix, double &kr, double &kb) {
+    kr = matrix == BMP_Convert::Luma::bt709 ? 0.2126 : 0.299;
+    kb = matrix == BMP_Convert::Luma::bt709 ? 0.0722 : 0.114;
+}
+
+static Forward forward(const BMP_Convert::Luma &matrix, const BMP_YUV::Range &range) {
+    double kr, kb;
+    weights(matrix, kr, kb);
+    const double kg = 1 - kr - kb;
+    const bool full = range == BMP_YUV::Range::full;
+    const double ys = (full ? 1.0 : 219.0 / 255) * (1 << 14), cs = (full ? 1.0 : 224.0 / 255) * (1 << 14);
+
+    // Green takes the rounding error, so white and grey are exact
+    Forward m;
+    m.y[0] = std::lround(kr * ys);
+    m.y[2] = std::lround(kb * ys);
+    m.y[1] = std::lround(ys) - m.y[0] - m.y[2];
+    m.u[0] = std::lround(-kr / (2 * (1 - kb)) * cs);
+    m.u[1] = std::lround(-kg / (2 * (1 - kb)) * cs);
+    m.u[2] = -m.u[0] - m.u[1];
+    m.v[1] = std::lround(-kg / (2 * (1 - kr)) * cs);
+    m.v[2] = std::lround(-kb / (2 * (1 - kr)) * cs);
+    m.v[0] = -m.v[1] - m.v[2];
+    m.offset = full ? 0 : 16;
+
+    return m;
+}
+
+static Inverse inverse(const BMP_Convert::Luma &matrix, const BMP_YUV::Range &range) {
+    double kr, kb;
+    weights(matrix, kr, kb);
+    const double kg = 1 - kr - kb;
+    const bool full = range == BMP_YUV::Range::full;
+    const double ys = (full ? 1.0 : 255.0 / 219) * (1 << 13), cs = (full ? 1.0 : 255.0 / 224) * (1 << 13);
+
+    Inverse m;
+    m.y = std::lround(ys);
+    m.rv = std::lround(2 * (1 - kr) * cs);
+    m.gu = std::lround(-2 * (1 - kb) * kb / kg * cs);
+    m.gv = std::lround(-2 * (1 - kr) * kr / kg * cs);
+    m.bu = std::lround(2 * (1 - kb) * cs);
+    m.offset = full ? 0 : 16;
+
+    return m;
+}
+
+static inline uint8_t clamp(const int32_t &v) {
+    return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+#ifdef __SSE2__
+/// Pairs of 16-bit lanes for _mm_madd_epi16()
+static inline __m128i pairs(const int16_t &lo, const int16_t &hi) {
+    return _mm_set1_epi32(static_cast<uint16_t>(lo) | static_cast<uint32_t>(static_cast<uint16_t>(hi)) << 16u);
+}
+#endif
+
+/**
+ * @brief Converts a row of planes to Y.
+ *
+ * @param m[in] Matrix
+ * @param src[in] Planes of blue, green and red bytes
+ * @param dst[out] n Y values
+ * @param n[in] Number of pixels
+ */
+static void lumaRow(const Forward &m, const uint8_t *const src[3], uint8_t *dst, const int32_t &n) {
+    const int32_t bias = (m.offset << 14) + (1 << 13);
+    int32_t x = 0;
+#ifdef __SSE2__
+    // Blue and green are multiplied in pairs, then red
+    const __m128i bg = pairs(m.y[2], m.y[1]), r0 = pairs(m.y[0], 0);
+    const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi32(bias);
+
+    // 8 pixels, as 16-bit lanes
+    const auto eight = [&](const __m128i &b, const __m128i &g, const __m128i &r) -> __m128i {
+        const __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(b, g), bg),
+                                         _mm_madd_epi16(_mm_unpacklo_epi16(r, zero), r0));
+        const __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(b, g), bg),
+                                         _mm_madd_epi16(_mm_unpackhi_epi16(r, zero), r0));
+        return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, round), 14),
+                               _mm_srai_epi32(_mm_add_epi32(hi, round), 14));
+    };
+
+    for (; x + 16 <= n; x += 16) {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src[0] + x));
+        const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src[1] + x));
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src[2] + x));
+
+        const __m128i lo = eight(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(r, zero));
+        const __m128i hi = eight(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(r, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; x < n; ++x)
+        dst[x] = clamp((m.y[0] * src[2][x] + m.y[1] * src[1][x] + m.y[2] * src[0][x] + bias) >> 14);
+}
+
+/**
+ * @brief Converts two rows of planes to a row of Cb and a row of Cr, each from the sum of a 2x2 block.
+ *
+ * @param m[in] Matrix
+ * @param top[in] Planes of blue, green and red bytes of the first row
+ * @param bottom[in] Planes of the second row, the same as top for the last row of an odd height
+ * @param u[out] (w + 1) / 2 Cb values
+ * @param v[out] (w + 1) / 2 Cr values
+ * @param w[in] Number of pixels in a row
+ */
+static void chromaRow(const Forward &m, const uint8_t *const top[3], const uint8_t *const bottom[3], uint8_t *u,
+                      uint8_t *v, const int32_t &w) {
+    // The sums are 4 times the average, so 2 more bits are shifted out
+    const int32_t bias = (128 << 16) + (1 << 15);
+    int32_t x = 0;
+#ifdef __SSE2__
+    const __m128i ubg = pairs(m.u[2], m.u[1]), ur0 = pairs(m.u[0], 0);
+    const __m128i vbg = pairs(m.v[2], m.v[1]), vr0 = pairs(m.v[0], 0);
+    const __m128i zero = _mm_setzero_si128(), low = _mm_set1_epi16(0xFF), round = _mm_set1_epi32(bias);
+
+    // Sums of 8 blocks of a plane, as 16-bit lanes
+    const auto sum = [&](const uint8_t *a, const uint8_t *b) -> __m128i {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+        const __m128i q = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+        return _mm_add_epi16(_mm_add_epi16(_mm_and_si128(p, low), _mm_srli_epi16(p, 8)),
+                             _mm_add_epi16(_mm_and_si128(q, low), _mm_srli_epi16(q, 8)));
+    };
+
+    // 8 values of Cb or Cr, as 16-bit lanes
+    const auto eight = [&](const __m128i &b, const __m128i &g, const __m128i &r, const __m128i &bg,
+                           const __m128i &r0) -> __m128i {
+        const __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(b, g), bg),
+                                         _mm_madd_epi16(_mm_unpacklo_epi16(r, zero), r0));
+        const __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(b, g), bg),
+                                         _mm_madd_epi16(_mm_unpackhi_epi16(r, zero), r0));
+        return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, round), 16),
+                               _mm_srai_epi32(_mm_add_epi32(hi, round), 16));
+    };
+
+    for (; 2 * x + 16 <= w; x += 8) {
+        const __m128i b = sum(top[0] + 2 * x, bottom[0] + 2 * x);
+        const __m128i g = sum(top[1] + 2 * x, bottom[1] + 2 * x);
+        const __m128i r = sum(top[2] + 2 * x, bottom[2] + 2 * x);
+
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(u + x), _mm_packus_epi16(eight(b, g, r, ubg, ur0), zero));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(v + x), _mm_packus_epi16(eight(b, g, r, vbg, vr0), zero));
+    }
+#endif
+
+    for (; 2 * x < w; ++x) {
+        const int32_t x0 = 2 * x, x1 = x0 + 1 < w ? x0 + 1 : x0;
+        int32_t s[3];
+        for (uint8_t c = 0; c < 3; ++c)
+            s[c] = top[c][x0] + top[c][x1] + bottom[c][x0] + bottom[c][x1];
+
+        u[x] = clamp((m.u[0] * s[2] + m.u[1] * s[1] + m.u[2] * s[0] + bias) >> 16);
+        v[x] = clamp((m.v[0] * s[2] + m.v[1] * s[1] + m.v[2] * s[0] + bias) >> 16);
+    }
+}
+
+/**
+ * @brief Converts a row of Y and a row of Cb and Cr to planes, each chroma value covering 2 pixels.
+ *
+ * @param m[in] Matrix
+ * @param y[in] w Y values
+ * @param u[in] (w + 1) / 2 Cb values
+ * @param v[in] (w + 1) / 2 Cr values
+ * @param dst[out] Planes of blue, green and red bytes
+ * @param w[in] Number of pixels
+ */
+static void rgbRow(const Inverse &m, const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *const dst[3],
+                   const int32_t &w) {
+    int32_t x = 0;
+#ifdef __SSE2__
+    // Y is multiplied with the rounding in a pair, then Cb and Cr in a pair for each channel
+    const __m128i y1 = pairs(m.y, 1 << 12), r = pairs(0, m.rv), g = pairs(m.gu, m.gv), b = pairs(m.bu, 0);
+    const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi16(1);
+    const __m128i offset = _mm_set1_epi16(m.offset), middle = _mm_set1_epi16(128);
+
+    // 8 pixels of each channel, as 16-bit lanes in b, g and r
+    const auto eight = [&](const __m128i &luma, const __m128i &cb, const __m128i &cr, __m128i out[3]) -> void {
+        const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(luma, one), y1);
+        const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(luma, one), y1);
+        const __m128i uvLo = _mm_unpacklo_epi16(cb, cr), uvHi = _mm_unpackhi_epi16(cb, cr);
+        const __m128i weights[3] = {b, g, r};
+
+        for (uint8_t c = 0; c < 3; ++c) {
+            out[c] = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, _mm_madd_epi16(uvLo, weights[c])), 13),
+                                     _mm_srai_epi32(_mm_add_epi32(hi, _mm_madd_epi16(uvHi, weights[c])), 13));
+        }
+    };
+
+    for (; x + 16 <= w; x += 16) {
+        const __m128i luma = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+        const __m128i cb = _mm_sub_epi16(_mm_unpacklo_epi8(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2)), zero), middle);
+        const __m128i cr = _mm_sub_epi16(_mm_unpacklo_epi8(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2)), zero), middle);
+
+        __m128i lo[3], hi[3];
+        eight(_mm_sub_epi16(_mm_unpacklo_epi8(luma, zero), offset), _mm_unpacklo_epi16(cb, cb),
+              _mm_unpacklo_epi16(cr, cr), lo);
+        eight(_mm_sub_epi16(_mm_unpackhi_epi8(luma, zero), offset), _mm_unpackhi_epi16(cb, cb),
+              _mm_unpackhi_epi16(cr, cr), hi);
+
+        for (uint8_t c = 0; c < 3; ++c)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst[c] + x), _mm_packus_epi16(lo[c], hi[c]));
+    }
+#endif
+
+    for (; x < w; ++x) {
+        const int32_t luma = m.y * (y[x] - m.offset) + (1 << 12);
+        const int32_t cb = u[x / 2] - 128, cr = v[x / 2] - 128;
+
+        dst[0][x] = clamp((luma + m.bu * cb) >> 13);
+        dst[1][x] = clamp((luma + m.gu * cb + m.gv * cr) >> 13);
+        dst[2][x] = clamp((luma + m.rv * cr) >> 13);
+    }
+}
+
+///@{
+/// Interleaves rows of Cb and Cr into a row of pairs and back
+static void joinChroma(const uint8_t *u, const uint8_t *v, uint8_t *dst, const int32_t &n) {
+    int32_t x = 0;
+#ifdef __SSE2__
+    for (; x + 16 <= n; x += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * x), _mm_unpacklo_epi8(a, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * x + 16), _mm_unpackhi_epi8(a, b));
+    }
+#endif
+
+    for (; x < n; ++x) {
+        dst[2 * x] = u[x];
+        dst[2 * x + 1] = v[x];
+    }
+}
+
+static void splitChroma(const uint8_t *src, uint8_t *u, uint8_t *v, const int32_t &n) {
+    int32_t x = 0;
+#ifdef __SSE2__
+    const __m128i low = _mm_set1_epi16(0xFF);
+    for (; x + 16 <= n; x += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * x));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * x + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x),
+                         _mm_packus_epi16(_mm_and_si128(a, low), _mm_and_si128(b, low)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(v + x),
+                         _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+#endif
+
+    for (; x < n; ++x) {
+        u[x] = src[2 * x];
+        v[x] = src[2 * x + 1];
+    }
+}
+///@}
+
+///@{
+/// Splits a row of RGB888 pixels into planes of blue, green and red bytes and back, the unused byte is 0
+static void splitRGB888(const uint32_t *src, uint8_t *const dst[3], const int32_t &n) {
+    int32_t x = 0;
+#ifdef __SSE2__
+    const __m128i low = _mm_set1_epi32(0xFF);
+    for (; x + 16 <= n; x += 16) {
+        __m128i p[4];
+        for (uint8_t i = 0; i < 4; ++i)
+            p[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x + 4 * i));
+
+        for (uint8_t c = 0; c < 3; ++c) {
+            __m128i q[4];
+            for (uint8_t i = 0; i < 4; ++i)
+                q[i] = _mm_and_si128(_mm_srli_epi32(p[i], 8 * c), low);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst[c] + x),
+                             _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]), _mm_packs_epi32(q[2], q[3])));
+        }
+    }
+#endif
+
+    for (; x < n; ++x) {
+        for (uint8_t c = 0; c < 3; ++c)
+            dst[c][x] = src[x] >> 8u * c & 0xFFu;
+    }
+}
+
+static void joinRGB888(const uint8_t *const src[3], uint32_t *dst, const int32_t &n) {
+    int32_t x = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= n; x += 16) {
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src[0] + x));
+        const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src[1] + x));
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src[2] + x));
+
+        const __m128i bg[2] = {_mm_unpacklo_epi8(b, g), _mm_unpackhi_epi8(b, g)};
+        const __m128i r0[2] = {_mm_unpacklo_epi8(r, zero), _mm_unpackhi_epi8(r, zero)};
+        for (uint8_t i = 0; i < 2; ++i) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + 8 * i), _mm_unpacklo_epi16(bg[i], r0[i]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + 8 * i + 4), _mm_unpackhi_epi16(bg[i], r0[i]));
+        }
+    }
+#endif
+
+    for (; x < n; ++x)
+        dst[x] = src[0][x] | static_cast<uint32_t>(src[1][x]) << 8u | static_cast<uint32_t>(src[2][x]) << 16u;
+}
+///@}
+
+namespace {
+    /// Rows of 24-bit pixels as planes of blue, green and red bytes, const views when exporting
+    template<typename View, typename PlaneView>
+    struct RGBRows {
+        View view;
+        PlaneView planes[3];
+        bool planar;
+
+        /// Points out at the planes of row y, split into buf (3 times the width) with the interleaved storage
+        void read(const int32_t &y, uint8_t *buf, const uint8_t *out[3]) const {
+            if (planar) {
+                for (uint8_t c = 0; c < 3; ++c)
+                    out[c] = planes[c].row(y);
+            } else {
+                const int32_t w = view.width();
+                BMP_24bit::deinterleave(view.bytes(y), buf, buf + w, buf + 2 * w, w);
+                out[0] = buf, out[1] = buf + w, out[2] = buf + 2 * w;
+            }
+        }
+
+        /// Points out at the planes to write row y to, in buf (3 times the width) with the interleaved storage
+        void target(const int32_t &y, uint8_t *buf, uint8_t *out[3]) const {
+            for (uint8_t c = 0; c < 3; ++c)
+                out[c] = planar ? planes[c].row(y) : buf + c * view.width();
+        }
+
+        /// Writes the planes of row y returned by target() to the image
+        void write(const int32_t &y, uint8_t *const src[3]) const {
+            if (!planar)
+                BMP_24bit::interleave(src[0], src[1], src[2], view.bytes(y), view.width());
+        }
+    };
+
+    /// Rows of 32-bit pixels as planes of blue, green and red bytes, a const view when exporting
+    template<typename View>
+    struct MaskRows {
+        View view;
+        std::vector<uint32_t> masks; // Red, green, blue
+        bool rgb888;
+
+        void read(const int32_t &y, uint8_t *buf, const uint8_t *out[3]) const {
+            const int32_t w = view.width();
+            uint8_t *const planes[3] = {buf, buf + w, buf + 2 * w};
+
+            if (rgb888) {
+                splitRGB888(view.row(y), planes, w);
+            } else {
+                const uint32_t *src = view.row(y);
+                for (int32_t x = 0; x < w; ++x) {
+                    for (uint8_t c = 0; c < 3; ++c)
+                        planes[c][x] = BMP_BM::toByte(src[x], masks[2 - c]);
+                }
+            }
+
+            for (uint8_t c = 0; c < 3; ++c)
+                out[c] = planes[c];
+        }
+
+        void target(const int32_t &, uint8_t *buf, uint8_t *out[3]) const {
+            for (uint8_t c = 0; c < 3; ++c)
+                out[c] = buf + c * view.width();
+        }
+
+        void write(const int32_t &y, uint8_t *const src[3]) const {
+            if (rgb888) {
+                joinRGB888(src, view.row(y), view.width());
+            } else {
+                uint32_t *dst = view.row(y);
+                for (int32_t x = 0; x < view.width(); ++x) {
+                    dst[x] = BMP_BM::fromByte(src[0][x], masks[2]) | BMP_BM::fromByte(src[1][x], masks[1]) |
+                             BMP_BM::fromByte(src[2][x], masks[0]);
+                }
+            }
+        }
+    };
+}
+
+/// Rows of a 24-bit image, in either storage
+template<typename Rows, typename Image>
+static Rows rgbRows(Image &n) {
+    Rows out;
+    out.planar = n.getStorage() == BMP_24bit::Storage::planar;
+    if (out.planar) {
+        out.planes[0] = n.plane(BMP_24bit::Channel::blue);
+        out.planes[1] = n.plane(BMP_24bit::Channel::green);
+        out.planes[2] = n.plane(BMP_24bit::Channel::red);
+    } else {
+        out.view = n.view();
+    }
+
+    return out;
+}
+
+/// Rows of a 32-bit image
+template<typename Rows, typename Image>
+static Rows maskRows(Image &n) {
+    Rows out;
+    out.masks = n.getPixelMasks();
+    out.rgb888 = out.masks[0] == 0xFF0000 && out.masks[1] == 0xFF00 && out.masks[2] == 0xFF;
+    out.view = n.view();
+
+    return out;
+}
+
+///@{
+/// Rows of an image, const to export it, mutable to import into it
+static RGBRows<BMP_24bit::ConstView, BMP_24bit::ConstPlaneView> rowsOf(const BMP_24bit &n) {
+    return rgbRows<RGBRows<BMP_24bit::ConstView, BMP_24bit::ConstPlaneView>>(n);
+}
+
+static RGBRows<BMP_24bit::View, BMP_24bit::PlaneView> rowsOf(BMP_24bit &n) {
+    return rgbRows<RGBRows<BMP_24bit::View, BMP_24bit::PlaneView>>(n);
+}
+
+static MaskRows<BMP_32bit::ConstView> rowsOf(const BMP_32bit &n) {
+    return maskRows<MaskRows<BMP_32bit::ConstView>>(n);
+}
+
+static MaskRows<BMP_32bit::View> rowsOf(BMP_32bit &n) {
+    return maskRows<MaskRows<BMP_32bit::View>>(n);
+}
+///@}
+
+/// Exits if the image is empty or the rows of the planes are too short
+static void assertInvalidDimensions(const BMP &n, const size_t &yStride, const size_t &uvStride,
+                                    const bool &interleaved) {
+    const int32_t w = n.getInfoHeader().biWidth;
+    const size_t chroma = (interleaved ? 2 : 1) * static_cast<size_t>((w + 1) / 2);
+
+    if (w <= 0 || n.getInfoHeader().biHeight == 0 || yStride < static_cast<size_t>(w) || uvStride < chroma) {
+        std::cerr << "BMP_YUV: Invalid dimensions." << std::endl;
+        std::exit(1);
+    }
+}
+
+/**
+ * @brief Writes an image as Y, Cb and Cr planes, a pair of rows at a time in parallel.
+ *
+ * @param n[in] Image
+ * @param y[out] Y plane
+ * @param yStride[in] Bytes between the rows of y
+ * @param u[out] Cb plane, or plane of Cb and Cr pairs if interleaved
+ * @param v[out] Cr plane, unused if interleaved
+ * @param uvStride[in] Bytes between the rows of u and v
+ * @param interleaved[in] Whether Cb and Cr are in a single plane (NV12)
+ * @param matrix[in] Luma weights of the matrix
+ * @param range[in] Range of the values
+ */
+template<typename Image>
+static void encode(const Image &n, uint8_t *y, const size_t &yStride, uint8_t *u, uint8_t *v, const size_t &uvStride,
+                   const bool &interleaved, const BMP_Convert::Luma &matrix, const BMP_YUV::Range &range) {
+    assertInvalidDimensions(n, yStride, uvStride, interleaved);
+
+    const int32_t w = n.getInfoHeader().biWidth, h = std::abs(n.getInfoHeader().biHeight), cw = (w + 1) / 2;
+    const Forward m = forward(matrix, range);
+    const auto rows = rowsOf(n);
+
+    BMP_Parallel::forRows(0, (h + 1) / 2, [&](const int32_t &begin, const int32_t &end) -> void {
+        std::vector<uint8_t> buf(6 * static_cast<size_t>(w) + 2 * static_cast<size_t>(cw));
+        uint8_t *cb = &buf[6 * static_cast<size_t>(w)], *cr = cb + cw;
+
+        for (int32_t cy = begin; cy < end; ++cy) {
+            // The last row of an odd height is its own pair
+            const uint8_t *top[3], *bottom[3];
+            rows.read(2 * cy, buf.data(), top);
+            lumaRow(m, top, y + 2 * cy * yStride, w);
+            if (2 * cy + 1 < h) {
+                rows.read(2 * cy + 1, buf.data() + 3 * w, bottom);
+                lumaRow(m, bottom, y + (2 * cy + 1) * yStride, w);
+            } else {
+                std::copy(top, top + 3, bottom);
+            }
+
+            if (interleaved) {
+                chromaRow(m, top, bottom, cb, cr, w);
+                joinChroma(cb, cr, u + cy * uvStride, cw);
+            } else {
+                chromaRow(m, top, bottom, u + cy * uvStride, v + cy * uvStride, w);
+            }
+        }
+    });
+}
+
+/**
+ * @brief Reads Y, Cb and Cr planes into an image, rows in parallel.
+ *
+ * @param y[in] Y plane
+ * @param yStride[in] Bytes between the rows of y
+ * @param u[in] Cb plane, or plane of Cb and Cr pairs if interleaved
+ * @param v[in] Cr plane, unused if interleaved
+ * @param uvStride[in] Bytes between the rows of u and v
+ * @param interleaved[in] Whether Cb and Cr are in a single plane (NV12)
+ * @param n[out] Image
+ * @param matrix[in] Luma weights of the matrix
+ * @param range[in] Range of the values
+ */
+template<typename Image>
+static void decode(const uint8_t *y, const size_t &yStride, const uint8_t *u, const uint8_t *v,
+                   const size_t &uvStride, const bool &interleaved, Image &n, const BMP_Convert::Luma &matrix,
+                   const BMP_YUV::Range &range) {
+    assertInvalidDimensions(n, yStride, uvStride, interleaved);
+
+    const int32_t w = n.getInfoHeader().biWidth, h = std::abs(n.getInfoHeader().biHeight), cw = (w + 1) / 2;
+    const Inverse m = inverse(matrix, range);
+    const auto rows = rowsOf(n);
+
+    BMP_Parallel::forRows(0, h, [&](const int32_t &begin, const int32_t &end) -> void {
+        std::vector<uint8_t> buf(3 * static_cast<size_t>(w) + 2 * static_cast<size_t>(cw));
+        uint8_t *cb = &buf[3 * static_cast<size_t>(w)], *cr = cb + cw;
+
+        for (int32_t row = begin; row < end; ++row) {
+            const size_t offset = row / 2 * uvStride;
+            if (interleaved)
+                splitChroma(u + offset, cb, cr, cw);
+
+            uint8_t *planes[3];
+            rows.target(row, buf.data(), planes);
+            rgbRow(m, y + row * yStride, interleaved ? cb : u + offset, interleaved ? cr : v + offset, planes, w);
+            rows.write(row, planes);
+        }
+    });
+}
+
+template<typename Image>
+void BMP_YUV::toI420(const Image &n, uint8_t *y, const size_t &yStride, uint8_t *u, uint8_t *v,
+                     const size_t &uvStride, const BMP_Convert::Luma &matrix, const Range &range) {
+    encode(n, y, yStride, u, v, uvStride, false, matrix, range);
+}
+
+template<typename Image>
+void BMP_YUV::toNV12(const Image &n, uint8_t *y, const size_t &yStride, uint8_t *uv, const size_t &uvStride,
+                     const BMP_Convert::Luma &matrix, const Range &range) {
+    encode(n, y, yStride, uv, nullptr, uvStride, true, matrix, range);
+}
+
+template<typename Image>
+void BMP_YUV::fromI420(const uint8_t *y, const size_t &yStride, const uint8_t *u, const uint8_t *v,
+                       const size_t &uvStride, Image &n, const BMP_Convert::Luma &matrix, const Range &range) {
+    decode(y, yStride, u, v, uvStride, false, n, matrix, range);
+}
+
+template<typename Image>
+void BMP_YUV::fromNV12(const uint8_t *y, const size_t &yStride, const uint8_t *uv, const size_t &uvStride,
+                       Image &n, const BMP_Convert::Luma &matrix, const Range &range) {
+    decode(y, yStride, uv, nullptr, uvStride, true, n, matrix, range);
+}
+
+#define BMP_YUV_INSTANTIATE(Image) \
+    template void BMP_YUV::toI420(const Image &, uint8_t *, const size_t &, uint8_t *, uint8_t *, const size_t &, \
+                                  const BMP_Convert::Luma &, const Range &); \
+    template void BMP_YUV::toNV12(const Image &, uint8_t *, const size_t &, uint8_t *, const size_t &, \
+                                  const BMP_Convert::Luma &, const Range &); \
+    template void BMP_YUV::fromI420(const uint8_t *, const size_t &, const uint8_t *, const uint8_t *, \
+                                    const size_t &, Image &, const BMP_Convert::Luma &, const Range &); \
+    template void BMP_YUV::fromNV12(const uint8_t *, const size_t &, const uint8_t *, const size_t &, Image &, \
+                                    const BMP_Convert::Luma &, const Range &);
+
+BMP_YUV_INSTANTIATE(BMP_24bit)
+BMP_YUV_INSTANTIATE(BMP_32bit)
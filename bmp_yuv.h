@@ -0,0 +1,102 @@
+#ifndef BMP_BMP_YUV_H
+#define BMP_BMP_YUV_H
+
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include "bmp_convert.h"
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Conversions between colour images and YCbCr 4:2:0 planes (e.g. the frames of a video encoder).
+ *
+ * Should not be constructed, it only groups static functions. I420 is a plane of Y, then a plane of Cb (U) and one of
+ * Cr (V), each a quarter of the size. NV12 has the same Y plane, then a single plane of interleaved Cb and Cr bytes.
+ * A chroma plane is ceil(width / 2) by ceil(height / 2), row y of a plane being row y of the image from the top,
+ * whatever its row-order.
+ *
+ * The matrix is applied in fixed-point with SSE2 when compiled with SSE2 enabled, and pairs of rows are converted in
+ * parallel. Exported chroma is the average of each 2x2 block, the last row and column are repeated for odd
+ * dimensions. Imported chroma is repeated over its 2x2 block.
+ *
+ * Every function is available for BMP_24bit (either storage) and BMP_32bit. 32-bit images with a bitmask other than
+ * RGB888 are converted with a scalar loop, each channel scaled to 8 bits. The unused bits of imported 32-bit pixels
+ * are 0.
+ */
+class BMP_YUV {
+public:
+    BMP_YUV() = delete;
+
+    /// Range of the Y, Cb and Cr values
+    enum class Range {
+        limited, ///< Y in [16, 235], Cb and Cr in [16, 240], as most video
+        full     ///< Every value in [0, 255], as JPEG
+    };
+
+    /**
+     * @brief Writes an image as I420 planes.
+     *
+     * @param n[in] Image
+     * @param y[out] Y plane, as many rows as the image
+     * @param yStride[in] Bytes between the rows of y, at least the width of the image
+     * @param u[out] Cb plane
+     * @param v[out] Cr plane
+     * @param uvStride[in] Bytes between the rows of u and v, at least the width of a chroma plane
+     * @param matrix[in] Luma weights of the matrix, BT.601 or BT.709
+     * @param range[in] Range of the values
+     */
+    template<typename Image>
+    static void toI420(const Image &n, uint8_t *y, const size_t &yStride, uint8_t *u, uint8_t *v,
+                       const size_t &uvStride, const BMP_Convert::Luma &matrix = BMP_Convert::Luma::bt601,
+                       const Range &range = Range::limited);
+
+    /**
+     * @brief Writes an image as NV12 planes.
+     *
+     * @param n[in] Image
+     * @param y[out] Y plane, as many rows as the image
+     * @param yStride[in] Bytes between the rows of y, at least the width of the image
+     * @param uv[out] Plane of Cb and Cr pairs
+     * @param uvStride[in] Bytes between the rows of uv, at least twice the width of a chroma plane
+     * @param matrix[in] Luma weights of the matrix, BT.601 or BT.709
+     * @param range[in] Range of the values
+     */
+    template<typename Image>
+    static void toNV12(const Image &n, uint8_t *y, const size_t &yStride, uint8_t *uv, const size_t &uvStride,
+                       const BMP_Convert::Luma &matrix = BMP_Convert::Luma::bt601, const Range &range = Range::limited);
+
+    /**
+     * @brief Reads I420 planes into an image, of the dimensions of the image.
+     *
+     * @param y[in] Y plane
+     * @param yStride[in] Bytes between the rows of y, at least the width of the image
+     * @param u[in] Cb plane
+     * @param v[in] Cr plane
+     * @param uvStride[in] Bytes between the rows of u and v, at least the width of a chroma plane
+     * @param n[out] Image, it keeps its dimensions, row-order and storage
+     * @param matrix[in] Luma weights of the matrix, BT.601 or BT.709
+     * @param range[in] Range of the values
+     */
+    template<typename Image>
+    static void fromI420(const uint8_t *y, const size_t &yStride, const uint8_t *u, const uint8_t *v,
+                         const size_t &uvStride, Image &n, const BMP_Convert::Luma &matrix = BMP_Convert::Luma::bt601,
+                         const Range &range = Range::limited);
+
+    /**
+     * @brief Reads NV12 planes into an image, of the dimensions of the image.
+     *
+     * @param y[in] Y plane
+     * @param yStride[in] Bytes between the rows of y, at least the width of the image
+     * @param uv[in] Plane of Cb and Cr pairs
+     * @param uvStride[in] Bytes between the rows of uv, at least twice the width of a chroma plane
+     * @param n[out] Image, it keeps its dimensions, row-order and storage
+     * @param matrix[in] Luma weights of the matrix, BT.601 or BT.709
+     * @param range[in] Range of the values
+     */
+    template<typename Image>
+    static void fromNV12(const uint8_t *y, const size_t &yStride, const uint8_t *uv, const size_t &uvStride,
+                         Image &n, const BMP_Convert::Luma &matrix = BMP_Convert::Luma::bt601,
+                         const Range &range = Range::limited);
+};
+
+#endif //BMP_BMP_YUV_H
@@ -0,0 +1,212 @@
+/**
+ * @brief Self-check of BMP_YUV against a floating-point reference, prints the failures and exits with 1 if any.
+ *
+ * Build from the repository root, then run:
+ *
+ *     g++ -std=gnu++11 -O2 -pthread -I. check/yuv.cpp bmp*.cpp -o yuv && ./yuv
+ *
+ * Compile bmp_yuv.cpp with -U__SSE2__ to check the scalar path as well, it gives the same values. For both matrices
+ * and ranges, odd and even dimensions and both row-orders, of BMP_24bit in either storage and BMP_32bit with and
+ * without a bitmask, it checks that:
+ *  - every Y value is within 0.51 of the reference, and every Cb and Cr value within 0.51 of the reference of the
+ *    mean of its 2x2 block (0.5 of rounding, the rest of the fixed-point matrices);
+ *  - I420 and NV12 give the same values, both ways;
+ *  - an image of flat 2x2 blocks comes back within 2 of every channel after a round trip.
+ */
+#include "bmp_24-bit.h"
+#include "bmp_32-bit.h"
+#include "bmp_yuv.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+typedef BMP_Convert::Luma Luma;
+typedef BMP_YUV::Range Range;
+
+/// Largest difference from the reference, 0.5 of rounding and a little for the fixed-point matrices
+static const double tolerance = 0.51, roundTripTolerance = 2;
+
+/// Largest differences found, printed at the end
+static double worstValue = 0;
+static int32_t worstRoundTrip = 0;
+
+/// Number of failed checks
+static size_t failures = 0;
+
+static void expect(const bool &condition, const std::string &what) {
+    if (!condition && failures++ < 10)
+        std::printf("FAILED: %s\n", what.c_str());
+}
+
+/// Reference Y, Cb and Cr of a colour
+static void reference(const double *rgb, const Luma &matrix, const Range &range, double *ycbcr) {
+    const double kr = matrix == Luma::bt709 ? 0.2126 : 0.299, kb = matrix == Luma::bt709 ? 0.0722 : 0.114;
+    const double y = kr * rgb[0] + (1 - kr - kb) * rgb[1] + kb * rgb[2];
+    const double cb = (rgb[2] - y) / (2 * (1 - kb)), cr = (rgb[0] - y) / (2 * (1 - kr));
+    if (range == Range::full) {
+        ycbcr[0] = y;
+        ycbcr[1] = 128 + cb;
+        ycbcr[2] = 128 + cr;
+    } else {
+        ycbcr[0] = 16 + y * 219 / 255;
+        ycbcr[1] = 128 + cb * 224 / 255;
+        ycbcr[2] = 128 + cr * 224 / 255;
+    }
+}
+
+///@{
+/// R, G, B of every pixel, row by row from the top
+static std::vector<uint8_t> pixels(const BMP_24bit &n) {
+    const int32_t w = n.getInfoHeader().biWidth, h = std::abs(n.getInfoHeader().biHeight);
+    std::vector<uint8_t> out;
+    for (int32_t y = 0; y < h; ++y) {
+        for (int32_t x = 0; x < w; ++x) {
+            const uint32_t c = n.getPixel(x, y);
+            const uint8_t colour[3] = {static_cast<uint8_t>(c >> 16), static_cast<uint8_t>(c >> 8),
+                                       static_cast<uint8_t>(c)};
+            out.insert(out.end(), colour, colour + 3);
+        }
+    }
+
+    return out;
+}
+
+static std::vector<uint8_t> pixels(const BMP_32bit &n) {
+    const std::vector<uint32_t> masks = n.getPixelMasks();
+    const BMP_32bit::ConstView view = n.view();
+    std::vector<uint8_t> out;
+    for (int32_t y = 0; y < view.height(); ++y) {
+        for (int32_t x = 0; x < view.width(); ++x) {
+            for (uint8_t c = 0; c < 3; ++c) {
+                const uint32_t shift = __builtin_ctz(masks[c]), max = masks[c] >> shift;
+                out.push_back(static_cast<uint8_t>(((view.row(y)[x] & masks[c]) >> shift) * 255 / max));
+            }
+        }
+    }
+
+    return out;
+}
+///@}
+
+/// Checks the conversions of an image, every colour is the same within each 2x2 block if flat
+template<typename Image>
+static void check(const Image &n, const bool &flat, const std::string &name) {
+    const int32_t w = n.getInfoHeader().biWidth, h = std::abs(n.getInfoHeader().biHeight);
+    const int32_t cw = (w + 1) / 2, ch = (h + 1) / 2;
+    const size_t yStride = w + 3, uvStride = cw + 5, nv12Stride = 2 * cw + 1; // Padded, to check the strides
+    const std::vector<uint8_t> rgb = pixels(n);
+
+    for (const Luma &matrix : {Luma::bt601, Luma::bt709}) {
+        for (const Range &range : {Range::limited, Range::full}) {
+            const std::string what = name + (matrix == Luma::bt709 ? " bt709" : " bt601") +
+                                     (range == Range::full ? " full" : " limited");
+            std::vector<uint8_t> y(yStride * h), u(uvStride * ch), v(uvStride * ch), y12(yStride * h);
+            std::vector<uint8_t> uv(nv12Stride * ch);
+            BMP_YUV::toI420(n, y.data(), yStride, u.data(), v.data(), uvStride, matrix, range);
+            BMP_YUV::toNV12(n, y12.data(), yStride, uv.data(), nv12Stride, matrix, range);
+
+            double worst = 0;
+            for (int32_t j = 0; j < h; ++j) {
+                for (int32_t i = 0; i < w; ++i) {
+                    double colour[3], ycbcr[3];
+                    std::copy(&rgb[3 * (j * w + i)], &rgb[3 * (j * w + i)] + 3, colour);
+                    reference(colour, matrix, range, ycbcr);
+                    worst = std::max(worst, std::fabs(y[j * yStride + i] - ycbcr[0]));
+                    expect(y[j * yStride + i] == y12[j * yStride + i], what + ": Y of I420 and NV12 differ");
+                }
+            }
+
+            for (int32_t j = 0; j < ch; ++j) {
+                for (int32_t i = 0; i < cw; ++i) {
+                    // The last row and column are repeated for odd dimensions
+                    double mean[3] = {}, ycbcr[3];
+                    for (int32_t dy = 0; dy < 2; ++dy) {
+                        for (int32_t dx = 0; dx < 2; ++dx) {
+                            const int32_t x = std::min(2 * i + dx, w - 1), yy = std::min(2 * j + dy, h - 1);
+                            for (uint8_t c = 0; c < 3; ++c)
+                                mean[c] += rgb[3 * (yy * w + x) + c] / 4.0;
+                        }
+                    }
+
+                    reference(mean, matrix, range, ycbcr);
+                    worst = std::max(worst, std::fabs(u[j * uvStride + i] - ycbcr[1]));
+                    worst = std::max(worst, std::fabs(v[j * uvStride + i] - ycbcr[2]));
+                    const uint8_t *pair = &uv[j * nv12Stride + 2 * i];
+                    expect(pair[0] == u[j * uvStride + i] && pair[1] == v[j * uvStride + i],
+                           what + ": chroma of I420 and NV12 differ");
+                }
+            }
+
+            expect(worst <= tolerance, what + ": " + std::to_string(worst) + " from the reference");
+            worstValue = std::max(worstValue, worst);
+
+            // Back from both formats, into images that keep the dimensions, row-order and storage of n
+            Image i420(n), nv12(n);
+            BMP_YUV::fromI420(y.data(), yStride, u.data(), v.data(), uvStride, i420, matrix, range);
+            BMP_YUV::fromNV12(y.data(), yStride, uv.data(), nv12Stride, nv12, matrix, range);
+            const std::vector<uint8_t> back = pixels(i420);
+            expect(back == pixels(nv12), what + ": images from I420 and NV12 differ");
+
+            int32_t roundTrip = 0;
+            for (size_t i = 0; i < rgb.size(); ++i)
+                roundTrip = std::max(roundTrip, std::abs(rgb[i] - back[i]));
+            expect(!flat || roundTrip <= roundTripTolerance,
+                   what + ": round trip off by " + std::to_string(roundTrip));
+            if (flat)
+                worstRoundTrip = std::max(worstRoundTrip, roundTrip);
+        }
+    }
+}
+
+/// A colour for each 2x2 block
+static uint32_t blockColour(const int32_t &x, const int32_t &y) {
+    const uint32_t i = x / 2, j = y / 2;
+    return (i * 0x1F3A57u + j * 0x3C2B71u + i * j * 0x010305u) & 0xFFFFFFu;
+}
+
+int main() {
+    size_t images = 0;
+    for (const int32_t &w : {1, 2, 3, 16, 17, 33, 50}) {
+        for (const int32_t &signedHeight : {1, 2, 3, -4, 9}) {
+            const int32_t h = std::abs(signedHeight);
+            const std::string size = std::to_string(w) + "x" + std::to_string(signedHeight);
+
+            BMP_24bit flat(w, signedHeight), smooth(w, signedHeight);
+            for (int32_t y = 0; y < h; ++y) {
+                for (int32_t x = 0; x < w; ++x) {
+                    flat.setPixel(x, y, blockColour(x, y));
+                    smooth.setPixel(x, y, (x * 0x070503u + y * 0x030709u) & 0xFFFFFFu);
+                }
+            }
+
+            BMP_24bit planar(flat);
+            planar.setStorage(BMP_24bit::Storage::planar);
+
+            // RGB888, and a bitmask with the channels in the high bytes
+            BMP_32bit rgb888(w, signedHeight), shifted(w, signedHeight, 0, {0xFF000000, 0xFF0000, 0xFF00});
+            const std::vector<uint8_t> colours = pixels(flat);
+            for (int32_t y = 0; y < h; ++y) {
+                for (int32_t x = 0; x < w; ++x) {
+                    const uint8_t *c = &colours[3 * (y * w + x)];
+                    const uint32_t colour = static_cast<uint32_t>(c[0]) << 16 | c[1] << 8 | c[2];
+                    rgb888.view().row(y)[x] = colour | 0xAB000000u; // The unused byte is ignored
+                    shifted.view().row(y)[x] = colour << 8;
+                }
+            }
+
+            check(flat, true, "24-bit " + size);
+            check(planar, true, "planar 24-bit " + size);
+            check(smooth, false, "smooth 24-bit " + size);
+            check(rgb888, true, "32-bit " + size);
+            check(shifted, true, "32-bit bitmask " + size);
+            images += 5;
+        }
+    }
+
+    std::printf("%zu images, %zu failures, values within %.3f of the reference, flat round trips within %d\n", images,
+                failures, worstValue, worstRoundTrip);
+    return failures ? 1 : 0;
+}